@@ -1,39 +1,257 @@
-/* 
+/*
  * File:   Column.cpp
  * Implementation file for the Column class.
  *
  * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
  */
 
+#include <charconv>
+#include <cstdio>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
 #include <string>
 #include <typeinfo>
+#include <utility>
 #include "Column.h"
 
 const std::string Column::UNDEFINED = "\x7F";
 const std::string Column::NULL_VALUE = "\0";
 
+// Helper functions
+namespace {
+    /** Metadata used for columns created without any. */
+    const ColumnMetadata NO_METADATA;
+
+    /** Compares two values, returning -1, 0, or 1. */
+    template<typename T>
+    int compareValues(const T& val1, const T& val2) {
+        return (val1 < val2) ? -1 : (val2 < val1) ? 1 : 0;
+    }
+
+    /**
+     * Parses a whole string as a number.
+     *
+     * @return True if the entire string is a valid number, false otherwise
+     */
+    template<typename T>
+    bool parseNumber(std::string_view s, T& value) {
+        const char* end = s.data() + s.size();
+        auto result = std::from_chars(s.data(), end, value);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+    /**
+     * Parses a date in the form YYYY-MM-DD into the number YYYYMMDD, which
+     * orders the same way as the dates do.
+     *
+     * @return True if the string is a valid date, false otherwise
+     */
+    bool parseDate(std::string_view s, long long& value) {
+        if (s.size() == 10 && s[4] == '-' && s[7] == '-') {
+            long long year, month, day;
+            if (parseNumber(s.substr(0, 4), year)
+                    && parseNumber(s.substr(5, 2), month)
+                    && parseNumber(s.substr(8, 2), day)
+                    && year >= 1400 && year <= 9999 && month >= 1
+                    && month <= 12 && day >= 1 && day <= boost::gregorian::
+                    gregorian_calendar::end_of_month_day(year, month)) {
+                value = year * 10000 + month * 100 + day;
+                return true;
+            }
+        }
+        // Fall back to the other formats accepted by boost
+        boost::gregorian::date d = boost::gregorian::from_string(
+                std::string(s));
+        if (d.is_special()) {
+            return false;
+        }
+        value = d.year() * 10000 + d.month() * 100 + d.day();
+        return true;
+    }
+
+    /**
+     * Parses a time of day into the number of microseconds since midnight.
+     *
+     * @throw std::exception if the string is not a valid time
+     */
+    long long parseTime(std::string_view s) {
+        if (s.size() == 8 && s[2] == ':' && s[5] == ':') {
+            long long hours, minutes, seconds;
+            if (parseNumber(s.substr(0, 2), hours)
+                    && parseNumber(s.substr(3, 2), minutes)
+                    && parseNumber(s.substr(6, 2), seconds)
+                    && hours < 24 && minutes < 60 && seconds < 60) {
+                return ((hours * 60 + minutes) * 60 + seconds) * 1000000;
+            }
+        }
+        // Fall back to boost for the other formats. Only the time of day
+        // matters, so any date can be used.
+        auto time = boost::posix_time::time_from_string("2000-01-01 "
+                + std::string(s));
+        return time.time_of_day().total_microseconds();
+    }
+}  // namespace
+
 std::ostream& operator<<(std::ostream& os, const Column& col) {
-    os << std::quoted(col.colValue);
+    os << std::quoted(static_cast<std::string> (col));
     return os;
 }
 
-// Constructors implemented in header
+Column::Column(const std::string& colValue) {
+    parse(colValue);
+}
+
+Column::Column(const std::string& colValue, const ColumnMetadata* metadata)
+: metadata(metadata) {
+    parse(colValue);
+}
+
+Column::Column(const Column& col) {
+    *this = col;
+}
+
+Column::Column(Column&& col) noexcept {
+    *this = std::move(col);
+}
 
 Column::~Column() {
-    // No implementation needed
+    releaseText();
+}
+
+Column& Column::operator=(const Column& col) {
+    if (this == &col) {
+        return *this;
+    }
+    metadata = col.metadata;
+    switch (col.tag) {
+        case Tag::UNDEFINED:
+        case Tag::NULLED:
+            if (!holdsText()) {
+                text = nullptr;
+            }
+            break;
+        case Tag::INTEGER:
+        case Tag::DATE:
+        case Tag::TIME:
+            releaseText();
+            intValue = col.intValue;
+            break;
+        case Tag::DOUBLE:
+            releaseText();
+            doubleValue = col.doubleValue;
+            break;
+        case Tag::TEXT:
+            setText(col.getStoredText());
+            break;
+    }
+    tag = col.tag;
+    return *this;
 }
 
-ColumnMetadata Column::getMetadata() const {
-    return metadata;
+Column& Column::operator=(Column&& col) noexcept {
+    if (this == &col) {
+        return *this;
+    }
+    releaseText();
+    metadata = col.metadata;
+    tag = col.tag;
+    textSize = col.textSize;
+    if (col.holdsText()) {
+        // Take the buffer, leaving the other column undefined
+        text = col.text;
+        col.text = nullptr;
+        col.tag = Tag::UNDEFINED;
+    } else if (tag == Tag::DOUBLE) {
+        doubleValue = col.doubleValue;
+    } else {
+        intValue = col.intValue;
+    }
+    return *this;
+}
+
+void Column::setValue(std::string_view colValue,
+        const ColumnMetadata* metadata) {
+    this->metadata = metadata;
+    parse(colValue);
+}
+
+const ColumnMetadata& Column::getMetadata() const {
+    return metadata ? *metadata : NO_METADATA;
+}
+
+std::string_view Column::getText(std::string& buffer) const {
+    if (tag == Tag::TEXT) {
+        return getStoredText();
+    }
+    buffer = static_cast<std::string> (*this);
+    return buffer;
 }
 
 bool Column::isNull() const {
-    return colValue == NULL_VALUE;
+    return tag == Tag::NULLED;
+}
+
+bool Column::getStoredValue(long long& value) const {
+    if (tag == Tag::INTEGER || tag == Tag::DATE || tag == Tag::TIME) {
+        value = intValue;
+        return true;
+    }
+    return false;
+}
+
+bool Column::getStoredValue(double& value) const {
+    if (tag == Tag::DOUBLE) {
+        value = doubleValue;
+        return true;
+    }
+    return false;
+}
+
+bool Column::getStoredValue(std::string_view& value) const {
+    if (tag == Tag::TEXT) {
+        value = getStoredText();
+        return true;
+    }
+    return false;
+}
+
+void Column::setStoredValue(long long value,
+        const ColumnMetadata* metadata) {
+    releaseText();
+    this->metadata = metadata;
+    intValue = value;
+    switch (getMetadata().getValueType()) {
+        case ValueType::DATE:
+            tag = Tag::DATE;
+            break;
+        case ValueType::TIME:
+            tag = Tag::TIME;
+            break;
+        default:
+            tag = Tag::INTEGER;
+            break;
+    }
+}
+
+void Column::setStoredValue(double value, const ColumnMetadata* metadata) {
+    releaseText();
+    this->metadata = metadata;
+    doubleValue = value;
+    tag = Tag::DOUBLE;
 }
 
 Column::operator int() const {
+    if (tag == Tag::INTEGER) {
+        if (intValue < std::numeric_limits<int>::min()
+                || intValue > std::numeric_limits<int>::max()) {
+            throw std::out_of_range("Value out of range for int");
+        }
+        return static_cast<int> (intValue);
+    }
+    std::string colValue = *this;
     size_t pos = 0;
     int result = std::stoi(colValue, &pos);
     if (pos != colValue.length()) {
@@ -43,6 +261,10 @@ Column::operator int() const {
 }
 
 Column::operator long long() const {
+    if (tag == Tag::INTEGER) {
+        return intValue;
+    }
+    std::string colValue = *this;
     size_t pos = 0;
     long result = std::stoll(colValue, &pos);
     if (pos != colValue.length()) {
@@ -52,117 +274,216 @@ Column::operator long long() const {
 }
 
 Column::operator double() const {
-    return std::stod(colValue);
+    if (tag == Tag::DOUBLE) {
+        return doubleValue;
+    } else if (tag == Tag::INTEGER) {
+        return static_cast<double> (intValue);
+    }
+    return std::stod(static_cast<std::string> (*this));
 }
 
 Column::operator float() const {
-    return std::stof(colValue);
+    if (tag == Tag::DOUBLE || tag == Tag::INTEGER) {
+        return static_cast<float> (static_cast<double> (*this));
+    }
+    return std::stof(static_cast<std::string> (*this));
 }
 
 Column::operator std::string() const {
-    return colValue;
+    switch (tag) {
+        case Tag::UNDEFINED:
+            return UNDEFINED;
+        case Tag::NULLED:
+            return NULL_VALUE;
+        case Tag::INTEGER:
+            return std::to_string(intValue);
+        case Tag::DOUBLE: {
+            char buffer[32];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer),
+                    doubleValue);
+            return std::string(buffer, result.ptr);
+        }
+        case Tag::DATE: {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%04lld-%02lld-%02lld",
+                    intValue / 10000, intValue / 100 % 100, intValue % 100);
+            return buffer;
+        }
+        case Tag::TIME:
+            return boost::posix_time::to_simple_string(
+                    boost::posix_time::microseconds(intValue));
+        case Tag::TEXT:
+            break;
+    }
+    return std::string(getStoredText());
 }
 
 Column::operator boost::gregorian::date() const {
-    return boost::gregorian::from_string(colValue);
+    if (tag == Tag::DATE) {
+        return boost::gregorian::date(intValue / 10000, intValue / 100 % 100,
+                intValue % 100);
+    }
+    return boost::gregorian::from_string(static_cast<std::string> (*this));
 }
 
 Column::operator boost::posix_time::ptime() const {
     boost::gregorian::date d(boost::gregorian::day_clock::local_day());
+    if (tag == Tag::TIME) {
+        return boost::posix_time::ptime(d,
+                boost::posix_time::microseconds(intValue));
+    }
     auto dateStr = boost::gregorian::to_iso_extended_string(d);
-    return boost::posix_time::time_from_string(dateStr + " " + colValue);
+    return boost::posix_time::time_from_string(dateStr + " "
+            + static_cast<std::string> (*this));
 }
 
 Column::operator bool() const {
-    return colValue != UNDEFINED;
-}
-
-bool Column::operator==(const Column& col) {
-    std::string dataType = metadata.getColumnType();
-    if (dataType.find("char") != std::string::npos) {
-        return colValue == col.colValue;
-    } else if (dataType == "int" || dataType == "bigint") {
-        return static_cast<long long>(*this) == static_cast<long long>(col);
-    } else if (dataType == "float" || dataType == "double") {
-        return static_cast<double>(*this) == static_cast<double>(col);
-    } else if (dataType == "date") {
-        return this->operator boost::gregorian::date()
-                == col.operator boost::gregorian::date();
-    } else if (dataType == "time") {
-        return this->operator boost::posix_time::ptime()
-                == col.operator boost::posix_time::ptime();
-    }
-    return false;
+    return tag != Tag::UNDEFINED;
+}
+
+bool Column::operator==(const Column& col) const {
+    return compare(col) == 0;
+}
+
+bool Column::operator<(const Column& col) const {
+    return compare(col) < 0;
+}
+
+bool Column::operator>(const Column& col) const {
+    return compare(col) > 0;
+}
+
+bool Column::operator<=(const Column& col) const {
+    return compare(col) <= 0;
+}
+
+bool Column::operator>=(const Column& col) const {
+    return compare(col) >= 0;
 }
 
-bool Column::operator<(const Column& col) {
-    std::string dataType = metadata.getColumnType();
-    if (dataType.find("char") != std::string::npos) {
-        return colValue < col.colValue;
-    } else if (dataType == "int" || dataType == "bigint") {
-        return static_cast<long long>(*this) < static_cast<long long>(col);
-    } else if (dataType == "float" || dataType == "double") {
-        return static_cast<double>(*this) < static_cast<double>(col);
-    } else if (dataType == "date") {
-        return this->operator boost::gregorian::date() 
-                < col.operator boost::gregorian::date();
-    } else if (dataType == "time") {
-        return this->operator boost::posix_time::ptime() 
-                < col.operator boost::posix_time::ptime();
+void Column::parse(std::string_view colValue) {
+    if (colValue == NULL_VALUE) {
+        // Keep the text buffer so that it can be reused
+        if (!holdsText()) {
+            text = nullptr;
+        }
+        tag = Tag::NULLED;
+        return;
     }
-    return false;
+    // Values are parsed before they replace the text buffer
+    Tag parsedTag = Tag::TEXT;
+    long long integer = 0;
+    double real = 0;
+    try {
+        switch (getMetadata().getValueType()) {
+            case ValueType::INTEGER:
+                if (parseNumber(colValue, integer)) {
+                    parsedTag = Tag::INTEGER;
+                }
+                break;
+            case ValueType::DOUBLE:
+                if (parseNumber(colValue, real)) {
+                    parsedTag = Tag::DOUBLE;
+                }
+                break;
+            case ValueType::DATE:
+                if (parseDate(colValue, integer)) {
+                    parsedTag = Tag::DATE;
+                }
+                break;
+            case ValueType::TIME:
+                integer = parseTime(colValue);
+                parsedTag = Tag::TIME;
+                break;
+            case ValueType::STRING:
+                break;
+        }
+    } catch (const std::exception& e) {
+        // Keep values that cannot be parsed as text
+    }
+    if (parsedTag == Tag::TEXT) {
+        setText(colValue);
+        return;
+    }
+    releaseText();
+    if (parsedTag == Tag::DOUBLE) {
+        doubleValue = real;
+    } else {
+        intValue = integer;
+    }
+    tag = parsedTag;
+}
+
+bool Column::holdsText() const {
+    return tag == Tag::UNDEFINED || tag == Tag::NULLED || tag == Tag::TEXT;
+}
+
+std::string_view Column::getStoredText() const {
+    return textSize == 0 ? std::string_view()
+            : std::string_view(text->data(), textSize);
 }
 
-bool Column::operator>(const Column& col) {
-    std::string dataType = metadata.getColumnType();
-    if (dataType.find("char") != std::string::npos) {
-        return colValue > col.colValue;
-    } else if (dataType == "int" || dataType == "bigint") {
-        return static_cast<long long>(*this) > static_cast<long long>(col);
-    } else if (dataType == "float" || dataType == "double") {
-        return static_cast<double>(*this) > static_cast<double>(col);
-    } else if (dataType == "date") {
-        return this->operator boost::gregorian::date() 
-                > col.operator boost::gregorian::date();
-    } else if (dataType == "time") {
-        return this->operator boost::posix_time::ptime() 
-                > col.operator boost::posix_time::ptime();
+void Column::setText(std::string_view value) {
+    if (!holdsText()) {
+        text = nullptr;
     }
-    return false;
+    if (value.size() > (text ? text->capacity : 0)) {
+        releaseText();
+        text = new (::operator new(sizeof(TextBuffer) + value.size()))
+                TextBuffer{static_cast<unsigned int> (value.size())};
+    }
+    if (!value.empty()) {
+        std::memcpy(text->data(), value.data(), value.size());
+    }
+    textSize = value.size();
+    tag = Tag::TEXT;
 }
 
-bool Column::operator<=(const Column& col) {
-    std::string dataType = metadata.getColumnType();
-    if (dataType.find("char") != std::string::npos) {
-        return colValue <= col.colValue;
-    } else if (dataType == "int" || dataType == "bigint") {
-        return static_cast<long long>(*this) <= static_cast<long long>(col);
-    } else if (dataType == "float" || dataType == "double") {
-        return static_cast<double>(*this) <= static_cast<double>(col);
-    } else if (dataType == "date") {
-        return this->operator boost::gregorian::date() 
-                <= col.operator boost::gregorian::date();
-    } else if (dataType == "time") {
-        return this->operator boost::posix_time::ptime() 
-                <= col.operator boost::posix_time::ptime();
+void Column::releaseText() {
+    if (holdsText()) {
+        ::operator delete(text);
+        text = nullptr;
     }
-    return false;
 }
 
-bool Column::operator>=(const Column& col) {
-    std::string dataType = metadata.getColumnType();
-    if (dataType.find("char") != std::string::npos) {
-        return colValue >= col.colValue;
-    } else if (dataType == "int" || dataType == "bigint") {
-        return static_cast<long long>(*this) >= static_cast<long long>(col);
-    } else if (dataType == "float" || dataType == "double") {
-        return static_cast<double>(*this) >= static_cast<double>(col);
-    } else if (dataType == "date") {
-        return this->operator boost::gregorian::date() 
-                >= col.operator boost::gregorian::date();
-    } else if (dataType == "time") {
-        return this->operator boost::posix_time::ptime() 
-                >= col.operator boost::posix_time::ptime();
+int Column::compare(const Column& col) const {
+    if (tag == col.tag) {
+        switch (tag) {
+            case Tag::INTEGER:
+            case Tag::DATE:
+            case Tag::TIME:
+                return compareValues(intValue, col.intValue);
+            case Tag::DOUBLE:
+                return compareValues(doubleValue, col.doubleValue);
+            case Tag::TEXT:
+                return getStoredText().compare(col.getStoredText());
+            case Tag::UNDEFINED:
+            case Tag::NULLED:
+                return 0;
+        }
     }
-    return false;
+    if (tag == Tag::NULLED || col.tag == Tag::NULLED) {
+        // Nulls are ordered before every other value
+        return (tag == Tag::NULLED) ? -1 : 1;
+    }
+    // The columns are stored differently (e.g. a value compared to a literal),
+    // so convert both to the type of this column
+    switch (getMetadata().getValueType()) {
+        case ValueType::INTEGER:
+            return compareValues(static_cast<long long> (*this),
+                    static_cast<long long> (col));
+        case ValueType::DOUBLE:
+            return compareValues(static_cast<double> (*this),
+                    static_cast<double> (col));
+        case ValueType::DATE:
+            return compareValues(this->operator boost::gregorian::date(),
+                    col.operator boost::gregorian::date());
+        case ValueType::TIME:
+            return compareValues(this->operator boost::posix_time::ptime(),
+                    col.operator boost::posix_time::ptime());
+        case ValueType::STRING:
+            break;
+    }
+    return static_cast<std::string> (*this).compare(
+            static_cast<std::string> (col));
 }
@@ -1,4 +1,4 @@
-/* 
+/*
  * File:   Column.h
  * Header file for the Column class.
  *
@@ -12,31 +12,107 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <iostream>
 #include <string>
+#include <string_view>
 
 #include "ColumnMetadata.h"
 
 /**
- * Represents a column in a row. Columns are automatically type casted into
- * supported data types.
+ * Represents a column in a row. When a column is created with metadata, its
+ * value is parsed once into the type given by the metadata and stored in a
+ * compact form. Numbers, dates and times are stored in place; char and
+ * varchar values are stored in a heap buffer that shares the same storage,
+ * so a column takes 24 bytes whatever its type. The buffer is kept while
+ * the column holds text or null, so decoding text into the same column
+ * again does not allocate. The metadata is not copied: it must be owned by
+ * a Schema that outlives the column.
  */
 class Column {
-public:    
+public:
     friend std::ostream& operator<<(std::ostream& os, const Column& col);
     /** The value used to indicate null columns. */
     static const std::string NULL_VALUE;
-    
-    Column() : colValue(UNDEFINED) {}
-    Column(const std::string& colValue) : colValue(colValue) {}
-    Column(const std::string& colValue, const ColumnMetadata& metadata) 
-             : colValue(colValue), metadata(metadata) {}
+
+    Column() {}
+    Column(const std::string& colValue);
+    Column(const std::string& colValue, const ColumnMetadata* metadata);
+    Column(const Column& col);
+    Column(Column&& col) noexcept;
     ~Column();
-    
+
+    Column& operator=(const Column& col);
+    Column& operator=(Column&& col) noexcept;
+
+    /**
+     * Replaces the value and metadata of this column. The column's storage is
+     * reused, so decoding rows into existing columns does not allocate.
+     *
+     * @param colValue The new value
+     * @param metadata The metadata for the column, or nullptr
+     */
+    void setValue(std::string_view colValue, const ColumnMetadata* metadata);
+
     /** Gets the metadata for this column. */
-    ColumnMetadata getMetadata() const;
-    
+    const ColumnMetadata& getMetadata() const;
+
+    /**
+     * Gets the value of the column as text. Text values are not copied; 
+     * other values are formatted into the given buffer.
+     * 
+     * @param buffer Holds the formatted value if the value is not text
+     * @return A view of the value that is valid until the column or the
+     * buffer is changed
+     */
+    std::string_view getText(std::string& buffer) const;
+
     /** Checks to see if the column holds a null value. */
     bool isNull() const;
-    
+
+    /**
+     * Gets the value of an int, bigint, date or time column in the form it
+     * is stored in: dates as YYYYMMDD and times as microseconds since
+     * midnight. Values stored this way can be compared as plain integers.
+     *
+     * @param value Set to the stored value
+     * @return False if the value is not stored as an integer, such as when
+     * it is null or failed to parse
+     */
+    bool getStoredValue(long long& value) const;
+
+    /**
+     * Gets the value of a float or double column as it is stored.
+     *
+     * @param value Set to the stored value
+     * @return False if the value is not stored as a double
+     */
+    bool getStoredValue(double& value) const;
+
+    /**
+     * Gets the value of a char or varchar column as it is stored.
+     *
+     * @param value Set to a view of the stored text, valid until the column
+     * is changed
+     * @return False if the value is not stored as text
+     */
+    bool getStoredValue(std::string_view& value) const;
+
+    /**
+     * Sets the value of an int, bigint, date or time column to a value in
+     * the form getStoredValue() gives it in.
+     *
+     * @param value The stored value
+     * @param metadata The metadata for the column, whose type decides how
+     * the value is read
+     */
+    void setStoredValue(long long value, const ColumnMetadata* metadata);
+
+    /**
+     * Sets the value of a float or double column.
+     *
+     * @param value The stored value
+     * @param metadata The metadata for the column
+     */
+    void setStoredValue(double value, const ColumnMetadata* metadata);
+
     // Type conversions
     operator int() const;
     operator long long() const;
@@ -47,19 +123,76 @@ public:
     operator boost::posix_time::ptime() const;
     // Used to tell if the column has been initialized
     operator bool() const;
-    
+
     // Comparison operators
-    bool operator==(const Column& col);
-    bool operator<(const Column& col);
-    bool operator>(const Column& col);
-    bool operator<=(const Column& col);
-    bool operator>=(const Column& col);
-    
+    bool operator==(const Column& col) const;
+    bool operator<(const Column& col) const;
+    bool operator>(const Column& col) const;
+    bool operator<=(const Column& col) const;
+    bool operator>=(const Column& col) const;
+
 private:
-    std::string colValue;
-    ColumnMetadata metadata;
+    /** The representations a column value can have. */
+    enum class Tag : unsigned char {
+        UNDEFINED,
+        NULLED,
+        INTEGER,  // Stored in intValue
+        DOUBLE,   // Stored in doubleValue
+        DATE,     // Stored in intValue as YYYYMMDD
+        TIME,     // Stored in intValue as microseconds since midnight
+        TEXT      // Stored in text; also used for values that failed to parse
+    };
+
+    /** A heap buffer holding text, followed by its characters. */
+    struct TextBuffer {
+        unsigned int capacity;
+
+        char* data() {
+            return reinterpret_cast<char*> (this + 1);
+        }
+    };
+
+    const ColumnMetadata* metadata = nullptr;
+    Tag tag = Tag::UNDEFINED;
+    unsigned int textSize = 0;  // The length of the text if the tag is TEXT
+    union {
+        long long intValue;
+        double doubleValue;
+        // Owned, or null; only valid while the tag is UNDEFINED, NULLED or
+        // TEXT, so that null and text values can reuse the buffer
+        TextBuffer* text = nullptr;
+    };
     /** Value used for uninitialized columns */
     static const std::string UNDEFINED;
+
+    /**
+     * Parses the value into the representation for the column's type. Leaves
+     * the value as text if it cannot be parsed.
+     */
+    void parse(std::string_view colValue);
+
+    /** Checks if the column's storage holds the text buffer. */
+    bool holdsText() const;
+
+    /** Gets the stored text. The tag must be TEXT. */
+    std::string_view getStoredText() const;
+
+    /** Stores the given text, reusing the text buffer if it is big enough. */
+    void setText(std::string_view value);
+
+    /**
+     * Frees the text buffer, if the column holds one, so that a number can
+     * be stored in its place.
+     */
+    void releaseText();
+
+    /**
+     * Compares this column to the given column.
+     *
+     * @return A negative number, zero, or a positive number if this column
+     * is less than, equal to, or greater than the given column
+     */
+    int compare(const Column& col) const;
 };
 
 #endif /* COLUMN_H */
@@ -20,6 +20,7 @@ std::istream& operator>>(std::istream& is, ColumnMetadata& metadata) {
     is >> std::quoted(metadata.colName) >> std::quoted(metadata.colType)
        >> std::quoted(metadata.references) >> metadata.primaryKey 
        >> metadata.notNull;
+    metadata.valueType = ColumnMetadata::getValueType(metadata.colType);
     return is;
 }
 
@@ -31,19 +32,19 @@ ColumnMetadata::~ColumnMetadata() {
     // No implementation needed
 }
 
-std::string ColumnMetadata::getColumnName() const {
+const std::string& ColumnMetadata::getColumnName() const {
     return colName;
 }
 
-std::string ColumnMetadata::getTableName() const {
+const std::string& ColumnMetadata::getTableName() const {
     return tableName;
 }
 
-std::string ColumnMetadata::getColumnType() const {
+const std::string& ColumnMetadata::getColumnType() const {
     return colType;
 }
 
-std::string ColumnMetadata::getReferencedColumn() const {
+const std::string& ColumnMetadata::getReferencedColumn() const {
     return references;
 }
 
@@ -54,3 +55,20 @@ bool ColumnMetadata::isPrimaryKey() const {
 bool ColumnMetadata::isNotNull() const {
     return notNull;
 }
+
+ValueType ColumnMetadata::getValueType() const {
+    return valueType;
+}
+
+ValueType ColumnMetadata::getValueType(const std::string& colType) {
+    if (colType == "int" || colType == "bigint") {
+        return ValueType::INTEGER;
+    } else if (colType == "float" || colType == "double") {
+        return ValueType::DOUBLE;
+    } else if (colType == "date") {
+        return ValueType::DATE;
+    } else if (colType == "time") {
+        return ValueType::TIME;
+    }
+    return ValueType::STRING;
+}
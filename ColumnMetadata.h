@@ -11,6 +11,15 @@
 #include <iostream>
 #include <string>
 
+/** The kinds of values stored in a column, derived from its data type. */
+enum class ValueType : unsigned char {
+    STRING,   // char and varchar
+    INTEGER,  // int and bigint
+    DOUBLE,   // float and double
+    DATE,
+    TIME
+};
+
 /**
  * A class to store the metadata for a column. Used for ensuring valid 
  * operations on data in the database.
@@ -32,20 +41,28 @@ public:
                         colName(colName), tableName(tableName), 
                         colType(colType), references(references), 
                         primaryKey(isPrimaryKey),
-                        notNull(primaryKey ? true : notNull) {}
+                        notNull(primaryKey ? true : notNull),
+                        valueType(getValueType(colType)) {}
     ~ColumnMetadata();
     
     // Getter methods
-    std::string getColumnName() const;
-    std::string getTableName() const;
-    std::string getColumnType() const;
-    std::string getReferencedColumn() const;
+    const std::string& getColumnName() const;
+    const std::string& getTableName() const;
+    const std::string& getColumnType() const;
+    const std::string& getReferencedColumn() const;
     bool isPrimaryKey() const;
     bool isNotNull() const;
     
+    /** Gets the kind of values stored in the column. */
+    ValueType getValueType() const;
+    
+    /** Gets the kind of values stored in columns of the given data type. */
+    static ValueType getValueType(const std::string& colType);
+    
 private:
     std::string colName, tableName, colType, references;
-    bool primaryKey, notNull;
+    bool primaryKey = false, notNull = false;
+    ValueType valueType = ValueType::STRING;
 };
 
 #endif /* COLUMNMETADATA_H */
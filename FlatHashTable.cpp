@@ -0,0 +1,154 @@
+/*
+ * File:   FlatHashTable.cpp
+ * Implementation file for the FlatHashTable class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include "FlatHashTable.h"
+
+// Helper functions
+namespace {
+    /** The first byte of each kind of packed value, in sort order. */
+    enum KeyTag : char {NULL_TAG, INTEGER_TAG, DOUBLE_TAG, TEXT_TAG};
+
+    /**
+     * Appends a number most significant byte first, so that packed numbers
+     * compare as unsigned numbers.
+     */
+    void appendBigEndian(std::string& key, std::uint64_t value) {
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            key += static_cast<char>(value >> shift);
+        }
+    }
+
+    /**
+     * Appends text followed by two zero bytes, with each zero byte in the
+     * text followed by 0xff, so that the values of several columns in a key
+     * cannot run into each other and shorter text compares first.
+     */
+    void appendText(std::string& key, std::string_view text) {
+        key += TEXT_TAG;
+        for (char c : text) {
+            key += c;
+            if (c == '\0') {
+                key += '\xff';
+            }
+        }
+        key.append(2, '\0');
+    }
+}  // namespace
+
+FlatHashTable::FlatHashTable(std::size_t expectedSize) {
+    rehash(expectedSize);
+}
+
+std::pair<unsigned int, bool> FlatHashTable::insert(std::string_view key,
+        std::size_t hash) {
+    std::size_t slot = findSlot(key, hash);
+    if (slots[slot].id != NOT_FOUND) {
+        return {slots[slot].id, false};
+    }
+    // The slots are kept at most half full, so probe sequences stay short
+    if ((keyEnds.size() + 1) * 2 > slots.size()) {
+        rehash(keyEnds.size() + 1);
+        slot = findSlot(key, hash);
+    }
+    unsigned int id = keyEnds.size();
+    keyData.append(key.data(), key.size());
+    keyEnds.push_back(keyData.size());
+    slots[slot] = {static_cast<std::uint32_t>(hash), id};
+    return {id, true};
+}
+
+unsigned int FlatHashTable::find(std::string_view key,
+        std::size_t hash) const {
+    return slots[findSlot(key, hash)].id;
+}
+
+std::size_t FlatHashTable::size() const {
+    return keyEnds.size();
+}
+
+void FlatHashTable::reserve(std::size_t size) {
+    keyEnds.reserve(size);
+    rehash(size);
+}
+
+std::size_t FlatHashTable::hash(std::string_view key) {
+    return std::hash<std::string_view>()(key);
+}
+
+void FlatHashTable::appendKey(std::string& key, const Column& col,
+        bool typed) {
+    long long integer;
+    double real;
+    std::string buffer;
+    if (!typed) {
+        appendText(key, col.getText(buffer));
+    } else if (col.isNull()) {
+        key += NULL_TAG;
+    } else if (col.getStoredValue(integer)) {
+        // Flipping the sign bit orders negative numbers first
+        key += INTEGER_TAG;
+        appendBigEndian(key, static_cast<std::uint64_t>(integer)
+                ^ (std::uint64_t(1) << 63));
+    } else if (col.getStoredValue(real)) {
+        // Every NaN has the same text, so they are packed the same way
+        if (std::isnan(real)) {
+            real = std::copysign(std::numeric_limits<double>::quiet_NaN(),
+                    real);
+        }
+        // Positive numbers get the sign bit set and negative numbers have
+        // every bit flipped, so that the bits compare in numeric order
+        std::uint64_t bits;
+        std::memcpy(&bits, &real, sizeof(bits));
+        bits = bits >> 63 ? ~bits : bits | (std::uint64_t(1) << 63);
+        key += DOUBLE_TAG;
+        appendBigEndian(key, bits);
+    } else {
+        appendText(key, col.getText(buffer));
+    }
+}
+
+std::string_view FlatHashTable::getKey(unsigned int id) const {
+    std::size_t start = id == 0 ? 0 : keyEnds[id - 1];
+    return std::string_view(keyData).substr(start, keyEnds[id] - start);
+}
+
+std::size_t FlatHashTable::findSlot(std::string_view key,
+        std::size_t hash) const {
+    std::size_t mask = slots.size() - 1;
+    auto hashBits = static_cast<std::uint32_t>(hash);
+    for (std::size_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+        const Slot& entry = slots[slot];
+        if (entry.id == NOT_FOUND || (entry.hashBits == hashBits
+                && getKey(entry.id) == key)) {
+            return slot;
+        }
+    }
+}
+
+void FlatHashTable::rehash(std::size_t capacity) {
+    std::size_t slotCount = 16;
+    while (slotCount < capacity * 2) {
+        slotCount *= 2;
+    }
+    if (slotCount <= slots.size()) {
+        return;
+    }
+    slots.assign(slotCount, {0, NOT_FOUND});
+    std::size_t mask = slotCount - 1;
+    for (unsigned int id = 0; id < keyEnds.size(); id++) {
+        std::size_t keyHash = hash(getKey(id));
+        std::size_t slot = keyHash & mask;
+        while (slots[slot].id != NOT_FOUND) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = {static_cast<std::uint32_t>(keyHash), id};
+    }
+}
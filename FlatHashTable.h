@@ -0,0 +1,107 @@
+/*
+ * File:   FlatHashTable.h
+ * Header file for the FlatHashTable class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef FLATHASHTABLE_H
+#define FLATHASHTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "Column.h"
+
+/**
+ * A hash table with open addressing that gives each key added to it the
+ * next id, starting at 0. It is the index of hash joins and of the distinct
+ * filter. Keys are byte strings packed from column values by appendKey,
+ * which keeps integers, dates, times and doubles in their binary form. The
+ * keys are stored one after another in a single buffer, and each slot holds
+ * only the low bits of a key's hash and its id, so a lookup reads one key
+ * in the common case, and adding a key rarely allocates. The payload of
+ * each key, such as the index of a row, is kept by the caller in a vector
+ * indexed by the key's id.
+ */
+class FlatHashTable {
+public:
+    /** The id returned for keys that are not in the table. */
+    static constexpr unsigned int NOT_FOUND = ~0u;
+
+    /**
+     * Creates an empty table.
+     *
+     * @param expectedSize The number of keys to make room for
+     */
+    explicit FlatHashTable(std::size_t expectedSize = 0);
+
+    /**
+     * Adds a key unless it is already in the table.
+     *
+     * @param key The key
+     * @param hash The hash of the key, from hash()
+     * @return The id of the key, and true if it was added
+     */
+    std::pair<unsigned int, bool> insert(std::string_view key,
+            std::size_t hash);
+
+    /**
+     * Looks up a key.
+     *
+     * @param key The key
+     * @param hash The hash of the key, from hash()
+     * @return The id of the key, or NOT_FOUND if it is not in the table
+     */
+    unsigned int find(std::string_view key, std::size_t hash) const;
+
+    /** Gets the number of keys in the table. */
+    std::size_t size() const;
+
+    /** Makes room for a number of keys, so adding them does not rehash. */
+    void reserve(std::size_t size);
+
+    /** Hashes a key. */
+    static std::size_t hash(std::string_view key);
+
+    /**
+     * Appends the value of a column to a key. The key of several columns is
+     * their values appended one after another. Packed keys compare as byte
+     * strings in the order of their values, column by column: nulls first,
+     * then numbers, dates and times in numeric order, then text byte by
+     * byte.
+     *
+     * @param key The key
+     * @param col The column
+     * @param typed True to pack the value in the form it is stored in, false
+     * to pack its text. Typed values are only equal to values packed from
+     * columns of the same value type, while text matches across types.
+     */
+    static void appendKey(std::string& key, const Column& col,
+            bool typed = true);
+
+private:
+    struct Slot {
+        std::uint32_t hashBits;  // The low bits of the hash of the key
+        std::uint32_t id;        // NOT_FOUND if the slot is empty
+    };
+
+    std::vector<Slot> slots;  // A power of two in size
+    std::string keyData;  // The keys, in the order of their ids
+    std::vector<std::size_t> keyEnds;  // The end of each key in keyData
+
+    /** Gets the key with the given id. */
+    std::string_view getKey(unsigned int id) const;
+
+    /** Gets the slot of a key, or the empty slot where it would go. */
+    std::size_t findSlot(std::string_view key, std::size_t hash) const;
+
+    /** Resizes the slots to hold the given number of keys and rehashes. */
+    void rehash(std::size_t capacity);
+};
+
+#endif /* FLATHASHTABLE_H */
+
@@ -0,0 +1,167 @@
+/*
+ * File:   JoinHashTable.cpp
+ * Implementation file for the JoinHashTable class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <utility>
+#include "constants.h"
+#include "JoinHashTable.h"
+#include "ThreadPool.h"
+
+JoinHashTable::JoinHashTable(RowVec rows,
+        const std::vector<unsigned int>& keyIndexes,
+        const std::vector<bool>& typedKeys, unsigned int parallelism)
+        : rows(std::move(rows)), typedKeys(typedKeys) {
+    ThreadPool& pool = ThreadPool::getShared();
+    this->parallelism = pool.getParallelism(parallelism);
+    std::size_t count = this->rows.size();
+    while (partitionBits < JOIN_MAX_PARTITION_BITS
+            && (count >> partitionBits) > JOIN_PARTITION_ROWS) {
+        partitionBits++;
+    }
+    partitions.resize(std::size_t(1) << partitionBits);
+    std::vector<std::string> keys(count);
+    std::vector<std::size_t> hashes(count);
+    hashKeys([this, &keyIndexes](std::size_t i, std::string& key) {
+        packKey(key, [this, &keyIndexes, i](unsigned int c)
+                -> const Column& {
+            return this->rows[i][keyIndexes[c]];
+        });
+    }, keys, hashes);
+    std::vector<unsigned int> order, starts;
+    groupByPartition(hashes, order, starts);
+    // Each partition is built by one task, from its rows in table order, so
+    // the rows with the same key are chained in table order. Every row is in
+    // one partition, so the tasks set different entries of nextRows.
+    nextRows.assign(count, NO_MATCH);
+    pool.runSlices(partitions.size(), this->parallelism,
+            [&](unsigned int, std::size_t start, std::size_t end) {
+        std::vector<unsigned int> lastRows;  // By the id of the key
+        for (std::size_t p = start; p < end; p++) {
+            Partition& partition = partitions[p];
+            partition.keys.reserve(starts[p + 1] - starts[p]);
+            lastRows.clear();
+            for (unsigned int k = starts[p]; k < starts[p + 1]; k++) {
+                unsigned int i = order[k];
+                auto key = partition.keys.insert(keys[i], hashes[i]);
+                if (key.second) {
+                    partition.firstRows.push_back(i);
+                    lastRows.push_back(i);
+                } else {
+                    nextRows[lastRows[key.first]] = i;
+                    lastRows[key.first] = i;
+                }
+            }
+        }
+    });
+}
+
+unsigned int JoinHashTable::findFirst(const Row& row,
+        const std::vector<unsigned int>& keyIndexes) const {
+    std::string key;
+    packKey(key, [&row, &keyIndexes](unsigned int c) -> const Column& {
+        return row[keyIndexes[c]];
+    });
+    return findRow(key, FlatHashTable::hash(key));
+}
+
+void JoinHashTable::findAll(const RowBatch& batch,
+        const std::vector<unsigned int>& keyIndexes,
+        const std::vector<unsigned int>& positions,
+        std::vector<unsigned int>& matches) const {
+    std::size_t count = positions.size();
+    matches.assign(count, NO_MATCH);
+    std::vector<std::string> keys(count);
+    std::vector<std::size_t> hashes(count);
+    hashKeys([this, &batch, &keyIndexes, &positions](std::size_t i,
+            std::string& key) {
+        packKey(key, [&batch, &keyIndexes, &positions, i](unsigned int c)
+                -> const Column& {
+            return batch.getColumn(keyIndexes[c], positions[i]);
+        });
+    }, keys, hashes);
+    // The keys are probed in partition order, so each task only looks in the
+    // hash tables of a few partitions
+    std::vector<unsigned int> order, starts;
+    groupByPartition(hashes, order, starts);
+    ThreadPool::getShared().runSlices(count, getSliceCount(count),
+            [&](unsigned int, std::size_t start, std::size_t end) {
+        for (std::size_t k = start; k < end; k++) {
+            unsigned int i = order[k];
+            matches[i] = findRow(keys[i], hashes[i]);
+        }
+    });
+}
+
+unsigned int JoinHashTable::getNextMatch(unsigned int index) const {
+    return nextRows[index];
+}
+
+const Row& JoinHashTable::getRow(unsigned int index) const {
+    return rows[index];
+}
+
+unsigned int JoinHashTable::getPartition(std::size_t hash) const {
+    if (partitionBits == 0) {
+        return 0;
+    }
+    return hash >> (std::numeric_limits<std::size_t>::digits - partitionBits);
+}
+
+unsigned int JoinHashTable::findRow(std::string_view key,
+        std::size_t hash) const {
+    const Partition& partition = partitions[getPartition(hash)];
+    unsigned int id = partition.keys.find(key, hash);
+    return id != FlatHashTable::NOT_FOUND ? partition.firstRows[id] : NO_MATCH;
+}
+
+void JoinHashTable::packKey(std::string& key,
+        const std::function<const Column&(unsigned int)>& getColumn) const {
+    key.clear();
+    for (unsigned int c = 0; c < typedKeys.size(); c++) {
+        FlatHashTable::appendKey(key, getColumn(c), typedKeys[c]);
+    }
+}
+
+unsigned int JoinHashTable::getSliceCount(std::size_t rowCount) const {
+    return std::max<std::size_t>(std::min<std::size_t>(parallelism,
+            rowCount / JOIN_SLICE_ROWS), 1);
+}
+
+void JoinHashTable::hashKeys(
+        const std::function<void(std::size_t, std::string&)>& packKeyAt,
+        std::vector<std::string>& keys,
+        std::vector<std::size_t>& hashes) const {
+    ThreadPool::getShared().runSlices(keys.size(),
+            getSliceCount(keys.size()),
+            [&](unsigned int, std::size_t start, std::size_t end) {
+        for (std::size_t i = start; i < end; i++) {
+            packKeyAt(i, keys[i]);
+            hashes[i] = FlatHashTable::hash(keys[i]);
+        }
+    });
+}
+
+void JoinHashTable::groupByPartition(const std::vector<std::size_t>& hashes,
+        std::vector<unsigned int>& order,
+        std::vector<unsigned int>& starts) const {
+    std::vector<unsigned int> keyPartitions(hashes.size());
+    starts.assign(partitions.size() + 1, 0);
+    for (unsigned int i = 0; i < hashes.size(); i++) {
+        keyPartitions[i] = getPartition(hashes[i]);
+        starts[keyPartitions[i] + 1]++;
+    }
+    for (std::size_t p = 1; p < starts.size(); p++) {
+        starts[p] += starts[p - 1];
+    }
+    std::vector<unsigned int> next(starts.begin(), starts.end() - 1);
+    order.resize(hashes.size());
+    for (unsigned int i = 0; i < hashes.size(); i++) {
+        order[next[keyPartitions[i]]++] = i;
+    }
+}
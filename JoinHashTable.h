@@ -0,0 +1,150 @@
+/*
+ * File:   JoinHashTable.h
+ * Header file for the JoinHashTable class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef JOINHASHTABLE_H
+#define JOINHASHTABLE_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Column.h"
+#include "FlatHashTable.h"
+#include "Row.h"
+#include "RowBatch.h"
+
+/**
+ * The build side of a hash join: the rows of the build table, keyed by the
+ * values of their columns in every join condition, packed into one
+ * composite key. Each partition is a FlatHashTable of the keys, with the
+ * index of the first row of each key; the rows with the same key are
+ * chained in table order, so a single lookup finds every match. The rows
+ * are radix partitioned on the high bits of the hash of their keys, with
+ * few enough rows in each partition that its hash table fits in cache, and
+ * the partitions are hashed and built in parallel on the shared ThreadPool.
+ * Keys looked up in bulk are partitioned the same way, so each task probes
+ * only its own partitions.
+ */
+class JoinHashTable {
+public:
+    /** The index returned when there are no more matching rows. */
+    static constexpr unsigned int NO_MATCH = FlatHashTable::NOT_FOUND;
+
+    /**
+     * Builds the hash table.
+     *
+     * @param rows The rows of the build table
+     * @param keyIndexes The index in the rows of the column of each join
+     * condition
+     * @param typedKeys Whether the column of each condition is compared in
+     * the form it is stored in, which requires the columns compared to have
+     * the same value type, rather than as text
+     * @param parallelism The most tasks run at once, or 0 for one per thread
+     * of the pool
+     */
+    JoinHashTable(RowVec rows, const std::vector<unsigned int>& keyIndexes,
+            const std::vector<bool>& typedKeys, unsigned int parallelism);
+
+    /**
+     * Looks up the first row matching the key of a row of the other table.
+     *
+     * @param row The row
+     * @param keyIndexes The index in the row of the column of each condition
+     * @return The index of the first matching row, or NO_MATCH
+     */
+    unsigned int findFirst(const Row& row,
+            const std::vector<unsigned int>& keyIndexes) const;
+
+    /**
+     * Looks up the first rows matching the keys of many rows of a batch at
+     * once.
+     *
+     * @param batch The batch holding the keys
+     * @param keyIndexes The index in the batch of the column of each
+     * condition
+     * @param positions The positions of the rows in the batch
+     * @param matches Set to the index of the first row matching the key of
+     * each position, or NO_MATCH
+     */
+    void findAll(const RowBatch& batch,
+            const std::vector<unsigned int>& keyIndexes,
+            const std::vector<unsigned int>& positions,
+            std::vector<unsigned int>& matches) const;
+
+    /**
+     * Gets the next row with the same key as a matching row.
+     *
+     * @param index The index of the matching row
+     * @return The index of the next row, or NO_MATCH
+     */
+    unsigned int getNextMatch(unsigned int index) const;
+
+    /** Gets the row with the given index. */
+    const Row& getRow(unsigned int index) const;
+
+private:
+    /** The keys of a partition and the first row of each key. */
+    struct Partition {
+        FlatHashTable keys;
+        std::vector<unsigned int> firstRows;  // By the id of the key
+    };
+
+    RowVec rows;
+    std::vector<unsigned int> nextRows;  // The next row with each row's key
+    std::vector<Partition> partitions;
+    unsigned int partitionBits = 0;  // The bits of a hash naming its partition
+    std::vector<bool> typedKeys;
+    unsigned int parallelism;
+
+    /** Gets the partition of the keys with the given hash. */
+    unsigned int getPartition(std::size_t hash) const;
+
+    /** Gets the index of the first row matching a key, or NO_MATCH. */
+    unsigned int findRow(std::string_view key, std::size_t hash) const;
+
+    /**
+     * Packs the columns of a key.
+     *
+     * @param key Set to the packed key
+     * @param getColumn Gets the column of the condition with the given index
+     */
+    void packKey(std::string& key,
+            const std::function<const Column&(unsigned int)>& getColumn)
+            const;
+
+    /** Gets the number of tasks that hash or probe a number of rows. */
+    unsigned int getSliceCount(std::size_t rowCount) const;
+
+    /**
+     * Packs keys and hashes them in parallel.
+     *
+     * @param packKeyAt Packs the key with the given index
+     * @param keys Set to each packed key; sized to the number of keys
+     * @param hashes Set to the hash of each key; sized the same
+     */
+    void hashKeys(
+            const std::function<void(std::size_t, std::string&)>& packKeyAt,
+            std::vector<std::string>& keys,
+            std::vector<std::size_t>& hashes) const;
+
+    /**
+     * Orders the indexes of keys by partition, keeping the keys of each
+     * partition in their original order.
+     *
+     * @param hashes The hash of each key
+     * @param order Set to the indexes of the keys, grouped by partition
+     * @param starts Set to the position in the order of the first key of
+     * each partition, followed by the number of keys
+     */
+    void groupByPartition(const std::vector<std::size_t>& hashes,
+            std::vector<unsigned int>& order,
+            std::vector<unsigned int>& starts) const;
+};
+
+#endif /* JOINHASHTABLE_H */
+
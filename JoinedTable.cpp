@@ -5,45 +5,39 @@
  * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
  */
 
-#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
-#include <unordered_map>
+#include "constants.h"
 #include "InvalidQueryException.h"
 #include "JoinedTable.h"
-#include "string_util.h"
+#include "RowBatch.h"
 #include "Table.h"
 
-// Helper functions
-namespace {
-    /**
-     * Compares rows when ordering them.
-     */
-    bool compareRows(const Row& row1, const Row& row2, 
-            const ColumnNames& nameVec, bool desc) {
-        for (const auto& colName : nameVec) {
-            auto col1 = row1.getColumn(colName);
-            auto col2 = row2.getColumn(colName);
-            if (col1 == col2) {
-                continue;
-            }
-            return desc ? (col1 > col2) : (col1 < col2);
-        }
-        return false;
-    }
-}  // namespace
+std::size_t JoinedTable::memoryBudget = JOIN_MEMORY_BUDGET;
+
+JoinedTable::JoinedTable(const Table& table1, const Table& table2,
+        const JoinConditions& joinConditions)
+: JoinedTable(table1, table2, buildsFirst(table1, table2)
+        ? bindJoinConditions(table2.getSchema(), table1.getSchema(),
+                joinConditions)
+        : bindJoinConditions(table1.getSchema(), table2.getSchema(),
+                joinConditions)) {
+    // No implementation needed
+}
 
 JoinedTable::JoinedTable(const Table& table1, const Table& table2,
-        const std::string& joinCondition) {
+        const std::vector<JoinCondition>& joinConditions)
+: joinConditions(joinConditions) {
+    // The table joined to a query's tables has the query's parallelism
+    parallelism = table2.getParallelism();
     assignBuildAndProbeTables(table1, table2);
     schema = probeTable->getSchema();
     schema.merge(buildTable->getSchema());
-    if (joinCondition == "") {
-        return;
-    }
-    auto parts = string_util::split(joinCondition, ' ', true);
-    parseJoinCondition(parts);
+    blankRow = Row(buildTable->getSchema());
+    blankRow.fillBlank(buildTable->getSchema().getMetadataForColumns().size());
+    buildJoinTable();
 }
 
 JoinedTable::~JoinedTable() {
@@ -51,22 +45,20 @@ JoinedTable::~JoinedTable() {
 }
 
 JoinedTable& JoinedTable::operator>>(Row& row) {
-    extractRow(row);
-    if (row.getColumns().size() > 0) {
-        row.orderAndFilterColumns(colFilter);
-    }
-    if (distinct) {
-        std::string colValues;
-        for (const auto& col : row.getColumns()) {
-            colValues += col.getMetadata().getColumnName() + "="
-                    + static_cast<std::string> (col) + ";";
-        }
-        if (columnsFound.find(colValues) == columnsFound.end()) {
-            columnsFound.insert(colValues);
+    // Every column is needed to apply the restriction, so filtered rows are
+    // extracted into the scan row first
+    Row& source = colFilter.empty() ? row : scanRow;
+    extractRow(source);
+    if (&source != &row) {
+        if (source.getColumns().size() > 0) {
+            row.copyColumnsFrom(source, colFilter);
         } else {
-            *this >> row;
+            row.clear();
         }
     }
+    if (distinct && !addDistinctRow(row)) {
+        *this >> row;
+    }
     return *this;
 }
 
@@ -74,6 +66,10 @@ void JoinedTable::insertRow(Row& row) {
     throw std::logic_error("Cannot insert rows in a joined table");
 }
 
+void JoinedTable::insertRows(RowVec&) {
+    throw std::logic_error("Cannot insert rows in a joined table");
+}
+
 void JoinedTable::updateRows(UpdateMap& columnsToUpdate) {
     throw std::logic_error("Cannot update rows in a joined table");
 }
@@ -82,34 +78,27 @@ void JoinedTable::deleteRows() {
     throw std::logic_error("Cannot delete rows in a joined table");
 }
 
-Table& JoinedTable::orderBy(const std::string& colNames, bool desc) {
-    if (colNames.empty()) {
-        return *this;
-    }
-    ColumnNames nameVec = string_util::split(colNames, ',');
-    std::vector<Row> rows;
-    Row row;
-    while (*this >> row) {
-        rows.push_back(row);
-    }
-    std::sort(rows.begin(), rows.end(), [&](Row row1, Row row2) {
-        return compareRows(row1, row2, nameVec, desc);
-    });
-    tableStream = std::make_shared<std::stringstream>();
-    unsigned int index = 0;
-    for (const auto& row : rows) {
-        *tableStream << row;
-        if (index != rows.size() - 1) {
-            *tableStream << std::endl;
-        }
-        index++;
+JoinedTable::operator bool() const {
+    if (orderedRows || merge) {
+        return hasRows;
     }
-    hasRows = true;
-    return *this;
+    return *buildTable && *probeTable;
 }
 
-JoinedTable::operator bool() const {
-    return (tableStream && *tableStream) || (*buildTable && *probeTable);
+void JoinedTable::reset() {
+    orderedPosition = 0;
+    hasRows = true;
+    probeTable->reset();
+    probeBatch.reset(probeTable->getSchema());
+    probePosition = 0;
+    nextMatch = 0;
+    nextRowMatch = JoinHashTable::NO_MATCH;
+    if (merge) {
+        // The sorted scans have read their tables, so they are started again
+        buildTable->reset();
+        merge.reset();
+        buildJoinTable();
+    }
 }
 
 unsigned int JoinedTable::getRowCount() const {
@@ -120,100 +109,214 @@ std::shared_ptr<Table> JoinedTable::clone() const {
     return std::make_shared<JoinedTable>(*this);
 }
 
-void JoinedTable::buildJoinMap(const ColNames& colNames) {
+void JoinedTable::setMemoryBudget(std::size_t bytes) {
+    memoryBudget = bytes;
+}
+
+bool JoinedTable::buildsFirst(const Table& table1, const Table& table2) {
+    return table1.getRowCount() <= table2.getRowCount();
+}
+
+std::vector<JoinedTable::JoinCondition> JoinedTable::bindJoinConditions(
+        const Schema& probeSchema, const Schema& buildSchema,
+        const JoinConditions& conditions) {
+    std::vector<JoinCondition> joinConditions;
+    for (const auto& condition : conditions) {
+        if (condition.op != query_ast::Operator::EQUAL) {
+            throw InvalidQueryException("Joins currently only support the ="
+                    " operator");
+        }
+        const std::string& left = condition.left.column;
+        const std::string& right = condition.right.column;
+        // Conditions on other tables in the query are used by other joins
+        if (buildSchema.hasColumn(left) && probeSchema.hasColumn(right)) {
+            joinConditions.push_back({probeSchema.bindColumn(right),
+                    buildSchema.bindColumn(left)});
+        } else if (probeSchema.hasColumn(left) 
+                && buildSchema.hasColumn(right)) {
+            joinConditions.push_back({probeSchema.bindColumn(left),
+                    buildSchema.bindColumn(right)});
+        }
+    }
+    return joinConditions;
+}
+
+void JoinedTable::buildJoinTable() {
+    const MetadataVec& buildColumns =
+            buildTable->getSchema().getMetadataForColumns();
+    const MetadataVec& probeColumns =
+            probeTable->getSchema().getMetadataForColumns();
+    std::vector<unsigned int> buildKeyIndexes;
+    std::vector<bool> typedKeys;
+    probeKeyIndexes.clear();
+    for (const auto& condition : joinConditions) {
+        buildKeyIndexes.push_back(condition.buildIndex);
+        probeKeyIndexes.push_back(condition.probeIndex);
+        // Values of different types are compared as text
+        typedKeys.push_back(buildColumns[condition.buildIndex].getValueType()
+                == probeColumns[condition.probeIndex].getValueType());
+    }
+    // The build table's size is estimated from its row count, as a hash
+    // table holds a Row of Columns for each row
+    std::size_t buildSize = buildTable->getRowCount() * (sizeof(Row)
+            + buildColumns.size() * sizeof(Column));
+    if (buildSize > memoryBudget) {
+        // Each table is read through its own SortedScan
+        merge = std::make_shared<MergeState>(buildTable, probeTable,
+                buildKeyIndexes, probeKeyIndexes, typedKeys,
+                memoryBudget / 2);
+        return;
+    }
+    RowVec rows;
     buildTable->reset();
-    Row row;
-    while (*buildTable >> row) {
-        for (const auto& name : colNames) {
-            try {
-                Column c = row.getColumn(name);
-                joinMap[name + "=" + static_cast<std::string> (c)] = row;
-            } catch (std::invalid_argument& e) {
-            }
+    RowBatch batch;
+    while (buildTable->nextBatch(batch)) {
+        for (unsigned int position : batch.getSelection()) {
+            rows.emplace_back();
+            batch.copyRow(position, rows.back());
         }
     }
     buildTable->reset();
+    joinTable = std::make_shared<JoinHashTable>(std::move(rows),
+            buildKeyIndexes, typedKeys, parallelism);
 }
 
 void JoinedTable::assignBuildAndProbeTables(const Table& table1, 
         const Table& table2) {
-    if (table1.getRowCount() > table2.getRowCount()) {
-        buildTable = table2.clone();
-        probeTable = table1.clone();
-    } else {
+    if (buildsFirst(table1, table2)) {
         buildTable = table1.clone();
         probeTable = table2.clone();
+    } else {
+        buildTable = table2.clone();
+        probeTable = table1.clone();
     }
 }
 
-void JoinedTable::parseJoinCondition(const std::vector<std::string>& parts) {
-    ColumnNames buildTableColumns;
-    for (unsigned int i = 0; i < parts.size();) {
-        if (parts[i + 1] != "=") {
-            throw InvalidQueryException("Joins currently only support the ="
-                    " operator");
-        }
-        if (buildTable->getSchema().hasColumn(parts[i])) {
-            columnMap[parts[i + 2]] = parts[i];
-            buildTableColumns.push_back(parts[i]);
-        } else {
-            columnMap[parts[i]] = parts[i + 2];
-            buildTableColumns.push_back(parts[i + 2]);
+void JoinedTable::extractRow(Row& row) {
+    do {
+        if (orderedRows) {
+            // The rows were restricted before they were ordered
+            if (!readRow(row)) {
+                hasRows = false;
+                row.clear();
+            }
+            return;
         }
-        // Break on last join condition
-        if (i == parts.size() - 3) {
+        if (!(merge ? extractRowMerged(row) : extractRowJoined(row))) {
             break;
         }
-        i += 3;
-    }
-    buildJoinMap(buildTableColumns);
+    } while (!restriction.apply(row));
 }
 
-void JoinedTable::extractRow(Row& row) {
-    do {
-        if (tableStream) {
-            row = Row(schema);
-            *tableStream >> row;
-            continue;
+bool JoinedTable::extractRowJoined(Row& row) {
+    if (nextRowMatch == JoinHashTable::NO_MATCH) {
+        if (!(*probeTable >> probeRow)) {
+            row.clear();
+            return false;
         }
-        if (!(*probeTable >> row)) {
-            break;
+        nextRowMatch = joinTable->findFirst(probeRow, probeKeyIndexes);
+        if (nextRowMatch == JoinHashTable::NO_MATCH) {
+            row = probeRow;
+            row.merge(blankRow);
+            return true;
+        }
+    }
+    row = probeRow;
+    row.merge(joinTable->getRow(nextRowMatch));
+    nextRowMatch = joinTable->getNextMatch(nextRowMatch);
+    return true;
+}
+
+void JoinedTable::readBatch(RowBatch& batch) {
+    if (orderedRows) {
+        Table::readBatch(batch);
+        return;
+    }
+    if (merge) {
+        Row row;
+        while (!batch.isFull()) {
+            if (!extractRowMerged(row)) {
+                return;
+            }
+            batch.appendRow(row);
         }
-        if (joinMap.size() == 0) {
-            Row row2;
-            if (!(*buildTable >> row2)) {
-                buildTable->reset();
-                *buildTable >> row2;
+        return;
+    }
+    const Selection& selection = probeBatch.getSelection();
+    while (!batch.isFull()) {
+        if (probePosition == selection.size()) {
+            if (!probeTable->nextBatch(probeBatch)) {
+                // The probe batch is left empty
+                probePosition = 0;
+                hasRows = false;
+                return;
             }
-            row.merge(row2);
+            joinTable->findAll(probeBatch, probeKeyIndexes, selection,
+                    firstMatches);
+            probePosition = 0;
+            nextMatch = firstMatches[0];
+        }
+        unsigned int position = selection[probePosition];
+        if (nextMatch == JoinHashTable::NO_MATCH) {
+            batch.appendJoinedRow(probeBatch, position, blankRow);
         } else {
-            extractRowJoined(row);
+            batch.appendJoinedRow(probeBatch, position,
+                    joinTable->getRow(nextMatch));
+            nextMatch = joinTable->getNextMatch(nextMatch);
+            if (nextMatch != JoinHashTable::NO_MATCH) {
+                continue;
+            }
         }
-    } while (!restriction.apply(row));
+        if (++probePosition < selection.size()) {
+            nextMatch = firstMatches[probePosition];
+        }
+    }
 }
 
-void JoinedTable::extractRowJoined(Row& row) {
-    bool match = false;
-    for (const auto& col : row.getColumns()) {
-        std::string colName = col.getMetadata().getColumnName();
-        // Ensure proper column name is used
-        if (columnMap.find(colName) == columnMap.end()) {
-            colName = col.getMetadata().getTableName() + "." + colName;
+bool JoinedTable::extractRowMerged(Row& row) {
+    MergeState& state = *merge;
+    if (!state.hasProbeRow) {
+        if (!state.probeScan.nextRow(state.probeRow, state.probeKey)) {
+            hasRows = false;
+            row.clear();
+            return false;
         }
-        std::string colValue = static_cast<std::string> (col);
-        if (columnMap.find(colName) != columnMap.end()
-                && joinMap.find(columnMap[colName] + "=" + colValue)
-                != joinMap.end()) {
-            row.merge(joinMap[columnMap[colName] + "=" + colValue]);
-            match = true;
-            break;
+        // Probe rows with the same key share the group
+        if (!state.started || state.probeKey != state.groupKey) {
+            findMergeGroup();
         }
+        state.hasProbeRow = true;
+        state.groupPosition = 0;
     }
-    if (!match) {
-        auto tmpRow = Row(buildTable->getSchema());
-        tmpRow.fillBlank(buildTable->getSchema().getMetadataForColumns()
-                .size());
-        row.merge(tmpRow);
+    row = state.probeRow;
+    if (state.group.empty()) {
+        row.merge(blankRow);
+        state.hasProbeRow = false;
+    } else {
+        row.merge(state.group[state.groupPosition++]);
+        state.hasProbeRow = state.groupPosition < state.group.size();
     }
+    return true;
 }
 
+void JoinedTable::findMergeGroup() {
+    MergeState& state = *merge;
+    if (!state.started) {
+        state.started = true;
+        state.hasBuildRow = state.buildScan.nextRow(state.buildRow,
+                state.buildKey);
+    }
+    state.group.clear();
+    state.groupKey = state.probeKey;
+    // Both tables are read in key order, so build rows with smaller keys
+    // match no probe rows
+    while (state.hasBuildRow && state.buildKey < state.probeKey) {
+        state.hasBuildRow = state.buildScan.nextRow(state.buildRow,
+                state.buildKey);
+    }
+    while (state.hasBuildRow && state.buildKey == state.probeKey) {
+        state.group.push_back(state.buildRow);
+        state.hasBuildRow = state.buildScan.nextRow(state.buildRow,
+                state.buildKey);
+    }
+}
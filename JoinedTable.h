@@ -8,56 +8,162 @@
 #ifndef JOINEDTABLE_H
 #define JOINEDTABLE_H
 
+#include <memory>
 #include <string>
 #include <vector>
-#include <unordered_map>
+#include "JoinHashTable.h"
 #include "Row.h"
+#include "RowBatch.h"
+#include "SortedScan.h"
 #include "Table.h"
 
-using ColNames = std::vector<std::string>;
-using ProbeToBuildMap = std::unordered_map<std::string, std::string>;
-using UpdateMap = std::unordered_map<std::string, std::string>;
-using JoinMap = std::unordered_map<std::string, Row>;
-
 /**
  * Represents a table that is the result of joining two or more tables. This 
  * table does not support modification of underlying data; calls to any modifier
  * methods inherited from Table will throw an error.
+ * 
+ * Tables are joined on all of the join conditions between them. Each probe
+ * table row is joined to every build table row matching it, in the order of
+ * the build table, or to a blank row if none match. Tables with no join
+ * conditions between them are joined on an empty key, which every row
+ * matches, and the restriction decides which of the rows are kept. The build table is kept
+ * in a hash table if it fits in the memory budget. Otherwise the tables are
+ * joined with a sort-merge join: both are read in the order of their keys
+ * through a SortedScan, which spills sorted runs to temporary files and
+ * does not sort tables already in key order, so the join streams with a
+ * bounded amount of memory and its rows come in the order of the keys.
  */
 class JoinedTable : public Table {
 public:
+    /** A join condition bound to the columns it compares. */
+    struct JoinCondition {
+        unsigned int probeIndex;  // Index of the column in probe table rows
+        unsigned int buildIndex;  // Index of the column in build table rows
+    };
+
+    JoinedTable(const Table& table1, const Table& table2,
+            const JoinConditions& joinConditions);
+
+    /**
+     * Joins two tables on join conditions that have already been bound by
+     * bindJoinConditions() to the schemas of the probe and build tables.
+     *
+     * @param table1 The table being joined to
+     * @param table2 The table joined to it
+     * @param joinConditions The bound conditions; with none, every row of
+     * one table is joined to every row of the other
+     */
     JoinedTable(const Table& table1, const Table& table2,
-            const std::string& joinCondition);
+            const std::vector<JoinCondition>& joinConditions);
     virtual ~JoinedTable() override;
     
     virtual JoinedTable& operator>>(Row& row) override;
     
     virtual void insertRow(Row& row) override;
 
+    virtual void insertRows(RowVec& rows) override;
+
     virtual void updateRows(UpdateMap& columnsToUpdate) override;
     
     virtual void deleteRows() override;
     
-    virtual Table& orderBy(const std::string& colNames, bool desc) override;
-    
     virtual operator bool() const override;
     
+    /**
+     * Starts the join again from the first probe row. The hash table is kept,
+     * while a sort-merge join sorts both tables again.
+     */
+    virtual void reset() override;
+    
     unsigned int getRowCount() const override;
     
     virtual std::shared_ptr<Table> clone() const override;
+    
+    /**
+     * Sets the most memory the build table of a hash join may use. Larger
+     * build tables are joined with a sort-merge join instead.
+     * 
+     * @param bytes The memory budget in bytes
+     */
+    static void setMemoryBudget(std::size_t bytes);
 
+    /**
+     * Checks if the first table is the build table when the tables are
+     * joined, which is the case unless it has more rows.
+     */
+    static bool buildsFirst(const Table& table1, const Table& table2);
+
+    /**
+     * Binds the join conditions between the probe and build tables to the
+     * columns they compare. Conditions on other tables of the query are
+     * left for the joins of those tables.
+     *
+     * @param probeSchema The schema of the probe table
+     * @param buildSchema The schema of the build table
+     * @param conditions The join conditions of the query
+     * @return The bound conditions
+     * @throw InvalidQueryException if a condition does not use =
+     */
+    static std::vector<JoinCondition> bindJoinConditions(
+            const Schema& probeSchema, const Schema& buildSchema,
+            const JoinConditions& conditions);
+
+protected:
+    /**
+     * Joins probe table rows to the build table rows until the batch is
+     * full. The keys of each probe batch are looked up in parallel, and a
+     * probe row whose matches do not fit is continued in the next batch.
+     */
+    virtual void readBatch(RowBatch& batch) override;
     
 private:
+    /** The state of a sort-merge join. */
+    struct MergeState {
+        SortedScan buildScan, probeScan;
+        Row buildRow;  // The next build row not in the group
+        std::string buildKey;
+        bool hasBuildRow = false;
+        bool started = false;  // Whether the first build row was read
+        RowVec group;  // The build rows matching the probe row's key
+        std::string groupKey;
+        Row probeRow;  // The probe row being joined
+        std::string probeKey;
+        bool hasProbeRow = false;  // Whether it has matches left to join
+        unsigned int groupPosition = 0;  // Its next match in the group
+        
+        MergeState(std::shared_ptr<Table> buildTable,
+                std::shared_ptr<Table> probeTable,
+                const std::vector<unsigned int>& buildKeyIndexes,
+                const std::vector<unsigned int>& probeKeyIndexes,
+                const std::vector<bool>& typedKeys, std::size_t memoryBudget)
+                : buildScan(buildTable, buildKeyIndexes, typedKeys,
+                        memoryBudget),
+                  probeScan(probeTable, probeKeyIndexes, typedKeys,
+                        memoryBudget) {}
+    };
+    
+    static std::size_t memoryBudget;
+    
     std::shared_ptr<Table> buildTable, probeTable;
-    ProbeToBuildMap columnMap;
-    JoinMap joinMap;
+    std::vector<JoinCondition> joinConditions;
+    std::vector<unsigned int> probeKeyIndexes;  // Probe column of each one
+    // Build table rows by key, shared by copies of this table
+    std::shared_ptr<const JoinHashTable> joinTable;
+    Row blankRow;  // Joined to probe rows without a match
+    RowBatch probeBatch;  // The probe rows being joined by readBatch
+    std::vector<unsigned int> firstMatches;  // The first match of each one
+    unsigned int probePosition = 0;  // The probe row in the selection
+    unsigned int nextMatch = 0;  // The next match of that probe row
+    Row probeRow;  // The probe row being joined by extractRow
+    unsigned int nextRowMatch = JoinHashTable::NO_MATCH;  // Its next match
+    std::shared_ptr<MergeState> merge;  // Set for sort-merge joins
     
     /**
-     * Builds the join map used in the hash join algorithm for joining tables.
-     * @param colNames The names of the columns in the build table to store
-     * in the map
+     * Builds the hash table used in the hash join algorithm for joining
+     * tables, keyed by the columns of every join condition, or prepares a
+     * sort-merge join if the build table does not fit in the memory budget.
      */
-    void buildJoinMap(const ColNames& colNames);
+    void buildJoinTable();
     
     /** 
      * Assigns the build and probe tables according to the tables being 
@@ -65,21 +171,31 @@ private:
      */
     void assignBuildAndProbeTables(const Table& table1, const Table& table2);
     
-    /**
-     * Parses the join conditions and builds the join map.
-     * 
-     * @param parts The parts of the join condition passed in to the constructor
-     */
-    void parseJoinCondition(const std::vector<std::string>& parts);
-    
     /** Extracts the next row from the table. */
     void extractRow(Row& row);
     
     /** 
      * Extracts the next row according to the join conditions provided
      * to the table.
+     * 
+     * @param row The row to store the joined row in
+     * @return False if there are no more probe rows, true otherwise
+     */
+    bool extractRowJoined(Row& row);
+    
+    /**
+     * Extracts the next row of a sort-merge join.
+     * 
+     * @param row The row to store the joined row in
+     * @return False if there are no more probe rows, true otherwise
+     */
+    bool extractRowMerged(Row& row);
+    
+    /**
+     * Advances the build rows of a sort-merge join to the key of the probe
+     * row, collecting the build rows with that key into the group.
      */
-    void extractRowJoined(Row& row);
+    void findMergeGroup();
 };
 
 #endif /* RESTRICTEDTABLE_H */
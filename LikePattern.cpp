@@ -0,0 +1,94 @@
+/*
+ * File:   LikePattern.cpp
+ * Implementation file for the LikePattern class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <cstring>
+#include <string>
+#include "LikePattern.h"
+
+LikePattern::LikePattern() : shape(Shape::EXACT) {
+    // No implementation needed
+}
+
+LikePattern::LikePattern(const std::string& pattern) : pattern(pattern) {
+    std::size_t start = pattern.find_first_not_of('%');
+    if (start == std::string::npos) {
+        shape = pattern.empty() ? Shape::EXACT : Shape::ANY;
+        return;
+    }
+    std::size_t end = pattern.find_last_not_of('%') + 1;
+    literal = pattern.substr(start, end - start);
+    if (literal.find_first_of("%_") != std::string::npos) {
+        shape = Shape::GENERAL;
+    } else if (start > 0 && end < pattern.size()) {
+        shape = Shape::CONTAINS;
+    } else if (start > 0) {
+        shape = Shape::SUFFIX;
+    } else if (end < pattern.size()) {
+        shape = Shape::PREFIX;
+    } else {
+        shape = Shape::EXACT;
+    }
+}
+
+LikePattern::~LikePattern() {
+    // No implementation needed
+}
+
+bool LikePattern::matches(std::string_view value) const {
+    std::size_t size = literal.size();
+    switch (shape) {
+        case Shape::EXACT:
+            return value.size() == size
+                    && std::memcmp(value.data(), literal.data(), size) == 0;
+        case Shape::PREFIX:
+            return value.size() >= size
+                    && std::memcmp(value.data(), literal.data(), size) == 0;
+        case Shape::SUFFIX:
+            return value.size() >= size && std::memcmp(value.data()
+                    + value.size() - size, literal.data(), size) == 0;
+        case Shape::CONTAINS:
+            // glibc's memmem uses a vectorized two-way search
+            return memmem(value.data(), value.size(), literal.data(), size)
+                    != nullptr;
+        case Shape::ANY:
+            return true;
+        case Shape::GENERAL:
+            break;
+    }
+    return matchGeneral(value);
+}
+
+const std::string& LikePattern::getPattern() const {
+    return pattern;
+}
+
+bool LikePattern::matchGeneral(std::string_view value) const {
+    std::size_t p = 0, v = 0;
+    // The position of the last % and the value position it was matched at
+    std::size_t star = std::string::npos, starValue = 0;
+    while (v < value.size()) {
+        if (p < pattern.size() && (pattern[p] == '_'
+                || pattern[p] == value[v])) {
+            p++;
+            v++;
+        } else if (p < pattern.size() && pattern[p] == '%') {
+            star = p++;
+            starValue = v;
+        } else if (star != std::string::npos) {
+            // Let the last % absorb one more character and try again
+            p = star + 1;
+            v = ++starValue;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '%') {
+        p++;
+    }
+    return p == pattern.size();
+}
+
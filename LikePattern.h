@@ -0,0 +1,54 @@
+/*
+ * File:   LikePattern.h
+ * Header file for the LikePattern class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef LIKEPATTERN_H
+#define LIKEPATTERN_H
+
+#include <string>
+#include <string_view>
+
+/**
+ * A compiled pattern for the LIKE operator, where % matches any sequence of
+ * characters and _ matches any single character. The pattern is examined
+ * once: exact matches, prefixes (abc%), suffixes (%abc) and substrings
+ * (%abc%) are matched with memcmp and memmem, and other patterns with a
+ * backtracking wildcard matcher.
+ */
+class LikePattern {
+public:
+    /** Creates a pattern that only matches the empty string. */
+    LikePattern();
+    explicit LikePattern(const std::string& pattern);
+    ~LikePattern();
+
+    /** Checks if the given value matches the pattern. */
+    bool matches(std::string_view value) const;
+
+    /** Gets the pattern as it was written. */
+    const std::string& getPattern() const;
+
+private:
+    /** The kinds of patterns with a specialized matcher. */
+    enum class Shape : unsigned char {
+        EXACT,     // abc
+        PREFIX,    // abc%
+        SUFFIX,    // %abc
+        CONTAINS,  // %abc%
+        ANY,       // %
+        GENERAL    // Anything else, such as a_c or a%b%c
+    };
+
+    std::string pattern;
+    std::string literal;  // The pattern without % for specialized shapes
+    Shape shape;
+
+    /** Matches the value against a pattern of any shape. */
+    bool matchGeneral(std::string_view value) const;
+};
+
+#endif /* LIKEPATTERN_H */
+
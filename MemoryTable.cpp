@@ -0,0 +1,113 @@
+/*
+ * File:   MemoryTable.cpp
+ * Implementation file for the MemoryTable class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <string>
+#include "InvalidQueryException.h"
+#include "MemoryTable.h"
+#include "RowBatch.h"
+#include "table_io_util.h"
+
+MemoryTable::MemoryTable(const std::string& tableName,
+        const std::shared_ptr<MemoryTableData>& data) : data(data) {
+    this->tableName = tableName;
+    schema = data->schema;
+    rowCount = data->rows.size();
+}
+
+MemoryTable::~MemoryTable() {
+    // No implementation needed
+}
+
+void MemoryTable::deleteRows() {
+    writeUndeletedRows();
+}
+
+void MemoryTable::reset() {
+    position = 0;
+    orderedPosition = 0;
+    hasRows = true;
+}
+
+unsigned int MemoryTable::getRowCount() const {
+    return data->rows.size();
+}
+
+std::shared_ptr<Table> MemoryTable::clone() const {
+    return std::make_shared<MemoryTable>(*this);
+}
+
+bool MemoryTable::readRow(Row& row) {
+    if (orderedRows) {
+        return Table::readRow(row);
+    }
+    if (position >= data->rows.size()) {
+        return false;
+    }
+    row = data->rows[position++];
+    return true;
+}
+
+void MemoryTable::readBatch(RowBatch& batch) {
+    if (orderedRows) {
+        Table::readBatch(batch);
+        return;
+    }
+    // Rows are copied straight from the stored rows into the batch
+    const RowVec& rows = data->rows;
+    while (position < rows.size() && !batch.isFull()) {
+        batch.appendRow(rows[position++]);
+    }
+    hasRows = position < rows.size();
+}
+
+void MemoryTable::appendRows(const RowVec& rows) {
+    data->rows.insert(data->rows.end(), rows.begin(), rows.end());
+}
+
+void MemoryTable::checkForDuplicateValue(const std::string& value,
+        const unsigned int index) {
+    for (auto& row : data->rows) {
+        if (static_cast<std::string> (row[index]) == value) {
+            throw InvalidQueryException("Primary key must be unique");
+        }
+    }
+}
+
+void MemoryTable::writeUpdatedRows(const UpdateMap& columnsToUpdate) {
+    // Build the new contents first so that a failed validation leaves the
+    // table unchanged
+    BoundUpdateVec updates = bindUpdates(columnsToUpdate);
+    RowVec updatedRows = data->rows;
+    for (auto& row : updatedRows) {
+        if (!restriction.apply(row)) {
+            continue;
+        }
+        for (unsigned int i = 0; i < row.getColumns().size(); i++) {
+            if (updates[i]) {
+                const ColumnMetadata& metadata = row[i].getMetadata();
+                table_io_util::validateReferencedBy(metadata, row[i]);
+                row[i].setValue(*updates[i], &metadata);
+            }
+        }
+    }
+    data->rows.swap(updatedRows);
+}
+
+void MemoryTable::writeUndeletedRows() {
+    RowVec undeletedRows;
+    for (const auto& row : data->rows) {
+        if (!restriction.apply(row)) {
+            undeletedRows.push_back(row);
+            continue;
+        }
+        for (const auto& col : row.getColumns()) {
+            table_io_util::validateReferencedBy(col.getMetadata(), col);
+        }
+    }
+    data->rows.swap(undeletedRows);
+    rowCount = data->rows.size();
+}
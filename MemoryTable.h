@@ -0,0 +1,64 @@
+/*
+ * File:   MemoryTable.h
+ * Header file for the MemoryTable class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef MEMORYTABLE_H
+#define MEMORYTABLE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Row.h"
+#include "Schema.h"
+#include "Table.h"
+
+/** The contents of a table stored in memory. */
+struct MemoryTableData {
+    Schema schema;
+    RowVec rows;
+};
+
+/**
+ * A table whose rows are kept in memory instead of in a file. Used for
+ * temporary tables and when the whole database runs in memory. Every
+ * MemoryTable opened on the same data sees the changes made through the
+ * others.
+ */
+class MemoryTable : public Table {
+public:
+    MemoryTable(const std::string& tableName,
+            const std::shared_ptr<MemoryTableData>& data);
+    virtual ~MemoryTable() override;
+
+    virtual void deleteRows() override;
+
+    virtual void reset() override;
+
+    virtual unsigned int getRowCount() const override;
+
+    virtual std::shared_ptr<Table> clone() const override;
+
+protected:
+    virtual bool readRow(Row& row) override;
+
+    virtual void readBatch(RowBatch& batch) override;
+
+    virtual void appendRows(const RowVec& rows) override;
+
+    virtual void checkForDuplicateValue(const std::string& value,
+            const unsigned int index) override;
+
+    virtual void writeUpdatedRows(const UpdateMap& columnsToUpdate) override;
+
+    virtual void writeUndeletedRows() override;
+
+private:
+    std::shared_ptr<MemoryTableData> data;
+    unsigned int position = 0;
+};
+
+#endif /* MEMORYTABLE_H */
+
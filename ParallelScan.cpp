@@ -0,0 +1,111 @@
+/*
+ * File:   ParallelScan.cpp
+ * Implementation file for the ParallelScan class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <utility>
+#include "ParallelScan.h"
+#include "Row.h"
+#include "ThreadPool.h"
+
+ParallelScan::ParallelScan(const std::string& path, const Schema& schema,
+        const Restriction& restriction, unsigned int parallelism)
+        : reader(ScanReader::open(path)), schema(schema),
+          restriction(restriction) {
+    morselLimit = ThreadPool::getShared().getParallelism(parallelism);
+}
+
+ParallelScan::~ParallelScan() {
+    // Morsels still in flight own their data, so they are not waited for
+}
+
+bool ParallelScan::nextBatch(RowBatch& batch) {
+    while (batchPosition == batches.size()) {
+        submitMorsels();
+        if (morsels.empty()) {
+            return false;
+        }
+        // The calling thread helps with the queued morsels while it waits
+        ThreadPool::getShared().wait(morsels.front());
+        batches = morsels.front().get();
+        morsels.pop_front();
+        batchPosition = 0;
+        // The next morsel is decoded while these batches are consumed
+        submitMorsels();
+    }
+    batch = std::move(batches[batchPosition++]);
+    return true;
+}
+
+void ParallelScan::submitMorsels() {
+    ThreadPool& pool = ThreadPool::getShared();
+    while (reader && morsels.size() < morselLimit) {
+        const char* data;
+        std::size_t size;
+        std::string text;
+        if (!reader->nextBlock(data, size)) {
+            reader.reset();
+            text.swap(partialRow);
+        } else {
+            // The morsel ends at the last row boundary in the block
+            const char* end = data + size;
+            const char* boundary = end;
+            while (boundary != data && boundary[-1] != '\n') {
+                boundary--;
+            }
+            if (boundary == data) {
+                partialRow.append(data, size);  // No row ends in the block
+                continue;
+            }
+            text = std::move(partialRow);
+            text.append(data, boundary);
+            partialRow.assign(boundary, end);
+        }
+        if (!headerSkipped) {
+            std::size_t headerEnd = text.find('\n');
+            text.erase(0, headerEnd == std::string::npos ? text.size()
+                    : headerEnd + 1);
+            headerSkipped = true;
+        }
+        if (text.empty()) {
+            continue;
+        }
+        // Each morsel owns its rows and its copies of the schema and the
+        // restriction, since a restriction cannot be shared between threads
+        morsels.push_back(pool.submit([text = std::move(text),
+                schema = schema, restriction = restriction]() mutable {
+            return scanMorsel(text, schema, restriction);
+        }));
+    }
+}
+
+std::vector<RowBatch> ParallelScan::scanMorsel(const std::string& text,
+        const Schema& schema, Restriction& restriction) {
+    std::vector<RowBatch> batches;
+    RowBatch batch;
+    batch.reset(schema);
+    Row row(schema);
+    std::string line;
+    std::size_t start = 0;
+    while (start < text.size()) {
+        std::size_t end = text.find('\n', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        line.assign(text, start, end - start);
+        row.decodeLine(line);
+        batch.appendRow(row);
+        start = end + 1;
+        if (batch.isFull() || start >= text.size()) {
+            restriction.apply(batch);
+            if (!batch.getSelection().empty()) {
+                batches.push_back(std::move(batch));
+                batch = RowBatch();
+            }
+            batch.reset(schema);
+        }
+    }
+    return batches;
+}
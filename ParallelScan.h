@@ -0,0 +1,90 @@
+/*
+ * File:   ParallelScan.h
+ * Header file for the ParallelScan class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef PARALLELSCAN_H
+#define PARALLELSCAN_H
+
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Restriction.h"
+#include "RowBatch.h"
+#include "ScanReader.h"
+#include "Schema.h"
+
+/**
+ * A morsel-driven scan of a table file. The file is read in blocks, and each
+ * block, cut at the last row boundary in it, is a morsel: a task on the
+ * shared ThreadPool that decodes its rows into batches and filters them with
+ * its own copy of the restriction. One morsel for each degree of
+ * parallelism is kept in flight ahead of the caller, and their batches are
+ * returned in the order of the file, so a scan returns the same rows in the
+ * same order as a sequential one.
+ */
+class ParallelScan {
+public:
+    /**
+     * Starts scanning a table file.
+     *
+     * @param path The path of the table file, whose first line is the schema
+     * @param schema The schema of the rows in the file
+     * @param restriction The restriction the rows must match, bound to the
+     * schema. It is copied, so it may be changed once the scan has started.
+     * @param parallelism The most morsels decoded at once, or 0 for one per
+     * thread of the pool
+     */
+    ParallelScan(const std::string& path, const Schema& schema,
+            const Restriction& restriction, unsigned int parallelism = 0);
+    ~ParallelScan();
+
+    ParallelScan(const ParallelScan&) = delete;
+    ParallelScan& operator=(const ParallelScan&) = delete;
+
+    /**
+     * Gets the next batch of rows. Rows that do not match the restriction
+     * are already removed from the batch's selection, and the selection of
+     * a batch that is returned is never empty.
+     *
+     * @param batch Set to the next batch
+     * @return False if there are no more rows, true otherwise
+     */
+    bool nextBatch(RowBatch& batch);
+
+private:
+    using Morsel = std::future<std::vector<RowBatch>>;
+
+    std::unique_ptr<ScanReader> reader;  // Null once the file is read
+    Schema schema;
+    Restriction restriction;
+    std::string partialRow;  // The start of a row cut off by the last block
+    bool headerSkipped = false;
+    std::deque<Morsel> morsels;  // The morsels in flight, in file order
+    std::vector<RowBatch> batches;  // The batches of the finished morsel
+    std::size_t batchPosition = 0;  // The next of those batches to return
+    std::size_t morselLimit;  // The most morsels kept in flight
+
+    /** Submits morsels until enough are in flight or the file is read. */
+    void submitMorsels();
+
+    /**
+     * Decodes the rows of a morsel into batches and filters them. Run by the
+     * threads of the pool.
+     *
+     * @param text The rows of the morsel, one per line
+     * @param schema The schema of the rows
+     * @param restriction The restriction, owned by the morsel
+     * @return The batches with at least one row matching the restriction
+     */
+    static std::vector<RowBatch> scanMorsel(const std::string& text,
+            const Schema& schema, Restriction& restriction);
+};
+
+#endif /* PARALLELSCAN_H */
+
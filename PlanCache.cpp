@@ -0,0 +1,138 @@
+/*
+ * File:   PlanCache.cpp
+ * Implementation file for the PlanCache class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+#include "PlanCache.h"
+#include "PreparedStatement.h"
+#include "query_ast.h"
+#include "query_lexer.h"
+#include "Query.h"
+#include "Result.h"
+#include "string_util.h"
+#include "table_io_util.h"
+
+// Helper functions
+namespace {
+    using query_ast::Literal;
+    using query_lexer::Keyword;
+
+    /** Checks if queries of the type starting with the keyword are cached. */
+    bool isCacheable(Keyword keyword) {
+        return keyword == Keyword::SELECT || keyword == Keyword::INSERT
+                || keyword == Keyword::UPDATE || keyword == Keyword::DELETE;
+    }
+
+    /**
+     * Normalizes a query, replacing its quoted strings and numbers with ?.
+     *
+     * @param queryString The query
+     * @param key Set to the normalized text
+     * @param values Set to the values that were replaced, in order
+     * @return False if the query cannot be cached
+     */
+    bool normalize(const std::string& queryString, std::string& key,
+            std::vector<Literal>& values) {
+        query_lexer::TokenVec tokens;
+        if (!query_lexer::tokenize(queryString, tokens) || tokens.empty()
+                || !isCacheable(tokens[0].keyword)) {
+            return false;
+        }
+        key.reserve(queryString.size());
+        for (const auto& token : tokens) {
+            if (query_lexer::isParameter(token)) {
+                // Rejected when the query is parsed
+                return false;
+            }
+            if (!key.empty()) {
+                key += ' ';
+            }
+            if (query_lexer::isQuoted(token)
+                    || query_lexer::isNumeric(token)) {
+                values.push_back(query_ast::makeLiteral(token.text));
+                key += '?';
+            } else if (token.keyword != Keyword::NONE) {
+                key += string_util::toLowercase(std::string(token.text));
+            } else {
+                key += token.text;
+            }
+        }
+        return true;
+    }
+}  // namespace
+
+PlanCache::PlanCache(std::size_t capacity) : capacity(capacity) {
+    // No implementation needed
+}
+
+PlanCache::~PlanCache() {
+    // No implementation needed
+}
+
+Result PlanCache::execute(const std::string& queryString) {
+    std::string key;
+    std::vector<Literal> values;
+    if (capacity == 0 || !normalize(queryString, key, values)) {
+        return Query(queryString).execute();
+    }
+    auto statement = find(key);
+    if (statement) {
+        hits++;
+        return statement->execute(values);
+    }
+    misses++;
+    try {
+        statement = std::make_shared<PreparedStatement>(key);
+    } catch (const std::exception&) {
+        // Invalid queries, and the few that are not valid with their values
+        // replaced (such as a number in a list of columns), are executed as
+        // written so that they fail or succeed as they would uncached
+        return Query(queryString).execute();
+    }
+    add(key, statement);
+    return statement->execute(values);
+}
+
+unsigned long PlanCache::getHits() const {
+    return hits;
+}
+
+unsigned long PlanCache::getMisses() const {
+    return misses;
+}
+
+std::size_t PlanCache::size() const {
+    return entries.size();
+}
+
+std::shared_ptr<const PreparedStatement> PlanCache::find(
+        const std::string& key) {
+    auto indexEntry = entryIndex.find(key);
+    if (indexEntry == entryIndex.end()) {
+        return nullptr;
+    }
+    auto entry = indexEntry->second;
+    if (entry->catalogVersion != table_io_util::getCatalogVersion()) {
+        entryIndex.erase(indexEntry);
+        entries.erase(entry);
+        return nullptr;
+    }
+    entries.splice(entries.begin(), entries, entry);
+    return entry->statement;
+}
+
+void PlanCache::add(const std::string& key,
+        std::shared_ptr<const PreparedStatement> statement) {
+    if (entries.size() >= capacity) {
+        entryIndex.erase(entries.back().key);
+        entries.pop_back();
+    }
+    entries.push_front({key, statement, table_io_util::getCatalogVersion()});
+    entryIndex[key] = entries.begin();
+}
@@ -0,0 +1,97 @@
+/*
+ * File:   PlanCache.h
+ * Header file for the PlanCache class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef PLANCACHE_H
+#define PLANCACHE_H
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "PreparedStatement.h"
+#include "query_ast.h"
+#include "Result.h"
+
+/**
+ * A bounded cache of parsed queries, so that a query sent again is not
+ * parsed again.
+ *
+ * Queries are looked up by their normalized text: the tokens of the query
+ * separated by single spaces, with keywords in lowercase and every quoted
+ * string and number replaced by the parameter ?. Queries that differ only
+ * in their values therefore share an entry, which holds the query parsed as
+ * a prepared statement. Its plan is bound to the tables of the query on the
+ * first execution and reused afterwards, with the values filled in as its
+ * parameters.
+ *
+ * Only SELECT, INSERT, UPDATE and DELETE queries are cached. Entries made
+ * before a table was created or dropped are parsed and bound again, and the
+ * least recently used entry is evicted when the cache is full.
+ */
+class PlanCache {
+public:
+    /** The number of entries kept when no capacity is given. */
+    static const std::size_t DEFAULT_CAPACITY = 256;
+
+    /**
+     * Creates an empty cache.
+     *
+     * @param capacity The number of entries kept; 0 disables the cache
+     */
+    PlanCache(std::size_t capacity = DEFAULT_CAPACITY);
+    ~PlanCache();
+
+    /**
+     * Executes a query, using the cached plan for its normalized text if
+     * there is one.
+     *
+     * @param queryString The query
+     * @return The result of the query
+     * @throw InvalidQueryException if the query is invalid
+     */
+    Result execute(const std::string& queryString);
+
+    /** Gets the number of queries executed from a cached plan. */
+    unsigned long getHits() const;
+
+    /** Gets the number of cacheable queries that had to be parsed. */
+    unsigned long getMisses() const;
+
+    /** Gets the number of entries in the cache. */
+    std::size_t size() const;
+
+private:
+    struct Entry {
+        std::string key;  // The normalized query text
+        std::shared_ptr<const PreparedStatement> statement;
+        unsigned long catalogVersion;  // The version it was parsed at
+    };
+    using EntryList = std::list<Entry>;
+
+    std::size_t capacity;
+    EntryList entries;  // Most recently used first
+    std::unordered_map<std::string, EntryList::iterator> entryIndex;
+    unsigned long hits = 0;
+    unsigned long misses = 0;
+
+    /**
+     * Finds the entry for the given normalized text, moving it to the front
+     * of the list.
+     *
+     * @return The statement, or nullptr if there is no current entry
+     */
+    std::shared_ptr<const PreparedStatement> find(const std::string& key);
+
+    /** Adds an entry, evicting the least recently used one if needed. */
+    void add(const std::string& key,
+            std::shared_ptr<const PreparedStatement> statement);
+};
+
+#endif /* PLANCACHE_H */
+
@@ -0,0 +1,100 @@
+/*
+ * File:   PreadScanReader.cpp
+ * Implementation file for the PreadScanReader class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <fcntl.h>
+#include <algorithm>
+#include <mutex>
+#include "constants.h"
+#include "PreadScanReader.h"
+
+PreadScanReader::PreadScanReader(int fd, std::size_t fileSize)
+: ScanReader(fd, fileSize), blocks(SCAN_QUEUE_DEPTH) {
+    // Left uninitialized since every byte handed out is read from the file
+    std::size_t blockSize = std::min(SCAN_BLOCK_SIZE, fileSize);
+    for (auto& block : blocks) {
+        block.buffer.reset(new char[blockSize]);
+    }
+    reader = std::thread(&PreadScanReader::readBlocks, this);
+}
+
+PreadScanReader::~PreadScanReader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    blockReleased.notify_all();
+    reader.join();
+}
+
+bool PreadScanReader::nextBlock(const char*& data, std::size_t& size) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (holdingBlock) {
+        // Hand the block returned by the previous call back to the reader
+        blocks[current].filled = false;
+        current = (current + 1) % blocks.size();
+        holdingBlock = false;
+        blockReleased.notify_one();
+    }
+    blockFilled.wait(lock, [this] {
+        return blocks[current].filled || finished;
+    });
+    if (!blocks[current].filled) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return false;
+    }
+    data = blocks[current].buffer.get();
+    size = blocks[current].size;
+    holdingBlock = true;
+    return true;
+}
+
+void PreadScanReader::readBlocks() {
+    std::size_t offset = 0;
+    unsigned int index = 0;
+    try {
+        while (offset < fileSize) {
+            Block& block = blocks[index];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                blockReleased.wait(lock, [&] {
+                    return !block.filled || stopping;
+                });
+                if (stopping) {
+                    return;
+                }
+            }
+            // The block is owned by this thread until it is marked filled
+            std::size_t count = std::min(SCAN_BLOCK_SIZE, fileSize - offset);
+            // Have the kernel start on the blocks that will be read next
+            posix_fadvise(fd, offset + count, SCAN_BLOCK_SIZE * blocks.size(),
+                    POSIX_FADV_WILLNEED);
+            block.size = readFully(block.buffer.get(), count, offset);
+            offset += count;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                block.filled = block.size > 0;
+            }
+            blockFilled.notify_one();
+            if (block.size < count) {
+                // The file was truncated while it was being scanned
+                break;
+            }
+            index = (index + 1) % blocks.size();
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = std::current_exception();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    blockFilled.notify_one();
+}
+
@@ -0,0 +1,53 @@
+/*
+ * File:   PreadScanReader.h
+ * Header file for the PreadScanReader class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef PREADSCANREADER_H
+#define PREADSCANREADER_H
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ScanReader.h"
+
+/**
+ * A scan reader that uses a dedicated thread issuing blocking pread() calls
+ * to fill a bounded queue of buffers ahead of the caller, so the caller parses
+ * one block while the next ones are read. The kernel is asked to read ahead
+ * of the queue as well. Used in PREFETCH mode and when io_uring is not
+ * available.
+ */
+class PreadScanReader : public ScanReader {
+public:
+    PreadScanReader(int fd, std::size_t fileSize);
+    virtual ~PreadScanReader() override;
+
+    virtual bool nextBlock(const char*& data, std::size_t& size) override;
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> buffer;
+        std::size_t size = 0;
+        bool filled = false;
+    };
+
+    std::vector<Block> blocks;
+    std::mutex mutex;
+    std::condition_variable blockFilled, blockReleased;
+    std::exception_ptr error;
+    unsigned int current = 0;
+    bool holdingBlock = false, finished = false, stopping = false;
+    std::thread reader;
+
+    /** The body of the reader thread. */
+    void readBlocks();
+};
+
+#endif /* PREADSCANREADER_H */
+
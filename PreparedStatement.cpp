@@ -0,0 +1,198 @@
+/*
+ * File:   PreparedStatement.cpp
+ * Implementation file for the PreparedStatement class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+#include "InvalidQueryException.h"
+#include "PreparedStatement.h"
+#include "query_ast.h"
+#include "Query.h"
+#include "QueryPlan.h"
+#include "Result.h"
+
+// Helper variables and functions
+namespace {
+    using query_ast::Expression;
+    using query_ast::ExpressionPtr;
+    using query_ast::Literal;
+
+    /** The prepared statements stored by PREPARE queries, by name. */
+    std::unordered_map<std::string, std::shared_ptr<const PreparedStatement>>
+            preparedStatements;
+
+    /**
+     * Visits the parameters of a statement in the order they appear in the
+     * query, so that ? parameters can be numbered in that order.
+     */
+    template <typename Visit>
+    class ParameterVisitor {
+    public:
+        ParameterVisitor(Visit visitParameter)
+        : visitParameter(visitParameter) {
+            // No implementation needed
+        }
+
+        void visit(query_ast::Statement& statement) {
+            if (auto insert
+                    = std::get_if<query_ast::InsertStatement>(&statement)) {
+                for (auto& row : insert->rows) {
+                    for (auto& value : row) {
+                        visit(value);
+                    }
+                }
+            } else if (auto update
+                    = std::get_if<query_ast::UpdateStatement>(&statement)) {
+                for (auto& assignment : update->assignments) {
+                    visit(assignment.second);
+                }
+                visit(update->restriction);
+            } else if (auto deleteStatement
+                    = std::get_if<query_ast::DeleteStatement>(&statement)) {
+                visit(deleteStatement->restriction);
+            } else if (auto select
+                    = std::get_if<query_ast::SelectStatement>(&statement)) {
+                visit(select->restriction);
+            }
+        }
+
+    private:
+        Visit visitParameter;
+
+        void visit(Literal& literal) {
+            if (literal.kind == Literal::Kind::PARAMETER) {
+                visitParameter(literal);
+            }
+        }
+
+        void visit(Expression& expression) {
+            if (expression.kind == Expression::Kind::COMPARISON) {
+                if (!expression.comparison.left.isColumn) {
+                    visit(expression.comparison.left.literal);
+                }
+                if (!expression.comparison.right.isColumn) {
+                    visit(expression.comparison.right.literal);
+                }
+                return;
+            }
+            for (auto& child : expression.children) {
+                visit(child);
+            }
+        }
+
+        /** Visits a copy of the restriction, which is shared. */
+        void visit(ExpressionPtr& restriction) {
+            if (restriction) {
+                auto copy = std::make_shared<Expression>(*restriction);
+                visit(*copy);
+                restriction = copy;
+            }
+        }
+    };
+
+    /** Calls visit on each parameter of the statement, in query order. */
+    template <typename Visit>
+    void visitParameters(query_ast::Statement& statement, Visit visit) {
+        ParameterVisitor<Visit>(visit).visit(statement);
+    }
+}  // namespace
+
+PreparedStatement::PreparedStatement(const std::string& queryString)
+: query(queryString) {
+    if (query.getType() == Query::QueryType::PREPARE
+            || query.getType() == Query::QueryType::EXECUTE) {
+        throw InvalidQueryException("Cannot prepare a PREPARE or EXECUTE "
+                "query");
+    }
+    parameterCount = query.getParameterCount();
+    query_ast::Statement statement = query.getStatement();
+    unsigned int next = 0;
+    visitParameters(statement, [&next](Literal& literal) {
+        if (literal.parameter == 0) {
+            literal.parameter = ++next;
+        }
+    });
+    query = Query(query.getType(), statement);
+    if (QueryPlan::supports(query)) {
+        plan = std::make_shared<QueryPlan>(query);
+    }
+}
+
+PreparedStatement::~PreparedStatement() {
+    // No implementation needed
+}
+
+unsigned int PreparedStatement::getParameterCount() const {
+    return parameterCount;
+}
+
+Query PreparedStatement::bind(const std::vector<Literal>& arguments) const {
+    checkArguments(arguments);
+    query_ast::Statement statement = query.getStatement();
+    if (!arguments.empty()) {
+        visitParameters(statement, [&arguments](Literal& literal) {
+            literal = arguments.at(literal.parameter - 1);
+        });
+    }
+    return Query(query.getType(), statement);
+}
+
+bool PreparedStatement::executePlan(const std::vector<Literal>& arguments,
+        std::shared_ptr<Table>& table) const {
+    if (!plan) {
+        return false;
+    }
+    checkArguments(arguments);
+    plan->execute(arguments, table);
+    return true;
+}
+
+Result PreparedStatement::execute(const std::vector<Literal>& arguments)
+        const {
+    return Result(*this, arguments);
+}
+
+Result PreparedStatement::execute(
+        const std::vector<std::string>& arguments) const {
+    std::vector<Literal> literals;
+    for (const auto& argument : arguments) {
+        literals.push_back(query_ast::makeLiteral(argument));
+    }
+    return execute(literals);
+}
+
+void PreparedStatement::add(const std::string& name,
+        std::shared_ptr<const PreparedStatement> statement) {
+    preparedStatements[name] = statement;
+}
+
+std::shared_ptr<const PreparedStatement> PreparedStatement::find(
+        const std::string& name) {
+    auto entry = preparedStatements.find(name);
+    if (entry == preparedStatements.end()) {
+        throw InvalidQueryException("Prepared statement " + name
+                + " does not exist");
+    }
+    return entry->second;
+}
+
+void PreparedStatement::checkArguments(const std::vector<Literal>& arguments)
+        const {
+    if (arguments.size() != getParameterCount()) {
+        throw InvalidQueryException("Expected "
+                + std::to_string(getParameterCount()) + " values but got "
+                + std::to_string(arguments.size()));
+    }
+    for (const auto& argument : arguments) {
+        if (argument.kind == Literal::Kind::PARAMETER) {
+            throw InvalidQueryException("Cannot bind a parameter to a "
+                    "parameter");
+        }
+    }
+}
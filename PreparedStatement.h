@@ -0,0 +1,118 @@
+/*
+ * File:   PreparedStatement.h
+ * Header file for the PreparedStatement class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef PREPAREDSTATEMENT_H
+#define PREPAREDSTATEMENT_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "query_ast.h"
+#include "QueryPlan.h"
+#include "Query.h"
+#include "Result.h"
+
+/**
+ * A query that is parsed once and executed many times with different
+ * values. The values are written in the query as parameters, either ? (one
+ * per value, in order) or $n (the nth value); ? parameters are numbered
+ * when the query is parsed. SELECT queries on local tables, INSERT, UPDATE
+ * and DELETE queries are executed through a QueryPlan, which binds their
+ * columns, restriction and join conditions once and fills in the values on
+ * each execution. Other queries bind the values into a copy of the parsed
+ * statement, so the query string is never parsed again.
+ *
+ * Prepared statements can also be named and stored for the PREPARE and
+ * EXECUTE queries.
+ */
+class PreparedStatement {
+public:
+    /**
+     * Parses a query with parameters.
+     *
+     * @param queryString The query
+     * @throw InvalidQueryException if the query is invalid
+     */
+    PreparedStatement(const std::string& queryString);
+    ~PreparedStatement();
+
+    /** Gets the number of values the statement is executed with. */
+    unsigned int getParameterCount() const;
+
+    /**
+     * Binds values to the parameters.
+     *
+     * @param arguments The values, in the order of the parameters
+     * @return The query with the values in place of the parameters
+     * @throw InvalidQueryException if the number of values does not match
+     * the number of parameters
+     */
+    Query bind(const std::vector<query_ast::Literal>& arguments) const;
+
+    /**
+     * Executes the bound plan of the statement with the given values, if
+     * the statement has one.
+     *
+     * @param arguments The values, in the order of the parameters
+     * @param table Set to the table the rows of a SELECT are extracted from
+     * @return False if the statement has no plan, in which case it must be
+     * executed by binding the values with bind()
+     * @throw InvalidQueryException if the number of values does not match
+     * the number of parameters, or the query is invalid
+     */
+    bool executePlan(const std::vector<query_ast::Literal>& arguments,
+            std::shared_ptr<Table>& table) const;
+
+    /**
+     * Executes the statement with the given values.
+     *
+     * @param arguments The values, in the order of the parameters
+     * @return The result of the query
+     */
+    Result execute(const std::vector<query_ast::Literal>& arguments) const;
+
+    /**
+     * Binds values to the parameters and executes the query.
+     *
+     * @param arguments The values, in the order of the parameters, written
+     * as in a query (e.g. 5, "text", or null)
+     * @return The result of the query
+     */
+    Result execute(const std::vector<std::string>& arguments) const;
+
+    /**
+     * Stores a prepared statement under the given name, replacing any
+     * statement stored under it before.
+     */
+    static void add(const std::string& name,
+            std::shared_ptr<const PreparedStatement> statement);
+
+    /**
+     * Finds the prepared statement stored under the given name.
+     *
+     * @throw InvalidQueryException if there is no such statement
+     */
+    static std::shared_ptr<const PreparedStatement> find(
+            const std::string& name);
+
+private:
+    Query query;  // With every parameter numbered $n
+    unsigned int parameterCount;
+    std::shared_ptr<QueryPlan> plan;  // Bound on the first execution
+
+    /**
+     * Checks the values bound to the parameters.
+     *
+     * @throw InvalidQueryException if the number of values does not match
+     * the number of parameters, or a value is a parameter
+     */
+    void checkArguments(const std::vector<query_ast::Literal>& arguments)
+            const;
+};
+
+#endif /* PREPAREDSTATEMENT_H */
+
@@ -4,10 +4,12 @@
  *
  * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
  */
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
 #include <regex>
 #include <set>
-#include <sstream>
-#include <stack>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -15,57 +17,29 @@
 #include "constants.h"
 #include "InvalidQueryException.h"
 #include "Query.h"
+#include "query_ast.h"
+#include "query_lexer.h"
 #include "Result.h"
+#include "result_writer.h"
 #include "Schema.h"
 #include "string_util.h"
 
-using QueryParts = std::vector<std::string>;
-using StringVec = std::vector<std::string>;
+using query_ast::Comparison;
+using query_ast::Expression;
+using query_ast::ExpressionPtr;
+using query_ast::Literal;
+using query_ast::Operand;
+using query_ast::Operator;
+using query_lexer::isNumeric;
+using query_lexer::isParameter;
+using query_lexer::isQuoted;
+using query_lexer::Keyword;
+using query_lexer::Token;
+using query_lexer::TokenVec;
 
 // Helper functions
 namespace {
 
-    /**
-     * Formats the given query string to prepare it for parsing.
-     * 
-     * @param query The query string
-     */
-    void formatQuery(std::string& query) {
-        std::string charsToSeparate = "(,);=";
-        std::ostringstream os;
-        char quoteChar = '\0';
-        bool escaped = false, quoted = false, whitespaceFound = false;
-        for (const auto& c : query) {
-            if (c == '\\') {
-                escaped = !escaped;
-                os << c;
-            } else {
-                // Trim extra spaces
-                if (c == ' ' && whitespaceFound && !quoted) {
-                    continue;
-                }
-                if ((c == '"' || c == '\'') && !escaped) {
-                    if (quoteChar == '\0' || quoteChar == c) {
-                        quoted = !quoted;
-                        quoteChar = (quoteChar == '\0' ? c : '\0');
-                    }
-                }
-                escaped = false;
-                if (!quoted && (charsToSeparate.find(c) != std::string::npos)) {
-                    os << (whitespaceFound ? "" : " ") << c
-                            << (c != ';' ? " " : "");
-                } else {
-                    os << c;
-                }
-            }
-            whitespaceFound = (os.str().back() == ' ');
-        }
-        query = os.str();
-        query = string_util::replace(query, "< =", "<=");
-        query = string_util::replace(query, "> =", ">=");
-        query = string_util::replace(query, "! =", "!=");
-    }
-
     /** 
      * Makes sure the given column metadata is valid in the context of the
      * table's schema (i.e., there is only one primary key and column names are
@@ -117,7 +91,7 @@ namespace {
      * Gets the options for a column (e.g. if the column is a primary key or is
      * not null) from a query.
      * 
-     * @param parts The parts of the query string, split by spaces
+     * @param tokens The tokens of the query
      * @param index The current index being examined. This value will be
      * updated by this function.
      * @param colName The name of the column
@@ -126,29 +100,31 @@ namespace {
      * @param notNull A boolean to store whether or not this column can contain
      * null values
      */
-    void extractColumnOptions(const QueryParts& parts, unsigned int& index,
+    void extractColumnOptions(const TokenVec& tokens, unsigned int& index,
             const std::string& colName,
             std::string& references, bool& notNull) {
-        while (parts[index] != "," && index < parts.size() - 2) {
-            if (string_util::toLowercase(parts[index]) == "not") {
-                if (string_util::toLowercase(parts[index + 1]) == "null") {
+        while (tokens[index] != "," && index < tokens.size() - 2) {
+            if (tokens[index].keyword == Keyword::NOT) {
+                if (tokens[index + 1].keyword == Keyword::NULL_VALUE) {
                     notNull = true;
                     index += 2;
                 } else {
                     throw InvalidQueryException("Expected 'null' for column "
                             + colName);
                 }
-            } else if (string_util::toLowercase(parts[index]) == "references") {
-                if (parts[index + 1] == "(" && parts[index + 3] == ")") {
-                    references = parts[index + 2];
+            } else if (tokens[index].keyword == Keyword::REFERENCES) {
+                if (index + 3 < tokens.size() && tokens[index + 1] == "("
+                        && tokens[index + 3] == ")") {
+                    references = tokens[index + 2].text;
                     index += 4;
                 } else {
                     throw InvalidQueryException("Missing brackets for column "
                             + colName);
                 }
             } else {
-                throw InvalidQueryException("Unexpected symbol " + parts[index]
-                        + " for column " + colName);
+                throw InvalidQueryException("Unexpected symbol "
+                        + std::string(tokens[index].text) + " for column "
+                        + colName);
             }
         }
     }
@@ -156,167 +132,334 @@ namespace {
     /**
      * Creates the metadata for the next column in the query.
      * 
-     * @param parts The parts of the query string separated by spaces
-     * @param index The current location being examined in parts. This value
+     * @param tokens The tokens of the query
+     * @param index The current location being examined in tokens. This value
      * will be updated by this function.
      * @return The metadata for the next column in the query
      */
     ColumnMetadata createColumnMetadata(const std::string& tableName,
-            const std::vector<std::string>& parts, unsigned int& index) {
-        std::string colName = parts[index++];
-        std::string dataType = string_util::toLowercase(parts[index++]);
-        if (parts[index] == "(") {
-            dataType += parts[index] + parts[index + 1] + parts[index + 2];
+            const TokenVec& tokens, unsigned int& index) {
+        std::string colName(tokens[index++].text);
+        std::string dataType = string_util::toLowercase(
+                std::string(tokens[index++].text));
+        if (tokens[index] == "(") {
+            if (index + 2 >= tokens.size()) {
+                throw InvalidQueryException("Malformed query");
+            }
+            dataType.append(tokens[index].text).append(tokens[index + 1].text)
+                    .append(tokens[index + 2].text);
             index += 3;
         }
         checkDataType(dataType);
         std::string references;
         bool isPrimaryKey = false, notNull = false;
-        extractColumnOptions(parts, index, colName, references, notNull);
+        extractColumnOptions(tokens, index, colName, references, notNull);
         index++;
         return ColumnMetadata(colName, tableName, dataType, references,
                 isPrimaryKey, notNull);
     }
 
     /**
-     * Populates the column properties for an INSERT query.
-     * 
-     * @param properties The property map to modify
-     * @param parts A vector of parts of the query separated by spaces
+     * Gets the token at the given index.
+     *
+     * @throw InvalidQueryException if the query ends before the index
      */
-    void populateInsertColumnProperties(PropertyMap& properties,
-            QueryParts& parts) {
-        unsigned int index = 4;
-        properties["columnNames"] = "";
-        while (parts[index] != ")") {
-            properties["columnNames"] += parts[index];
-            index++;
+    const Token& getToken(const TokenVec& tokens, unsigned int index) {
+        if (index >= tokens.size()) {
+            throw InvalidQueryException("Malformed query");
+        }
+        return tokens[index];
+    }
+
+    /**
+     * Checks that the token at the given index is the given symbol and
+     * moves past it.
+     *
+     * @param message The message of the exception thrown if it is not
+     */
+    void expect(const TokenVec& tokens, unsigned int& index,
+            std::string_view symbol, const std::string& message) {
+        if (getToken(tokens, index) != symbol) {
+            throw InvalidQueryException(message);
         }
-        if (index == parts.size() - 1
-                || string_util::toLowercase(parts[index + 1]) != "values") {
-            throw InvalidQueryException("Expected 'values' after column "
-                    "declarations");
+        index++;
+    }
+
+    /** Checks if the token is a symbol, such as a parenthesis. */
+    bool isSymbol(const Token& token) {
+        return (query_lexer::isComparison(token)
+                && token.keyword != Keyword::LIKE) || token == "("
+                || token == ")" || token == "," || token == ";";
+    }
+
+    /**
+     * Gets the number of a parameter placeholder: n for $n, or 0 for ?.
+     *
+     * @throw InvalidQueryException if the number is 0 or too large
+     */
+    unsigned int getParameterNumber(const Token& token) {
+        if (token == "?") {
+            return 0;
         }
-        if (parts[index + 2] != "(") {
-            throw InvalidQueryException("Expected value declarations within "
-                    "parentheses");
+        unsigned long number = 0;
+        try {
+            number = std::stoul(std::string(token.text.substr(1)));
+        } catch (const std::out_of_range&) {
+            // Reported below as an invalid parameter
         }
-        index += 3;
-        properties["columnValues"] = "";
-        while (parts[index] != ")") {
-            if (string_util::toLowercase(parts[index]) == "null") {
-                parts[index] = Column::NULL_VALUE;
-            }
-            properties["columnValues"] += parts[index];
+        if (number == 0 || number > std::numeric_limits<unsigned int>::max()) {
+            throw InvalidQueryException("Invalid parameter "
+                    + std::string(token.text));
+        }
+        return number;
+    }
+
+    /**
+     * Parses a value being inserted or assigned. Values that are neither
+     * null nor quoted are kept as written and checked against the type of
+     * their column when the query is executed.
+     */
+    Literal parseLiteral(const Token& token) {
+        if (!isParameter(token)) {
+            return query_ast::makeLiteral(token.text);
+        }
+        Literal literal;
+        literal.kind = Literal::Kind::PARAMETER;
+        literal.text = token.text;
+        literal.parameter = getParameterNumber(token);
+        return literal;
+    }
+
+    /**
+     * Parses an operand of a comparison. Unquoted operands that do not start
+     * like a number name columns.
+     */
+    Operand parseOperand(const Token& token) {
+        Operand operand;
+        if (token.keyword == Keyword::NULL_VALUE || isQuoted(token)
+                || isNumeric(token) || isParameter(token)) {
+            operand.literal = parseLiteral(token);
+        } else if (isSymbol(token)) {
+            throw InvalidQueryException("Expected a column or value but got "
+                    + std::string(token.text));
+        } else {
+            operand.isColumn = true;
+            operand.column = token.text;
+        }
+        return operand;
+    }
+
+    Operator parseOperator(const Token& token) {
+        if (token.keyword == Keyword::LIKE) {
+            return Operator::LIKE;
+        } else if (token == "=") {
+            return Operator::EQUAL;
+        } else if (token == "!=") {
+            return Operator::NOT_EQUAL;
+        } else if (token == "<") {
+            return Operator::LESS;
+        } else if (token == "<=") {
+            return Operator::LESS_EQUAL;
+        } else if (token == ">") {
+            return Operator::GREATER;
+        } else if (token == ">=") {
+            return Operator::GREATER_EQUAL;
+        }
+        throw InvalidQueryException("Invalid operator: "
+                + std::string(token.text));
+    }
+
+    /**
+     * Parses a boolean expression, stopping before the first token that
+     * does not continue it. AND and OR have the same precedence and group
+     * to the right, so "a and b or c" is "a and (b or c)".
+     *
+     * @param tokens The tokens of the query
+     * @param index The index of the first token of the expression. Will be
+     * set to the index of the token after it.
+     */
+    Expression parseExpression(const TokenVec& tokens, unsigned int& index) {
+        Expression expression;
+        if (getToken(tokens, index) == "(") {
             index++;
+            expression = parseExpression(tokens, index);
+            expect(tokens, index, ")", "Unbalanced parentheses or quotes");
+        } else {
+            expression.comparison.left = parseOperand(tokens[index++]);
+            expression.comparison.op = parseOperator(getToken(tokens,
+                    index++));
+            expression.comparison.right = parseOperand(getToken(tokens,
+                    index++));
+        }
+        const Token& token = getToken(tokens, index);
+        if (token.keyword != Keyword::AND && token.keyword != Keyword::OR) {
+            return expression;
         }
+        index++;
+        Expression combined;
+        combined.kind = token.keyword == Keyword::AND ? Expression::Kind::AND
+                : Expression::Kind::OR;
+        combined.children.push_back(std::move(expression));
+        combined.children.push_back(parseExpression(tokens, index));
+        return combined;
     }
 
     /**
-     * Parses the restrictions out of the given query.
+     * Parses the restrictions (WHERE clause) out of the given query.
      * 
-     * @param parts The parts of the query, split on spaces
-     * @param index The current index in parts. Will be modified by this 
+     * @param tokens The tokens of the query
+     * @param index The current index in tokens. Will be modified by this
      *      function.
-     * @return The restrictions given in the query
+     * @return The restrictions given in the query, or null if there are none
      */
-    std::string parseRestrictions(const QueryParts& parts,
+    ExpressionPtr parseRestrictions(const TokenVec& tokens,
             unsigned int& index) {
-        std::string restrictions = "";
-        if (string_util::toLowercase(parts.at(index)) == "where") {
+        ExpressionPtr restrictions;
+        if (getToken(tokens, index).keyword == Keyword::WHERE) {
             index++;
-            while (parts.at(index) != ";"
-                    && string_util::toLowercase(parts.at(index)) != "order") {
-                restrictions += parts.at(index++) + " ";
-            }
-            // Erase last space
-            restrictions.erase(restrictions.length() - 1);
-        } else if (parts.at(index) != ";"
-                && string_util::toLowercase(parts.at(index)) != "order") {
+            restrictions = std::make_shared<const Expression>(
+                    parseExpression(tokens, index));
+        }
+        if (getToken(tokens, index) != ";"
+                && tokens[index].keyword != Keyword::ORDER
+                && tokens[index].keyword != Keyword::INTO
+                && tokens[index].keyword != Keyword::WITH) {
             throw InvalidQueryException("Malformed query");
         }
         return restrictions;
     }
 
+    /**
+     * Parses a list of names separated by commas, removing quotes around
+     * them.
+     *
+     * @param tokens The tokens of the query
+     * @param index The index of the first name. Will be set to the index of
+     * the token after the last name.
+     */
+    std::vector<std::string> parseNames(const TokenVec& tokens,
+            unsigned int& index) {
+        std::vector<std::string> names;
+        do {
+            const Token& token = getToken(tokens, index++);
+            if (token.keyword != Keyword::NONE || isSymbol(token)
+                    || isParameter(token)) {
+                throw InvalidQueryException("Unexpected "
+                        + std::string(token.text) + " in list of names");
+            }
+            names.push_back(string_util::extractQuoted(
+                    std::string(token.text)));
+        } while (getToken(tokens, index) == "," && ++index);
+        return names;
+    }
+
     /**
      * Parses the ORDER BY section of a SELECT query.
      * 
-     * @param parts The parts of the query, split on spaces.
-     * @param index The current index in parts. Will be modified by this 
+     * @param tokens The tokens of the query
+     * @param index The current index in tokens. Will be modified by this
      *      function.
-     * @return The ORDER BY section in the query
+     * @return The columns to order by, if any
      */
-    std::string parseOrderBy(const QueryParts& parts,
+    std::vector<std::string> parseOrderBy(const TokenVec& tokens,
             unsigned int& index) {
-        std::string ret = "";
-        if (string_util::toLowercase(parts.at(index)) == "order") {
-            if (string_util::toLowercase(parts.at(++index)) != "by") {
-                throw InvalidQueryException("Expected 'by' after 'order'");
-            }
-            index++;
-            while (string_util::toLowercase(parts.at(index)) != ";" &&
-                    string_util::toLowercase(parts.at(index)) != "desc") {
-                ret += parts.at(index++);
-            }
+        if (getToken(tokens, index).keyword != Keyword::ORDER) {
+            return {};
         }
-        return ret;
+        if (getToken(tokens, ++index).keyword != Keyword::BY) {
+            throw InvalidQueryException("Expected 'by' after 'order'");
+        }
+        index++;
+        return parseNames(tokens, index);
     }
 
     /**
-     * Determines if the given string is a column name.
+     * Parses the file a SELECT query writes its rows to: INTO OUTFILE 'path'
+     * [FORMAT csv|tsv|jsonl|binary].
+     *
+     * @param tokens The tokens of the query
+     * @param index The index of the token after INTO. Will be set to the
+     * index of the token after the clause.
+     * @param select The statement to store the path and format in
      */
-    bool isColumnName(const std::string& s) {
-        if (s.at(0) == '"') {
-            return false;
+    void parseOutfile(const TokenVec& tokens, unsigned int& index,
+            query_ast::SelectStatement& select) {
+        if (string_util::toLowercase(std::string(getToken(tokens,
+                index).text)) != "outfile"
+                || !isQuoted(getToken(tokens, index + 1))) {
+            throw InvalidQueryException("Expected INTO OUTFILE 'path'");
         }
-        try {
-            std::stod(s);
-        } catch (std::exception& e) {
-            return true;
+        select.outfile = string_util::extractQuoted(std::string(
+                tokens[index + 1].text));
+        index += 2;
+        if (string_util::toLowercase(std::string(getToken(tokens,
+                index).text)) != "format") {
+            return;
         }
-        return false;
+        std::string format = string_util::toLowercase(std::string(
+                getToken(tokens, ++index).text));
+        if (format == "csv") {
+            select.format = result_writer::Format::CSV;
+        } else if (format == "tsv") {
+            select.format = result_writer::Format::TSV;
+        } else if (format == "jsonl") {
+            select.format = result_writer::Format::JSONL;
+        } else if (format == "binary") {
+            select.format = result_writer::Format::BINARY;
+        } else {
+            throw InvalidQueryException("Unknown output format: " + format);
+        }
+        index++;
     }
 
     /**
-     * Extracts the join conditions from the restrictions (WHERE clause) in the
-     * query.
-     * @param properties The properties of the query
-     * @return The join conditions of the query
+     * Parses the degree of parallelism given to a PARALLELISM option.
+     *
+     * @param token The token holding the degree
+     * @return The degree
+     * @throw InvalidQueryException if it is not a positive integer
      */
-    std::string extractJoinConditions(const PropertyMap& properties) {
-        if (properties.at("restrictions") == "") {
-            return "";
+    unsigned int parseParallelism(const Token& token) {
+        std::string degree(token.text);
+        if (degree.empty() || degree.size() > 4
+                || degree.find_first_not_of("0123456789") != std::string::npos
+                || std::stoul(degree) == 0) {
+            throw InvalidQueryException("Expected a positive degree of "
+                    "parallelism");
         }
-        auto parts = string_util::split(properties.at("restrictions"), ' ',
-                true);
-        std::string joinConditions;
-        for (unsigned int index = 0; index < parts.size();) {
-            auto left = parts[index], right = parts[index + 2];
-            bool updateJoinConditions = isColumnName(left)
-                    && isColumnName(right);
-            if (updateJoinConditions) {
-                joinConditions += left + " " + parts[index + 1] + " " + right;
-            }
-            index += 3;
-            if (index < parts.size() && (parts[index] == "and"
-                    || parts[index] == "or")) {
-                joinConditions += (updateJoinConditions ? " " : "");
-                index++;
+        return std::stoul(degree);
+    }
+
+    /**
+     * Collects the comparisons between two columns in a restriction, which
+     * are used to join the tables of a query. Only comparisons every result
+     * row must satisfy are collected, so those under an OR are left to the
+     * restriction and their tables are joined without a key.
+     */
+    void collectJoinConditions(const Expression& expression,
+            std::vector<Comparison>& joinConditions) {
+        if (expression.kind == Expression::Kind::AND) {
+            for (const auto& child : expression.children) {
+                collectJoinConditions(child, joinConditions);
             }
+        } else if (expression.kind == Expression::Kind::COMPARISON
+                && expression.comparison.left.isColumn
+                && expression.comparison.right.isColumn) {
+            joinConditions.push_back(expression.comparison);
         }
-        if (joinConditions.at(joinConditions.length() - 1) == ' ') {
-            joinConditions.erase(joinConditions.length() - 1);
-        }
-        return joinConditions;
     }
 }  // namespace
 
 Query::Query(const std::string& queryString) {
     this->queryString = queryString;
-    formatQuery(this->queryString);
     parse();
 }
 
+Query::Query(QueryType queryType, const query_ast::Statement& statement)
+: queryType(queryType), statement(statement) {
+    // No implementation needed
+}
+
 Query::~Query() {
     // No implementation needed
 }
@@ -325,228 +468,380 @@ Result Query::execute() const {
     return Result(*this);
 }
 
-std::string Query::getProperty(const std::string& propertyName) const {
-    return properties.at(propertyName);
-}
-
-bool Query::hasProperty(const std::string& propertyName) const {
-    return properties.find(propertyName) != properties.end();
+const query_ast::Statement& Query::getStatement() const {
+    return statement;
 }
 
 Query::QueryType Query::getType() const {
     return queryType;
 }
 
-bool Query::isBalanced() const {
-    std::stack<char> bracketStack;
-    bool ignore = false;  // Used to ignore quoted content
-    bool escaped = false;  // Used to properly parse escaped characters
-    for (const auto& c : queryString) {
-        if (c == '"' && !escaped) {
-            ignore = !ignore;
-        }
-        escaped = (c == '\\' ? !escaped : false);
-        if (ignore) {
-            continue;
-        }
-        if (c == '(') {
-            bracketStack.push(c);
-        } else if (c == ')') {
-            if (bracketStack.size() == 0) {
-                return false;
-            }
-            bracketStack.pop();
+unsigned int Query::getParameterCount() const {
+    return parameterCount;
+}
+
+bool Query::isBalanced(const TokenVec& tokens) const {
+    int depth = 0;
+    for (const auto& token : tokens) {
+        if (token == "(") {
+            depth++;
+        } else if (token == ")" && --depth < 0) {
+            return false;
         }
     }
-    return bracketStack.size() == 0
-            && string_util::split(queryString, '"', true).size() % 2 == 1
-            && string_util::split(queryString, '\'', true).size() % 2 == 1;
+    return depth == 0;
 }
 
 void Query::parse() {
-    if (queryString.find(";") != queryString.length() - 1) {
+    TokenVec tokens;
+    if (!query_lexer::tokenize(queryString, tokens)) {
+        throw InvalidQueryException("Unbalanced parentheses or quotes");
+    } else if (tokens.empty() || tokens.back() != ";") {
         throw InvalidQueryException("Missing semicolon at end");
-    } else if (!isBalanced()) {
+    } else if (!isBalanced(tokens)) {
         throw InvalidQueryException("Unbalanced parentheses or quotes");
     }
-    if (string_util::toLowercase(queryString).find("create") == 0) {
-        queryType = QueryType::CREATE;
-        parseCreateQuery();
-    } else if (string_util::toLowercase(queryString).find("drop") == 0) {
-        queryType = QueryType::DROP;
-        parseDropQuery();
-    } else if (string_util::toLowercase(queryString).find("insert") == 0) {
-        queryType = QueryType::INSERT;
-        parseInsertQuery();
-    } else if (string_util::toLowercase(queryString).find("update") == 0) {
-        queryType = QueryType::UPDATE;
-        parseUpdateQuery();
-    } else if (string_util::toLowercase(queryString).find("delete") == 0) {
-        queryType = QueryType::DELETE;
-        parseDeleteQuery();
-    } else if (string_util::toLowercase(queryString).find("select") == 0) {
-        queryType = QueryType::SELECT;
-        parseSelectQuery();
-    } else {
-        throw InvalidQueryException("Invalid query");
+    for (unsigned int i = 0; i < tokens.size() - 1; i++) {
+        if (tokens[i] == ";") {
+            throw InvalidQueryException("Missing semicolon at end");
+        }
+    }
+    if (tokens[0].keyword == Keyword::PREPARE) {
+        // The parameters belong to the query being prepared
+        queryType = QueryType::PREPARE;
+        statement = parsePrepareQuery(tokens);
+        return;
+    }
+    countParameters(tokens);
+    switch (tokens[0].keyword) {
+        case Keyword::CREATE:
+            queryType = QueryType::CREATE;
+            statement = parseCreateQuery(tokens);
+            break;
+        case Keyword::DROP:
+            queryType = QueryType::DROP;
+            statement = parseDropQuery(tokens);
+            break;
+        case Keyword::INSERT:
+            queryType = QueryType::INSERT;
+            statement = parseInsertQuery(tokens);
+            break;
+        case Keyword::UPDATE:
+            queryType = QueryType::UPDATE;
+            statement = parseUpdateQuery(tokens);
+            break;
+        case Keyword::DELETE:
+            queryType = QueryType::DELETE;
+            statement = parseDeleteQuery(tokens);
+            break;
+        case Keyword::SELECT:
+            queryType = QueryType::SELECT;
+            statement = parseSelectQuery(tokens);
+            break;
+        case Keyword::COPY:
+            queryType = QueryType::COPY;
+            statement = parseCopyQuery(tokens);
+            break;
+        case Keyword::EXECUTE:
+            queryType = QueryType::EXECUTE;
+            statement = parseExecuteQuery(tokens);
+            break;
+        default:
+            throw InvalidQueryException("Invalid query");
     }
 }
 
-void Query::parseCreateQuery() {
-    QueryParts parts = string_util::split(queryString, ' ');
-    // A CREATE query must have at least 8 parts:
+void Query::countParameters(const TokenVec& tokens) {
+    unsigned int unnumbered = 0, highest = 0;
+    for (const auto& token : tokens) {
+        if (isParameter(token)) {
+            unsigned int number = getParameterNumber(token);
+            unnumbered += (number == 0);
+            highest = std::max(highest, number);
+        }
+    }
+    if (unnumbered != 0 && highest != 0) {
+        throw InvalidQueryException("Cannot use both ? and $n parameters");
+    }
+    parameterCount = std::max(unnumbered, highest);
+}
+
+query_ast::CreateStatement Query::parseCreateQuery(TokenVec tokens) const {
+    query_ast::CreateStatement create;
+    if (tokens.size() > 1 && tokens[1].keyword == Keyword::TEMPORARY) {
+        create.temporary = true;
+        tokens.erase(tokens.begin() + 1);
+    }
+    // A CREATE query must have at least 8 tokens:
     // CREATE TABLE tableName ( colName dataType ) ;
-    if (parts.size() < 8) {
+    if (tokens.size() < 8) {
         throw InvalidQueryException("Malformed query");
     }
-    properties["tableName"] = parts[2];
-    if (string_util::toLowercase(parts[1]) != "table" || parts[3] != "("
-            || parts[parts.size() - 2] != ")") {
+    create.tableName = tokens[2].text;
+    if (tokens[1].keyword != Keyword::TABLE || tokens[3] != "("
+            || tokens[tokens.size() - 2] != ")") {
         throw InvalidQueryException("Malformed query");
     }
-    Schema schema;
     unsigned int index = 4;
     bool primaryKeyFound = false;
     std::set<std::string> colNames;
-    std::vector<ColumnMetadata> metadataVec;
-    while (index < parts.size() - 2) {
-        if (string_util::toLowercase(parts[index]) == "primary") {
-            parsePrimaryKey(parts, metadataVec, index);
+    MetadataVec metadataVec;
+    while (index < tokens.size() - 2) {
+        if (tokens[index].keyword == Keyword::PRIMARY) {
+            parsePrimaryKey(tokens, metadataVec, index);
         } else {
-            ColumnMetadata metadata = createColumnMetadata(parts[2], parts,
-                    index);
+            ColumnMetadata metadata = createColumnMetadata(create.tableName,
+                    tokens, index);
             metadataVec.push_back(metadata);
         }
     }
     for (const auto& metadata : metadataVec) {
         ensureValidMetadata(metadata, colNames, primaryKeyFound);
-        schema.addColumn(metadata);
+        create.columns.push_back(metadata);
     }
-    properties["schema"] = schema.toString();
+    return create;
 }
 
-void Query::parseDropQuery() {
-    QueryParts parts = string_util::split(queryString, ' ');
-    // A DROP query has 4 parts:
+query_ast::DropStatement Query::parseDropQuery(const TokenVec& tokens) const {
+    // A DROP query has 4 tokens:
     // DROP TABLE tableName ;
-    if (parts.size() != 4) {
+    if (tokens.size() != 4) {
         throw InvalidQueryException("Malformed query");
     }
-    properties["tableName"] = parts[2];
-    if (string_util::toLowercase(parts[1]) != "table") {
-        throw InvalidQueryException("Expected 'table' but got " + parts[1]);
+    if (tokens[1].keyword != Keyword::TABLE) {
+        throw InvalidQueryException("Expected 'table' but got "
+                + std::string(tokens[1].text));
     }
+    return {std::string(tokens[2].text)};
 }
 
-void Query::parseInsertQuery() {
-    QueryParts parts = string_util::split(queryString, ' ', true);
-    // An INSERT query has at least 11 parts:
+query_ast::InsertStatement Query::parseInsertQuery(
+        const TokenVec& tokens) const {
+    // An INSERT query has at least 11 tokens:
     // INSERT INTO tableName ( colName ) VALUES ( colValue ) ;
-    if (parts.size() < 11) {
-        if (parts[3] != "(") {
+    if (tokens.size() < 11) {
+        if (tokens.size() < 4 || tokens[3] != "(") {
             throw InvalidQueryException("Expected column names after table "
                     "name");
         } else {
             throw InvalidQueryException("Malformed query");
         }
-    } else if (string_util::toLowercase(parts[1]) != "into") {
+    } else if (tokens[1].keyword != Keyword::INTO) {
         throw InvalidQueryException("Expected 'into' after insert keyword");
     }
-    properties["tableName"] = parts[2];
-    populateInsertColumnProperties(properties, parts);
+    query_ast::InsertStatement insert;
+    insert.tableName = tokens[2].text;
+    unsigned int index = 3;
+    expect(tokens, index, "(", "Expected column names after table name");
+    insert.columnNames = parseNames(tokens, index);
+    expect(tokens, index, ")", "Malformed query");
+    if (getToken(tokens, index++).keyword != Keyword::VALUES) {
+        throw InvalidQueryException("Expected 'values' after column "
+                "declarations");
+    }
+    do {
+        expect(tokens, index, "(", "Expected value declarations within "
+                "parentheses");
+        insert.rows.emplace_back();
+        do {
+            insert.rows.back().push_back(parseLiteral(getToken(tokens,
+                    index++)));
+        } while (getToken(tokens, index) == "," && ++index);
+        expect(tokens, index, ")", "Malformed query");
+    } while (getToken(tokens, index) == "," && ++index);
+    expect(tokens, index, ";", "Malformed query");
+    return insert;
 }
 
-void Query::parseUpdateQuery() {
-    QueryParts parts = string_util::split(queryString, ' ', true);
-    // An UPDATE query has at least 7 parts:
+query_ast::UpdateStatement Query::parseUpdateQuery(
+        const TokenVec& tokens) const {
+    // An UPDATE query has at least 7 tokens:
     // UPDATE tableName SET colName = newValue ;
-    if (parts.size() < 7 || string_util::toLowercase(parts[2]) != "set") {
+    if (tokens.size() < 7 || tokens[2].keyword != Keyword::SET) {
         throw InvalidQueryException("Malformed query");
     }
-    properties["tableName"] = parts[1];
-    properties["columns"] = properties["values"] = "";
+    query_ast::UpdateStatement update;
+    update.tableName = tokens[1].text;
     unsigned int index = 3;
-    while (parts[index] != ";"
-            && string_util::toLowercase(parts[index]) != "where") {
-        properties["columns"] += parts[index++] + ",";
-        if (parts[index++] != "=") {
-            throw InvalidQueryException("Expected = after column name");
-        }
-        if (string_util::toLowercase(parts[index]) == "null") {
-            parts[index] = Column::NULL_VALUE;
-        }
-        properties["values"] += parts[index++] + ",";
-        if (parts[index] == ",") {
-            index++;
-        }
-    }
-    // Erase extra commas
-    properties["columns"].erase(properties["columns"].length() - 1);
-    properties["values"].erase(properties["values"].length() - 1);
+    do {
+        std::string column(getToken(tokens, index++).text);
+        expect(tokens, index, "=", "Expected = after column name");
+        update.assignments.emplace_back(column,
+                parseLiteral(getToken(tokens, index++)));
+    } while (getToken(tokens, index) == "," && ++index);
     // Parse restrictions
-    properties["restrictions"] = parseRestrictions(parts, index);
+    update.restriction = parseRestrictions(tokens, index);
+    return update;
 }
 
-void Query::parseDeleteQuery() {
-    QueryParts parts = string_util::split(queryString, ' ', true);
-    // A DELETE query has at least 4 parts:
+query_ast::DeleteStatement Query::parseDeleteQuery(
+        const TokenVec& tokens) const {
+    // A DELETE query has at least 4 tokens:
     // DELETE FROM tableName ;
-    if (parts.size() < 4 || string_util::toLowercase(parts[1]) != "from") {
+    if (tokens.size() < 4 || tokens[1].keyword != Keyword::FROM) {
         throw InvalidQueryException("Malformed query");
     }
-    properties["tableName"] = parts[2];
+    query_ast::DeleteStatement deleteStatement;
+    deleteStatement.tableName = tokens[2].text;
     // Parse restrictions
     unsigned int index = 3;
-    properties["restrictions"] = parseRestrictions(parts, index);
+    deleteStatement.restriction = parseRestrictions(tokens, index);
+    return deleteStatement;
 }
 
-void Query::parseSelectQuery() {
-    QueryParts parts = string_util::split(queryString, ' ', true);
-    // A SELECT query has at least 5 parts:
+query_ast::SelectStatement Query::parseSelectQuery(
+        const TokenVec& tokens) const {
+    // A SELECT query has at least 5 tokens:
     // SELECT columnName FROM tableName ;
-    // It must also include a FROM clause
-    if (parts.size() < 5 || string_util::toLowercase(queryString).find(" from ")
-            == std::string::npos) {
+    if (tokens.size() < 5) {
         throw InvalidQueryException("Malformed query");
     }
+    query_ast::SelectStatement select;
     unsigned int index = 1;
-    if (string_util::toLowercase(parts[1]) == "distinct") {
+    if (tokens[1].keyword == Keyword::DISTINCT) {
         index = 2;
-        properties["distinct"] = "";
-    }
-    properties["columnNames"] = "";
-    while (string_util::toLowercase(parts[index]) != "from") {
-        properties["columnNames"] += string_util::extractQuoted(parts[index++]);
+        select.distinct = true;
     }
-    index++;
-    properties["tableNames"] = "";
-    while (string_util::toLowercase(parts[index]) != "where"
-            && string_util::toLowercase(parts[index]) != "order"
-            && parts[index] != ";") {
-        properties["tableNames"] += string_util::extractQuoted(parts[index++]);
+    select.columnNames = parseNames(tokens, index);
+    if (getToken(tokens, index++).keyword != Keyword::FROM) {
+        throw InvalidQueryException("Malformed query");
     }
+    select.tableNames = parseNames(tokens, index);
     // Parse restrictions
-    properties["restrictions"] = parseRestrictions(parts, index);
-    properties["joinConditions"] = extractJoinConditions(properties);
-    properties["orderBy"] = parseOrderBy(parts, index);
-    if (string_util::toLowercase(parts[index]) == "desc") {
-        properties["desc"] = "";
+    select.restriction = parseRestrictions(tokens, index);
+    if (select.restriction) {
+        collectJoinConditions(*select.restriction, select.joinConditions);
+    }
+    select.orderBy = parseOrderBy(tokens, index);
+    if (getToken(tokens, index).keyword == Keyword::DESC) {
+        select.desc = true;
+        index++;
     }
+    if (getToken(tokens, index).keyword == Keyword::INTO) {
+        index++;
+        parseOutfile(tokens, index, select);
+    }
+    if (getToken(tokens, index).keyword == Keyword::WITH) {
+        index++;
+        expect(tokens, index, "(", "Expected options within parentheses");
+        do {
+            std::string option = string_util::toLowercase(
+                    std::string(getToken(tokens, index++).text));
+            if (option != "parallelism") {
+                throw InvalidQueryException("Unknown SELECT option: "
+                        + option);
+            }
+            select.parallelism = parseParallelism(getToken(tokens, index++));
+        } while (getToken(tokens, index) == "," && ++index);
+        expect(tokens, index, ")", "Malformed query");
+    }
+    expect(tokens, index, ";", "Malformed query");
+    return select;
 }
 
-void Query::parsePrimaryKey(const QueryParts& parts,
-        MetadataVec& metadataVec, unsigned int& index) {
-    if (string_util::toLowercase(parts[index + 1]) != "key") {
+void Query::parsePrimaryKey(const TokenVec& tokens,
+        MetadataVec& metadataVec, unsigned int& index) const {
+    if (index + 5 >= tokens.size()
+            || tokens[index + 1].keyword != Keyword::KEY) {
         throw InvalidQueryException("Expected 'key' after 'primary'");
     }
-    if (parts[index + 2] != "(" || parts[index + 4] != ")") {
+    if (tokens[index + 2] != "(" || tokens[index + 4] != ")") {
         throw InvalidQueryException("Expected parentheses after primary"
                 " key declaration");
     }
     for (auto& metadata : metadataVec) {
-        if (metadata.getColumnName() == parts[index + 3]) {
+        if (metadata.getColumnName() == tokens[index + 3].text) {
             metadata.primaryKey = metadata.notNull = true;
         }
     }
-    index += (parts[index + 5] == "," ? 6 : 5);
+    index += (tokens[index + 5] == "," ? 6 : 5);
+}
+
+query_ast::CopyStatement Query::parseCopyQuery(const TokenVec& tokens) const {
+    // COPY tableName FROM 'path' [WITH ( option [, option] )] ;
+    // where each option is DELIMITER 'c', HEADER or PARALLELISM n
+    if (tokens.size() < 5 || tokens[2].keyword != Keyword::FROM
+            || !isQuoted(tokens[3])) {
+        throw InvalidQueryException("Expected COPY table FROM 'path'");
+    }
+    query_ast::CopyStatement copy;
+    copy.tableName = tokens[1].text;
+    copy.path = string_util::extractQuoted(std::string(tokens[3].text));
+    unsigned int index = 4;
+    if (tokens[index].keyword == Keyword::WITH) {
+        index++;
+        expect(tokens, index, "(", "Expected options within parentheses");
+        do {
+            std::string option = string_util::toLowercase(
+                    std::string(getToken(tokens, index++).text));
+            if (option == "header") {
+                copy.header = true;
+            } else if (option == "delimiter") {
+                const Token& token = getToken(tokens, index++);
+                std::string delimiter = isQuoted(token)
+                        ? string_util::extractQuoted(std::string(token.text))
+                        : "";
+                if (delimiter == "\\t") {  // A tab, written as \t
+                    delimiter = "\t";
+                }
+                if (delimiter.size() != 1) {
+                    throw InvalidQueryException("Expected a quoted delimiter "
+                            "of one character");
+                }
+                copy.delimiter = delimiter[0];
+            } else if (option == "parallelism") {
+                copy.parallelism = parseParallelism(getToken(tokens,
+                        index++));
+            } else {
+                throw InvalidQueryException("Unknown COPY option: " + option);
+            }
+        } while (getToken(tokens, index) == "," && ++index);
+        expect(tokens, index, ")", "Malformed query");
+    }
+    expect(tokens, index, ";", "Malformed query");
+    return copy;
+}
+
+query_ast::PrepareStatement Query::parsePrepareQuery(
+        const TokenVec& tokens) const {
+    // PREPARE name AS query ;
+    if (tokens.size() < 5 || tokens[1].keyword != Keyword::NONE
+            || isSymbol(tokens[1]) || tokens[2].keyword != Keyword::AS) {
+        throw InvalidQueryException("Expected PREPARE name AS query");
+    }
+    Keyword type = tokens[3].keyword;
+    if (type == Keyword::PREPARE || type == Keyword::EXECUTE) {
+        throw InvalidQueryException("Cannot prepare a PREPARE or EXECUTE "
+                "query");
+    }
+    std::size_t start = tokens[3].text.data() - queryString.data();
+    return {std::string(tokens[1].text), queryString.substr(start)};
+}
+
+query_ast::ExecuteStatement Query::parseExecuteQuery(
+        const TokenVec& tokens) const {
+    // EXECUTE name [( arguments )] ;
+    if (tokens.size() < 3 || tokens[1].keyword != Keyword::NONE
+            || isSymbol(tokens[1])) {
+        throw InvalidQueryException("Expected EXECUTE name (values)");
+    }
+    query_ast::ExecuteStatement execute;
+    execute.name = tokens[1].text;
+    unsigned int index = 2;
+    if (tokens[index] == "(" && getToken(tokens, index + 1) == ")") {
+        index += 2;
+    } else if (tokens[index] == "(") {
+        index++;
+        do {
+            const Token& token = getToken(tokens, index++);
+            if (isSymbol(token)) {
+                throw InvalidQueryException("Expected a value but got "
+                        + std::string(token.text));
+            }
+            execute.arguments.push_back(parseLiteral(token));
+        } while (getToken(tokens, index) == "," && ++index);
+        expect(tokens, index, ")", "Malformed query");
+    }
+    expect(tokens, index, ";", "Malformed query");
+    return execute;
 }
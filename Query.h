@@ -9,53 +9,30 @@
 #define QUERY_H
 
 #include <string>
-#include <unordered_map>
 #include <vector>
+#include "query_ast.h"
+#include "query_lexer.h"
 #include "string_util.h"
 #include "Result.h"
 #include "ColumnMetadata.h"
 
-using PropertyMap = std::unordered_map<std::string, std::string>;
-
 /** 
  * A class that represents a SQL query. 
  * 
  * Queries have different types determined by the first word in the query 
  * string. The types supported by this database are enumerated in QueryType.
- * Based on the type of the query, it will have various properties. The
- * properties for each type are listed below.
- * 
- * CREATE\n
- *     tableName - The name of the table to create\n
- *     schema - The string representation of the schema of the table being
- *     created
- * 
- * DROP\n
- *     tableName - The name of the table to drop
- * 
- * UPDATE\n
- *     tableName - The name of the table to update\n
- *     columns - The columns being updated, separated by commas\n
- *     values - The values to update the columns to, separated by commas\n
- *     restrictions - The restrictions to apply when updating the columns
- * 
- * DELETE\n
- *     tableName - The name of the table to delete from\n
- *     restrictions - The restrictions to apply when deleting rows
+ * A query is parsed into a statement of the matching type from query_ast,
+ * which holds the tables, columns, values and restrictions of the query.
+ * Restrictions are parsed into expression trees, so they are not parsed
+ * again when the query is executed.
  * 
- * INSERT\n
- *     tableName - The table to insert into\n
- *     columnNames - The names of the columns to populate, separated by commas\n
- *     columnValues - The values to insert, separated by commas
- * 
- * SELECT\n
- *     distinct - Defined if and only if the DISTINCT keyword was specified\n
- *     columnNames - The names of the columns to retrieve, separated by commas\n
- *     tableNames - The names of the tables to select from, 
- *         separated by commas\n
- *     restrictions - The restrictions to apply when selecting rows\n
- *     orderBy - The columns to order by (default "")\n
- *     desc - Defined if and only if the DESC keyword was specified
+ * Values in INSERT, UPDATE and WHERE clauses may be parameters (? or $n),
+ * which are bound to values by PreparedStatement. PREPARE name AS query
+ * stores a prepared statement, and EXECUTE name (values) executes it.
+ * COPY table FROM 'path' loads the rows of a delimited text file, and
+ * SELECT ... INTO OUTFILE 'path' writes the rows of a result to a file.
+ * SELECT ... WITH (PARALLELISM n) and COPY ... WITH (PARALLELISM n) limit
+ * the number of threads the query uses.
  */
 class Query {
 public:
@@ -66,33 +43,39 @@ public:
         UPDATE,
         DELETE,
         INSERT,
-        SELECT
+        SELECT,
+        COPY,
+        PREPARE,
+        EXECUTE
     };
     
     Query(const std::string& queryString);
-    ~Query();
     
     /**
-     * Gets a property of this query. Properties differ based on the type of the
-     * query returned by getType() (see class documentation for more details).
+     * Creates a query from a statement that has already been parsed, such
+     * as a prepared statement whose parameters have been bound.
      * 
-     * @param propertyName The name of the property to get. Throws 
-     * std::out_of_range if the property does not exist.
-     * @return The value of the property.
+     * @param queryType The type of the query
+     * @param statement The statement, holding the alternative for the type
      */
-    std::string getProperty(const std::string& propertyName) const;
+    Query(QueryType queryType, const query_ast::Statement& statement);
+    ~Query();
     
     /**
-     * Determines if the query has a property matching the given name.
-     * 
-     * @param propertyName The name to search for
-     * @return True if the query has the given property, false otherwise
+     * Gets the parsed statement. It holds the alternative of
+     * query_ast::Statement matching getType().
      */
-    bool hasProperty(const std::string& propertyName) const;
+    const query_ast::Statement& getStatement() const;
     
     /** Gets the type of this query. */
     QueryType getType() const;
     
+    /**
+     * Gets the number of parameters (? or $n placeholders) in the query.
+     * Only prepared statements can be executed with parameters.
+     */
+    unsigned int getParameterCount() const;
+    
     /** 
      * Executes the query and returns the result. If the query is invalid, 
      * throws std::invalid_argument.
@@ -102,36 +85,62 @@ public:
 private:
     std::string queryString;
     QueryType queryType;
-    PropertyMap properties;
+    query_ast::Statement statement;
+    unsigned int parameterCount = 0;
     
-    /** Checks whether or not brackets in the query are balanced. */
-    bool isBalanced() const;
+    /**
+     * Checks whether or not the parentheses in the query are balanced.
+     *
+     * @param tokens The tokens of the query
+     */
+    bool isBalanced(const query_lexer::TokenVec& tokens) const;
     
     /** Parses the query, setting its type and associated properties. */
     void parse();
+    
+    /**
+     * Counts the parameters in the query. Parameters are either all ? or
+     * all $n; with $n, the highest n is the count.
+     */
+    void countParameters(const query_lexer::TokenVec& tokens);
     /** Parses a CREATE query. */
-    void parseCreateQuery();
+    query_ast::CreateStatement parseCreateQuery(
+            query_lexer::TokenVec tokens) const;
     /** Parses a DROP query. */
-    void parseDropQuery();
+    query_ast::DropStatement parseDropQuery(
+            const query_lexer::TokenVec& tokens) const;
     /** Parses an INSERT query. */
-    void parseInsertQuery();
+    query_ast::InsertStatement parseInsertQuery(
+            const query_lexer::TokenVec& tokens) const;
     /** Parses an UPDATE query. */
-    void parseUpdateQuery();
+    query_ast::UpdateStatement parseUpdateQuery(
+            const query_lexer::TokenVec& tokens) const;
     /** Parses a DELETE query. */
-    void parseDeleteQuery();
+    query_ast::DeleteStatement parseDeleteQuery(
+            const query_lexer::TokenVec& tokens) const;
     /** Parses a SELECT query. */
-    void parseSelectQuery();
+    query_ast::SelectStatement parseSelectQuery(
+            const query_lexer::TokenVec& tokens) const;
+    /** Parses a COPY query. */
+    query_ast::CopyStatement parseCopyQuery(
+            const query_lexer::TokenVec& tokens) const;
+    /** Parses a PREPARE query. */
+    query_ast::PrepareStatement parsePrepareQuery(
+            const query_lexer::TokenVec& tokens) const;
+    /** Parses an EXECUTE query. */
+    query_ast::ExecuteStatement parseExecuteQuery(
+            const query_lexer::TokenVec& tokens) const;
     
     /**
      * Parses a primary key declaration.
      * 
-     * @param parts The parts of the query, split on spaces.
+     * @param tokens The tokens of the query
      * @param metadataVec The metadata of the columns created so far
-     * @param index The current index in parts. Will be modified by this
+     * @param index The current index in tokens. Will be modified by this
      * method.
      */
-    void parsePrimaryKey(const std::vector<std::string>& parts, 
-            MetadataVec& metadataVec, unsigned int& index);
+    void parsePrimaryKey(const query_lexer::TokenVec& tokens,
+            MetadataVec& metadataVec, unsigned int& index) const;
 };
 
 #endif /* QUERY_H */
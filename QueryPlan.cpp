@@ -0,0 +1,253 @@
+/*
+ * File:   QueryPlan.cpp
+ * Implementation file for the QueryPlan class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+#include "InvalidQueryException.h"
+#include "JoinedTable.h"
+#include "query_ast.h"
+#include "Query.h"
+#include "QueryPlan.h"
+#include "Restriction.h"
+#include "result_writer.h"
+#include "Row.h"
+#include "Schema.h"
+#include "Table.h"
+#include "table_io_util.h"
+
+// Helper functions
+namespace {
+    using query_ast::Literal;
+
+    /**
+     * Gets the value of a literal of the query, which is the value of the
+     * parameter if the literal is one.
+     */
+    const Literal& getValue(const Literal& literal,
+            const std::vector<Literal>& arguments) {
+        return literal.kind == Literal::Kind::PARAMETER
+                ? arguments.at(literal.parameter - 1) : literal;
+    }
+
+    /**
+     * Gets a copy of a bound restriction with its parameters filled in.
+     */
+    Restriction fillRestriction(const Restriction& bound,
+            const std::vector<Literal>& arguments) {
+        Restriction restriction = bound;
+        restriction.setParameters(arguments);
+        return restriction;
+    }
+}  // namespace
+
+QueryPlan::QueryPlan(const Query& query)
+: query(query), catalogVersion(table_io_util::getCatalogVersion()) {
+    // No implementation needed
+}
+
+QueryPlan::~QueryPlan() {
+    // No implementation needed
+}
+
+bool QueryPlan::supports(const Query& query) {
+    switch (query.getType()) {
+        case Query::QueryType::INSERT:
+        case Query::QueryType::UPDATE:
+        case Query::QueryType::DELETE:
+            return true;
+        case Query::QueryType::SELECT: {
+            // Remote tables are read with a schema only known once read
+            const auto& tableNames = std::get<query_ast::SelectStatement>(
+                    query.getStatement()).tableNames;
+            return std::none_of(tableNames.begin(), tableNames.end(),
+                    [](const std::string& name) {
+                        return name.find("http://") == 0;
+                    });
+        }
+        default:
+            return false;
+    }
+}
+
+void QueryPlan::execute(const std::vector<Literal>& arguments,
+        std::shared_ptr<Table>& table) {
+    checkCatalogVersion();
+    switch (query.getType()) {
+        case Query::QueryType::SELECT:
+            executeSelect(arguments, table);
+            break;
+        case Query::QueryType::INSERT:
+            executeInsert(arguments);
+            break;
+        case Query::QueryType::UPDATE:
+            executeUpdate(arguments);
+            break;
+        case Query::QueryType::DELETE:
+            executeDelete(arguments);
+            break;
+        default:
+            throw std::invalid_argument("Invalid query type");
+    }
+}
+
+void QueryPlan::checkCatalogVersion() {
+    if (catalogVersion == table_io_util::getCatalogVersion()) {
+        return;
+    }
+    catalogVersion = table_io_util::getCatalogVersion();
+    joins.clear();
+    selects.clear();
+    bound = false;
+    valueIndexes.clear();
+}
+
+void QueryPlan::executeSelect(const std::vector<Literal>& arguments,
+        std::shared_ptr<Table>& table) {
+    const auto& select = std::get<query_ast::SelectStatement>(
+            query.getStatement());
+    JoinOrder order;
+    for (const auto& tableName : select.tableNames) {
+        auto tableToJoin = table_io_util::openTable(tableName);
+        tableToJoin->setParallelism(select.parallelism);
+        if (!table) {
+            table = tableToJoin;
+            continue;
+        }
+        order.push_back(JoinedTable::buildsFirst(*table, *tableToJoin));
+        auto conditions = joins.find(order);
+        if (conditions == joins.end()) {
+            const Table& probeTable = order.back() ? *tableToJoin : *table;
+            const Table& buildTable = order.back() ? *table : *tableToJoin;
+            conditions = joins.emplace(order,
+                    JoinedTable::bindJoinConditions(probeTable.getSchema(),
+                            buildTable.getSchema(), select.joinConditions))
+                    .first;
+        }
+        table = std::make_shared<JoinedTable>(*table, *tableToJoin,
+                conditions->second);
+    }
+    auto binding = selects.find(order);
+    if (binding == selects.end()) {
+        binding = selects.emplace(order,
+                bindSelect(select, table->getSchema())).first;
+    }
+    if (select.restriction) {
+        table->setRestriction(fillRestriction(binding->second.restriction,
+                arguments));
+    }
+    table->orderBy(binding->second.orderBy, select.desc)
+            .filterDistinct(select.distinct)
+            .filterColumns(binding->second.columns);
+    if (!select.outfile.empty()) {
+        // The rows are written to the file instead of being returned
+        result_writer::writeFile(*table, select.outfile, select.format);
+        table.reset();
+    }
+}
+
+void QueryPlan::executeInsert(const std::vector<Literal>& arguments) {
+    const auto& insert = std::get<query_ast::InsertStatement>(
+            query.getStatement());
+    auto table = table_io_util::openTable(insert.tableName);
+    const Schema& schema = table->getSchema();
+    const auto& colNames = insert.columnNames;
+    if (!bound) {
+        for (const auto& values : insert.rows) {
+            if (colNames.size() != values.size()) {
+                throw InvalidQueryException("Number of columns and values "
+                        "must match");
+            }
+        }
+        for (const auto& colName : colNames) {
+            if (!schema.hasColumn(colName)) {
+                throw InvalidQueryException("Unknown column: " + colName);
+            }
+        }
+        // The values are ordered as the columns of the table
+        ColumnIndexes indexes;
+        for (const auto& metadata : schema.getMetadataForColumns()) {
+            const std::string& colName = metadata.getColumnName();
+            auto position = std::find(colNames.begin(), colNames.end(),
+                    colName);
+            if (position == colNames.end()) {
+                throw InvalidQueryException("Column not specified: "
+                        + colName);
+            }
+            indexes.push_back(std::distance(colNames.begin(), position));
+        }
+        valueIndexes = indexes;
+        bound = true;
+    }
+    RowVec rows;
+    rows.reserve(insert.rows.size());
+    std::vector<std::string> orderedValues(valueIndexes.size());
+    for (const auto& values : insert.rows) {
+        for (unsigned int i = 0; i < valueIndexes.size(); i++) {
+            orderedValues[i] = getValue(values[valueIndexes[i]],
+                    arguments).text;
+        }
+        rows.push_back(Row(schema, orderedValues));
+    }
+    // The rows are validated together and written at once
+    table->insertRows(rows);
+}
+
+void QueryPlan::executeUpdate(const std::vector<Literal>& arguments) {
+    const auto& update = std::get<query_ast::UpdateStatement>(
+            query.getStatement());
+    auto table = table_io_util::openTable(update.tableName);
+    UpdateMap nameValueMap;
+    for (const auto& assignment : update.assignments) {
+        nameValueMap[assignment.first] = getValue(assignment.second,
+                arguments).text;
+    }
+    if (update.restriction) {
+        if (!bound) {
+            restriction = Restriction(update.restriction);
+            restriction.bind(table->getSchema());
+            bound = true;
+        }
+        table->setRestriction(fillRestriction(restriction, arguments));
+    }
+    table->updateRows(nameValueMap);
+}
+
+void QueryPlan::executeDelete(const std::vector<Literal>& arguments) {
+    const auto& deleteStatement = std::get<query_ast::DeleteStatement>(
+            query.getStatement());
+    auto table = table_io_util::openTable(deleteStatement.tableName);
+    if (deleteStatement.restriction) {
+        if (!bound) {
+            restriction = Restriction(deleteStatement.restriction);
+            restriction.bind(table->getSchema());
+            bound = true;
+        }
+        table->setRestriction(fillRestriction(restriction, arguments));
+    }
+    table->deleteRows();
+}
+
+QueryPlan::SelectBinding QueryPlan::bindSelect(
+        const query_ast::SelectStatement& select, const Schema& schema) const {
+    SelectBinding binding;
+    binding.restriction = Restriction(select.restriction);
+    binding.restriction.bind(schema);
+    for (const auto& colName : select.orderBy) {
+        binding.orderBy.push_back(schema.bindColumn(colName));
+    }
+    const auto& colNames = select.columnNames;
+    if (colNames.size() != 1 || colNames[0] != "*") {
+        for (const auto& colName : colNames) {
+            binding.columns.push_back(schema.bindColumn(colName));
+        }
+    }
+    return binding;
+}
@@ -0,0 +1,103 @@
+/*
+ * File:   QueryPlan.h
+ * Header file for the QueryPlan class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef QUERYPLAN_H
+#define QUERYPLAN_H
+
+#include <map>
+#include <memory>
+#include <vector>
+#include "JoinedTable.h"
+#include "query_ast.h"
+#include "Query.h"
+#include "Restriction.h"
+#include "Row.h"
+#include "Table.h"
+
+/**
+ * The bound plan of a prepared statement. The columns, restriction and join
+ * conditions of the statement are bound to the schemas of its tables the
+ * first time it is executed and kept, so executing it again only fills in
+ * the values of its parameters.
+ *
+ * Which table of a join is built into the hash table depends on the number
+ * of rows in the tables, so the join conditions are bound for each order
+ * the tables are joined in, and the restriction and columns for each
+ * schema of the joined table. Bindings made before a table was created or
+ * dropped are bound again.
+ *
+ * SELECT queries on local tables, INSERT, UPDATE and DELETE queries have
+ * plans; other queries are executed by binding their values into the query.
+ */
+class QueryPlan {
+public:
+    /**
+     * Creates the plan of a query.
+     *
+     * @param query The query, whose parameters are all numbered $n
+     */
+    QueryPlan(const Query& query);
+    ~QueryPlan();
+
+    /** Checks if queries like the given one have a plan. */
+    static bool supports(const Query& query);
+
+    /**
+     * Executes the plan with the given values, binding it first if needed.
+     *
+     * @param arguments The values of the parameters, where the value of $n
+     * is at index n - 1
+     * @param table Set to the table the rows of a SELECT are extracted from
+     * @throw InvalidQueryException if the query is invalid
+     */
+    void execute(const std::vector<query_ast::Literal>& arguments,
+            std::shared_ptr<Table>& table);
+
+private:
+    /** For each join, whether the table being joined to is built. */
+    using JoinOrder = std::vector<bool>;
+
+    /** The parts of a SELECT bound to the schema of its joined table. */
+    struct SelectBinding {
+        Restriction restriction;
+        ColumnIndexes columns;  // None to extract every column
+        ColumnIndexes orderBy;
+    };
+
+    Query query;
+    unsigned long catalogVersion;  // The version the bindings were made at
+    std::map<JoinOrder, std::vector<JoinedTable::JoinCondition>> joins;
+    std::map<JoinOrder, SelectBinding> selects;
+    bool bound = false;  // Whether the fields below are bound
+    Restriction restriction;  // Of an UPDATE or DELETE
+    ColumnIndexes valueIndexes;  // The value of each column of an INSERT
+
+    /** Discards the bindings if a table was created or dropped since. */
+    void checkCatalogVersion();
+
+    /** Executes a SELECT query. */
+    void executeSelect(const std::vector<query_ast::Literal>& arguments,
+            std::shared_ptr<Table>& table);
+
+    /** Executes an INSERT query. */
+    void executeInsert(const std::vector<query_ast::Literal>& arguments);
+
+    /** Executes an UPDATE query. */
+    void executeUpdate(const std::vector<query_ast::Literal>& arguments);
+
+    /** Executes a DELETE query. */
+    void executeDelete(const std::vector<query_ast::Literal>& arguments);
+
+    /**
+     * Binds the restriction and the columns of a SELECT to the schema of
+     * the table its rows are extracted from.
+     */
+    SelectBinding bindSelect(const query_ast::SelectStatement& select,
+            const Schema& schema) const;
+};
+
+#endif /* QUERYPLAN_H */
@@ -4,61 +4,38 @@
  *
  * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
  */
-#include <boost/date_time/gregorian/gregorian.hpp>
-#include <boost/date_time/posix_time/posix_time.hpp>
-#include <iomanip>
-#include <regex>
-#include <sstream>
-#include <stack>
+#include <algorithm>
+#include <iterator>
+#include <limits>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <stdexcept>
 #include "Restriction.h"
 #include "Row.h"
-#include "string_util.h"
+#include "RowBatch.h"
 #include "InvalidQueryException.h"
 
 // Helper functions
 namespace {
+    /** The number of rows between reorderings of the conditions. */
+    const unsigned long REORDER_INTERVAL = 1024;
 
     /**
-     * Compares the values using the given operator.
-     * 
-     * @return The result of the comparison
+     * The number of times a node must be evaluated before its observed
+     * selectivity is used instead of the estimate.
      */
-    template<typename T>
-    bool compareValues(const T& val1, const std::string& op, const T& val2) {
-        if (op == "=") {
-            return val1 == val2;
-        } else if (op == "<") {
-            return val1 < val2;
-        } else if (op == "<=") {
-            return val1 <= val2;
-        } else if (op == ">") {
-            return val1 > val2;
-        } else if (op == ">=") {
-            return val1 >= val2;
-        } else if (op == "!=") {
-            return val1 != val2;
-        }
-        throw std::invalid_argument("Invalid operator: " + op);
-    }
+    const unsigned long MIN_OBSERVATIONS = 32;
 
-    /**
-     * Compares the values as if they were in the condition 'val1 LIKE val2'.
-     * @return The result of the comparison
-     */
-    bool compareLike(const std::string& val1, const std::string& val2) {
-        std::string regexStr = string_util::escapeRegex(val2);
-        regexStr = string_util::replace(regexStr, "%", ".*");
-        regexStr = string_util::replace(regexStr, "_", ".");
-        std::regex regex(regexStr);
-        return std::regex_match(val1, regex);
-    }
+    /** Relative costs of evaluating comparisons. */
+    const double TYPED_COMPARISON_COST = 1;
+    const double STRING_COMPARISON_COST = 2;
+    const double LIKE_COST = 8;
+    const double DYNAMIC_LIKE_COST = 16;  // The pattern may change per row
 
     /**
      * Checks that the given types are compatible.
-     * 
+     *
      * @return True if the types are compatible, false otherwise
      */
     bool compareColumnTypes(const std::string& col1Type,
@@ -70,170 +47,625 @@ namespace {
     }
 
     /**
-     * Gets the column value if s names a valid column. Otherwise, returns s.
-     * 
-     * @param s The (potential) name of the column to search for
-     * @param row The row to pull values from
-     * @return The value of the column with name s, or s if no such column 
-     * exists
+     * Checks that a constant is null or was parsed into the type of the
+     * column it is compared to. Other values are kept as text and would
+     * fail to convert when rows are compared to them.
      */
-    std::string getColumnValue(const std::string& s, const Row& row) {
-        if (string_util::toLowercase(s) == "null") {
-            return Column::NULL_VALUE;
+    bool isOfColumnType(const Column& constant) {
+        long long integer;
+        double real;
+        if (constant.isNull()) {
+            return true;
         }
-        try {
-            Column c = row.getColumn(s);
-            return static_cast<std::string> (c);
-        } catch (std::exception& e) {
-            if (s.at(0) != '"' && s.at(0) != '\'') {
-                try {
-                    std::stod(s);
-                } catch (std::exception& e) {
-                    throw InvalidQueryException("Invalid value/column name: "
-                            + s);
-                }
-            }
+        switch (constant.getMetadata().getValueType()) {
+            case ValueType::INTEGER:
+            case ValueType::DATE:
+            case ValueType::TIME:
+                return constant.getStoredValue(integer);
+            case ValueType::DOUBLE:
+                return constant.getStoredValue(real);
+            case ValueType::STRING:
+                break;
         }
-        return s;
+        return true;
     }
 
+    /*
+     * Functors for the comparison operators. Stored values are equal when
+     * neither is less than the other, like in Column, so NaN is equal to
+     * everything. Columns are compared with their own operators.
+     */
+    struct Equal {
+        template<typename T>
+        bool operator()(const T& a, const T& b) const {
+            return !(a < b) && !(b < a);
+        }
+        bool operator()(const Column& a, const Column& b) const {
+            return a == b;
+        }
+    };
+
+    struct NotEqual {
+        template<typename T>
+        bool operator()(const T& a, const T& b) const {
+            return a < b || b < a;
+        }
+        bool operator()(const Column& a, const Column& b) const {
+            return !(a == b);
+        }
+    };
+
+    struct Less {
+        template<typename T>
+        bool operator()(const T& a, const T& b) const {
+            return a < b;
+        }
+        bool operator()(const Column& a, const Column& b) const {
+            return a < b;
+        }
+    };
+
+    struct LessEqual {
+        template<typename T>
+        bool operator()(const T& a, const T& b) const {
+            return !(b < a);
+        }
+        bool operator()(const Column& a, const Column& b) const {
+            return a <= b;
+        }
+    };
+
+    struct Greater {
+        template<typename T>
+        bool operator()(const T& a, const T& b) const {
+            return b < a;
+        }
+        bool operator()(const Column& a, const Column& b) const {
+            return a > b;
+        }
+    };
+
+    struct GreaterEqual {
+        template<typename T>
+        bool operator()(const T& a, const T& b) const {
+            return !(a < b);
+        }
+        bool operator()(const Column& a, const Column& b) const {
+            return a >= b;
+        }
+    };
+
     /**
-     * Evaluates one restriction of the form 'first op second' using the given
-     * row to pull column values from if needed.
-     * 
-     * @return The result of the evaluation
+     * Compares two values stored as T with the operator Op. Values that are
+     * stored otherwise, such as nulls and literals that did not parse as the
+     * column's type, are compared as columns.
      */
-    bool evaluateRestriction(const std::string& first, const std::string& op,
-            const std::string& second, const Row& row) {
-        Column col1, col2;
-        std::string col1Value = getColumnValue(first, row);
-        std::string col2Value = getColumnValue(second, row);
-
-        if (col1Value != first && col1Value != Column::NULL_VALUE) {
-            col1 = row.getColumn(first);
-        }
-        if (col2Value != second && col2Value != Column::NULL_VALUE) {
-            col2 = row.getColumn(second);
-        }
-
-        bool compareNumeric = false, compareFloatingPoint = false,
-                compareDates = false, compareTimes = false;
-        if (col1 || col2) {
-            std::string col1Type, col2Type;
-            col1Type = (col1 ? col1.getMetadata().getColumnType() :
-                    col2 ? col2.getMetadata().getColumnType() : "");
-            col2Type = (col2 ? col2.getMetadata().getColumnType() :
-                    col1 ? col1.getMetadata().getColumnType() : "");
-            if (!compareColumnTypes(col1Type, col2Type)) {
-                throw std::invalid_argument(first + " and " + second + " do not"
-                        " have the same types");
-            }
-            if (col1Type == "int" || col1Type == "bigint") {
-                compareNumeric = true;
-            } else if (col1Type == "float" || col1Type == "double") {
-                compareFloatingPoint = true;
-            } else if (col1Type == "date") {
-                compareDates = true;
-            } else if (col1Type == "time") {
-                compareTimes = true;
-            }
+    template<typename T, typename Op>
+    bool compareStored(const Column& left, const Column& right) {
+        T leftValue, rightValue;
+        if (left.getStoredValue(leftValue)
+                && right.getStoredValue(rightValue)) {
+            return Op()(leftValue, rightValue);
         }
-        if (compareNumeric && col1Value != "" && col2Value != "") {
-            return compareValues<long long>(std::stoll(col1Value), op,
-                    std::stoll(col2Value));
-        } else if (compareFloatingPoint && col1Value != "" && col2Value != "") {
-            return compareValues<double>(std::stod(col1Value), op,
-                    std::stod(col2Value));
-        } else if (compareDates && col1Value != "" && col2Value != "") {
-            return compareValues<boost::gregorian::date>(
-                    boost::gregorian::from_string(col1Value), op,
-                    boost::gregorian::from_string(col2Value));
-        } else if (compareTimes && col1Value != "" && col2Value != "") {
-            return compareValues<boost::posix_time::ptime>(
-                    boost::posix_time::time_from_string(col1Value), op,
-                    boost::posix_time::time_from_string(col2Value));
-        } else {
-            if (string_util::toLowercase(op) != "like") {
-                return compareValues<std::string>(
-                        string_util::extractQuoted(col1Value), op,
-                        string_util::extractQuoted(col2Value));
-            } else {
-                return compareLike(string_util::extractQuoted(col1Value),
-                        string_util::extractQuoted(col2Value));
-            }
+        return Op()(left, right);
+    }
+
+    /**
+     * Gets the instantiation of compareStored for values stored as T and
+     * the given operator.
+     */
+    template<typename T>
+    auto selectPredicate(filter_kernels::Operator op)
+            -> bool (*)(const Column&, const Column&) {
+        switch (op) {
+            case filter_kernels::Operator::EQUAL:
+                return compareStored<T, Equal>;
+            case filter_kernels::Operator::NOT_EQUAL:
+                return compareStored<T, NotEqual>;
+            case filter_kernels::Operator::LESS:
+                return compareStored<T, Less>;
+            case filter_kernels::Operator::LESS_EQUAL:
+                return compareStored<T, LessEqual>;
+            case filter_kernels::Operator::GREATER:
+                return compareStored<T, Greater>;
+            case filter_kernels::Operator::GREATER_EQUAL:
+                return compareStored<T, GreaterEqual>;
         }
+        return nullptr;
     }
 }  // namespace
 
-Restriction::Restriction(const std::string& restriction)
-: restriction(restriction) {
-    parseRestriction();
+Restriction::Restriction(query_ast::ExpressionPtr expression)
+: expression(expression) {
+    // No implementation needed
 }
 
 Restriction::~Restriction() {
     // No implementation needed
 }
 
+void Restriction::bind(const Schema& schema) {
+    this->schema = schema;
+    comparisons.clear();
+    nodes.clear();
+    rowsSinceReorder = 0;
+    bound = true;
+    if (!expression) {
+        return;
+    }
+    root = compile(*expression);
+    reorder();
+}
+
 bool Restriction::apply(const Row& row) {
-    if (restriction == "") {
+    if (!expression) {
         return true;
     }
-    // Assumes restrictions have been parsed into postfix expression
-    std::stack<bool> restrictionResultStack;
-    auto parts = string_util::split(restriction, ' ', true);
-    for (unsigned int i = 0; i < parts.size();) {
-        if (parts[i] != "and" && parts[i] != "or") {
-            bool result = evaluateRestriction(parts[i], parts[i + 1],
-                    parts[i + 2], row);
-            restrictionResultStack.push(result);
-            i += 3;
+    if (!bound) {
+        throw std::logic_error("Restriction applied before being bound");
+    }
+    if (++rowsSinceReorder == REORDER_INTERVAL) {
+        reorder();
+    }
+    return evaluate(root, row);
+}
+
+void Restriction::apply(RowBatch& batch) {
+    if (!expression) {
+        return;
+    }
+    if (!bound) {
+        throw std::logic_error("Restriction applied before being bound");
+    }
+    Selection& selection = batch.getSelection();
+    rowsSinceReorder += selection.size();
+    if (rowsSinceReorder >= REORDER_INTERVAL) {
+        reorder();
+    }
+    filter(root, batch, selection);
+}
+
+void Restriction::setParameters(
+        const std::vector<query_ast::Literal>& values) {
+    for (auto& comparison : comparisons) {
+        bool filled = false;
+        for (Operand* operand : {&comparison.left, &comparison.right}) {
+            if (operand->parameter != 0) {
+                setConstant(comparison, *operand,
+                        values.at(operand->parameter - 1));
+                const Operand& other = operand == &comparison.left
+                        ? comparison.right : comparison.left;
+                if (other.columnIndex >= 0 && comparison.op != Operator::LIKE
+                        && !isOfColumnType(operand->value)) {
+                    throw InvalidQueryException("Invalid data type: expected "
+                            + schema.getColumnMetadata(other.columnIndex)
+                                    .getColumnType() + " for parameter "
+                            + std::to_string(operand->parameter));
+                }
+                filled = true;
+            }
         }
-        if (i < parts.size() && (parts[i] == "and" || parts[i] == "or")) {
-            bool res1 = restrictionResultStack.top();
-            restrictionResultStack.pop();
-            bool res2 = restrictionResultStack.top();
-            restrictionResultStack.pop();
-            restrictionResultStack.push((parts[i] == "and") ? res1 && res2 :
-                    res1 || res2);
-            i++;
+        if (filled) {
+            compileConstants(comparison);
         }
     }
-    return restrictionResultStack.top();
 }
 
-bool Restriction::isEmpty() {
-    return restriction.empty();
+bool Restriction::isEmpty() const {
+    return !expression;
+}
+
+unsigned int Restriction::compile(const query_ast::Expression& expression) {
+    if (expression.kind == query_ast::Expression::Kind::COMPARISON) {
+        comparisons.push_back(compileComparison(expression.comparison));
+        Node node;
+        node.kind = Node::Kind::COMPARE;
+        node.comparison = comparisons.size() - 1;
+        estimate(comparisons.back(), node);
+        nodes.push_back(node);
+        return nodes.size() - 1;
+    }
+    Node::Kind kind = expression.kind == query_ast::Expression::Kind::AND
+            ? Node::Kind::AND : Node::Kind::OR;
+    unsigned int index = compile(expression.children.at(0));
+    for (unsigned int i = 1; i < expression.children.size(); i++) {
+        index = combine(kind, index, compile(expression.children[i]));
+    }
+    return index;
+}
+
+Restriction::Comparison Restriction::compileComparison(
+        const query_ast::Comparison& parsed) const {
+    Comparison comparison;
+    comparison.op = parsed.op;
+    // Resolve the columns first, since literals take the type of the column
+    // they are compared to
+    Operand* operands[] = {&comparison.left, &comparison.right};
+    const query_ast::Operand* parsedOperands[] = {&parsed.left, &parsed.right};
+    for (unsigned int i = 0; i < 2; i++) {
+        if (!parsedOperands[i]->isColumn) {
+            continue;
+        }
+        try {
+            operands[i]->columnIndex = schema.bindColumn(
+                    parsedOperands[i]->column);
+        } catch (std::invalid_argument& e) {
+            throw InvalidQueryException("Invalid value/column name: "
+                    + parsedOperands[i]->column);
+        }
+    }
+    int leftIndex = comparison.left.columnIndex;
+    int rightIndex = comparison.right.columnIndex;
+    if (leftIndex >= 0 && rightIndex >= 0 && !compareColumnTypes(
+            schema.getColumnMetadata(leftIndex).getColumnType(),
+            schema.getColumnMetadata(rightIndex).getColumnType())) {
+        throw InvalidQueryException(parsed.left.column + " and "
+                + parsed.right.column + " do not have the same types");
+    }
+    for (unsigned int i = 0; i < 2; i++) {
+        if (operands[i]->columnIndex >= 0) {
+            continue;
+        }
+        const query_ast::Literal& literal = parsedOperands[i]->literal;
+        if (literal.kind == query_ast::Literal::Kind::PARAMETER) {
+            // Filled in by setParameters()
+            operands[i]->parameter = literal.parameter;
+        } else {
+            setConstant(comparison, *operands[i], literal);
+        }
+    }
+    compileConstants(comparison);
+    return comparison;
 }
 
+void Restriction::setConstant(const Comparison& comparison, Operand& operand,
+        const query_ast::Literal& literal) const {
+    const Operand& other = &operand == &comparison.left ? comparison.right
+            : comparison.left;
+    const ColumnMetadata* metadata = (other.columnIndex >= 0
+            && comparison.op != Operator::LIKE)
+            ? &schema.getColumnMetadata(other.columnIndex) : nullptr;
+    operand.value = Column(literal.getValue(), metadata);
+}
 
-void Restriction::parseRestriction() {
-    if (restriction == "") {
+void Restriction::compileConstants(Comparison& comparison) const {
+    int leftIndex = comparison.left.columnIndex;
+    int rightIndex = comparison.right.columnIndex;
+    if (comparison.op == Operator::LIKE) {
+        if (rightIndex < 0) {
+            comparison.pattern = LikePattern(
+                    static_cast<std::string> (comparison.right.value));
+        }
         return;
     }
-    std::stack<std::string> operatorStack;
-    auto parts = string_util::split(restriction, ' ', true);
-    std::ostringstream restrictionStream;
-    for (const auto& part : parts) {
-        if (string_util::toLowercase(part) == "and"
-                || string_util::toLowercase(part) == "or" || part == "(") {
-            operatorStack.push(string_util::toLowercase(part));
-        } else if (part == ")") {
-            std::string op;
-            while ((op = operatorStack.top()) != "(") {
-                operatorStack.pop();
-                restrictionStream << op << " ";
+    int index = std::max(leftIndex, rightIndex);
+    // Parameters may be filled with values that are not stored typed
+    comparison.vectorized = false;
+    comparison.predicate = getPredicate(index >= 0
+            ? schema.getColumnMetadata(index).getValueType()
+            : ValueType::STRING, getKernelOperator(comparison.op, false));
+    if ((leftIndex < 0) != (rightIndex < 0)) {
+        // The constant was parsed with the column's metadata, so it is
+        // stored like the column's values unless it failed to parse
+        const Column& constant = leftIndex < 0 ? comparison.left.value
+                : comparison.right.value;
+        long long integer;
+        double real;
+        switch (schema.getColumnMetadata(index).getValueType()) {
+            case ValueType::INTEGER:
+            case ValueType::DATE:
+            case ValueType::TIME:
+                comparison.vectorized = constant.getStoredValue(integer);
+                break;
+            case ValueType::DOUBLE:
+                comparison.vectorized = constant.getStoredValue(real);
+                break;
+            case ValueType::STRING:
+                break;
+        }
+        if (comparison.vectorized) {
+            comparison.kernelOp = getKernelOperator(comparison.op,
+                    leftIndex < 0);
+        }
+    }
+}
+
+bool Restriction::evaluate(Comparison& comparison, const Row& row) {
+    const Column& left = comparison.left.columnIndex < 0
+            ? comparison.left.value
+            : row.getColumns().at(comparison.left.columnIndex);
+    const Column& right = comparison.right.columnIndex < 0
+            ? comparison.right.value
+            : row.getColumns().at(comparison.right.columnIndex);
+    return evaluate(comparison, left, right);
+}
+
+bool Restriction::evaluate(Comparison& comparison, const Column& left,
+        const Column& right) {
+    if (comparison.op != Operator::LIKE) {
+        return comparison.predicate(left, right);
+    }
+    // Only values that are not stored as text are formatted
+    std::string leftBuffer, rightBuffer;
+    if (comparison.right.columnIndex >= 0) {
+        std::string_view pattern = right.getText(rightBuffer);
+        if (pattern != comparison.pattern.getPattern()) {
+            comparison.pattern = LikePattern(std::string(pattern));
+        }
+    }
+    return comparison.pattern.matches(left.getText(leftBuffer));
+}
+
+void Restriction::estimate(const Comparison& comparison, Node& node) const {
+    int index = comparison.left.columnIndex >= 0 ? comparison.left.columnIndex
+            : comparison.right.columnIndex;
+    ValueType type = index >= 0 ? schema.getColumnMetadata(index)
+            .getValueType() : ValueType::STRING;
+    switch (comparison.op) {
+        case Operator::EQUAL:
+            node.selectivity = 0.1;
+            break;
+        case Operator::NOT_EQUAL:
+            node.selectivity = 0.9;
+            break;
+        case Operator::LIKE:
+            node.selectivity = 0.25;
+            break;
+        default:
+            node.selectivity = 1.0 / 3;
+            break;
+    }
+    if (comparison.op == Operator::LIKE) {
+        node.cost = comparison.right.columnIndex < 0 ? LIKE_COST
+                : DYNAMIC_LIKE_COST;
+    } else if (type == ValueType::STRING) {
+        node.cost = STRING_COMPARISON_COST;
+    } else {
+        node.cost = TYPED_COMPARISON_COST;
+    }
+}
+
+unsigned int Restriction::combine(Node::Kind kind, unsigned int first,
+        unsigned int second) {
+    Node node;
+    node.kind = kind;
+    for (unsigned int child : {first, second}) {
+        if (nodes[child].kind == kind) {
+            // (a AND b) AND c is evaluated as AND(a, b, c)
+            node.children.insert(node.children.end(),
+                    nodes[child].children.begin(), nodes[child].children.end());
+        } else {
+            node.children.push_back(child);
+        }
+    }
+    // Children always come before their parents in the vector
+    nodes.push_back(node);
+    return nodes.size() - 1;
+}
+
+void Restriction::reorder() {
+    rowsSinceReorder = 0;
+    // Children come before their parents, so they are updated first
+    for (auto& node : nodes) {
+        bool observed = node.evaluated >= MIN_OBSERVATIONS;
+        if (observed) {
+            node.selectivity = static_cast<double> (node.passed)
+                    / node.evaluated;
+        }
+        // Keep some history, but let the order follow changes in the data
+        node.evaluated /= 2;
+        node.passed /= 2;
+        if (node.kind == Node::Kind::COMPARE) {
+            continue;
+        }
+        // A condition decides an AND when it fails and an OR when it passes,
+        // so run the conditions with the lowest cost per decision first
+        bool isAnd = node.kind == Node::Kind::AND;
+        auto rank = [&](unsigned int child) {
+            double decides = isAnd ? 1 - nodes[child].selectivity
+                    : nodes[child].selectivity;
+            return decides > 0 ? nodes[child].cost / decides
+                    : std::numeric_limits<double>::max();
+        };
+        std::stable_sort(node.children.begin(), node.children.end(),
+                [&](unsigned int child1, unsigned int child2) {
+            return rank(child1) < rank(child2);
+        });
+        // Estimate the node itself from its children in their new order
+        double cost = 0, reached = 1, selectivity = isAnd ? 1 : 0;
+        for (unsigned int child : node.children) {
+            cost += reached * nodes[child].cost;
+            if (isAnd) {
+                selectivity *= nodes[child].selectivity;
+                reached = selectivity;
+            } else {
+                selectivity += (1 - selectivity) * nodes[child].selectivity;
+                reached = 1 - selectivity;
+            }
+        }
+        node.cost = cost;
+        if (!observed) {
+            node.selectivity = selectivity;
+        }
+    }
+}
+
+bool Restriction::evaluate(unsigned int index, const Row& row) {
+    Node& node = nodes[index];
+    bool result = false;
+    switch (node.kind) {
+        case Node::Kind::COMPARE:
+            result = evaluate(comparisons[node.comparison], row);
+            break;
+        case Node::Kind::AND:
+            result = true;
+            for (unsigned int child : node.children) {
+                if (!evaluate(child, row)) {
+                    result = false;
+                    break;
+                }
+            }
+            break;
+        case Node::Kind::OR:
+            result = false;
+            for (unsigned int child : node.children) {
+                if (evaluate(child, row)) {
+                    result = true;
+                    break;
+                }
+            }
+            break;
+    }
+    node.evaluated++;
+    node.passed += result;
+    return result;
+}
+
+void Restriction::filter(unsigned int index, RowBatch& batch,
+        Selection& selection) {
+    Node& node = nodes[index];
+    node.evaluated += selection.size();
+    switch (node.kind) {
+        case Node::Kind::COMPARE: {
+            Comparison& comparison = comparisons[node.comparison];
+            if (comparison.vectorized) {
+                filterVectorized(comparison, batch, selection);
+                break;
+            }
+            int leftIndex = comparison.left.columnIndex;
+            int rightIndex = comparison.right.columnIndex;
+            // Numeric values are compared one at a time as Columns
+            if (leftIndex >= 0) {
+                batch.materialize(leftIndex, selection);
+            }
+            if (rightIndex >= 0) {
+                batch.materialize(rightIndex, selection);
+            }
+            const ColumnVec* leftValues = leftIndex < 0 ? nullptr
+                    : &batch.getColumnVector(leftIndex);
+            const ColumnVec* rightValues = rightIndex < 0 ? nullptr
+                    : &batch.getColumnVector(rightIndex);
+            unsigned int kept = 0;
+            for (unsigned int position : selection) {
+                const Column& left = leftValues ? (*leftValues)[position]
+                        : comparison.left.value;
+                const Column& right = rightValues ? (*rightValues)[position]
+                        : comparison.right.value;
+                if (evaluate(comparison, left, right)) {
+                    selection[kept++] = position;
+                }
+            }
+            selection.resize(kept);
+            break;
+        }
+        case Node::Kind::AND:
+            for (unsigned int child : node.children) {
+                if (selection.empty()) {
+                    break;
+                }
+                filter(child, batch, selection);
             }
-            operatorStack.pop();
+            break;
+        case Node::Kind::OR: {
+            // Rows passed by a condition are decided, so each condition is
+            // only applied to the rows that every condition before it failed
+            Selection undecided = selection, passed, failed;
+            selection.clear();
+            for (unsigned int child : node.children) {
+                if (undecided.empty()) {
+                    break;
+                }
+                passed = undecided;
+                filter(child, batch, passed);
+                failed.clear();
+                std::set_difference(undecided.begin(), undecided.end(),
+                        passed.begin(), passed.end(),
+                        std::back_inserter(failed));
+                undecided.swap(failed);
+                selection.insert(selection.end(), passed.begin(),
+                        passed.end());
+            }
+            // Keep the rows in the order they are stored in
+            std::sort(selection.begin(), selection.end());
+            break;
+        }
+    }
+    node.passed += selection.size();
+}
+
+void Restriction::filterVectorized(Comparison& comparison, RowBatch& batch,
+        Selection& selection) {
+    bool constantFirst = comparison.left.columnIndex < 0;
+    unsigned int index = constantFirst ? comparison.right.columnIndex
+            : comparison.left.columnIndex;
+    const Column& constant = constantFirst ? comparison.left.value
+            : comparison.right.value;
+    const NumericVector& values = batch.getNumericVector(index);
+    long long integer;
+    double real;
+    if (constant.getStoredValue(real)) {
+        filter_kernels::compare(values.doubles.data(), batch.getSize(),
+                comparison.kernelOp, real, matches);
+    } else {
+        constant.getStoredValue(integer);
+        filter_kernels::compare(values.integers.data(), batch.getSize(),
+                comparison.kernelOp, integer, matches);
+    }
+    const ColumnVec& columnValues = batch.getColumnVector(index);
+    unsigned int kept = 0;
+    for (unsigned int position : selection) {
+        bool passed;
+        if (filter_kernels::isSet(values.stored, position)) {
+            passed = filter_kernels::isSet(matches, position);
+        } else if (constantFirst) {
+            passed = evaluate(comparison, constant, columnValues[position]);
         } else {
-            restrictionStream << part << " ";
+            passed = evaluate(comparison, columnValues[position], constant);
+        }
+        if (passed) {
+            selection[kept++] = position;
         }
     }
-    while (!operatorStack.empty()) {
-        restrictionStream << operatorStack.top() << " ";
-        operatorStack.pop();
+    selection.resize(kept);
+}
+
+filter_kernels::Operator Restriction::getKernelOperator(Operator op,
+        bool constantFirst) {
+    // 'constant < column' is 'column > constant'
+    switch (op) {
+        case Operator::EQUAL:
+            return filter_kernels::Operator::EQUAL;
+        case Operator::NOT_EQUAL:
+            return filter_kernels::Operator::NOT_EQUAL;
+        case Operator::LESS:
+            return constantFirst ? filter_kernels::Operator::GREATER
+                    : filter_kernels::Operator::LESS;
+        case Operator::LESS_EQUAL:
+            return constantFirst ? filter_kernels::Operator::GREATER_EQUAL
+                    : filter_kernels::Operator::LESS_EQUAL;
+        case Operator::GREATER:
+            return constantFirst ? filter_kernels::Operator::LESS
+                    : filter_kernels::Operator::GREATER;
+        case Operator::GREATER_EQUAL:
+            return constantFirst ? filter_kernels::Operator::LESS_EQUAL
+                    : filter_kernels::Operator::GREATER_EQUAL;
+        case Operator::LIKE:
+            break;
     }
-    restriction = restrictionStream.str();
-    // Erase last space
-    restriction.erase(restriction.length() - 1);
+    throw std::logic_error("LIKE has no filter kernel");
 }
 
+Restriction::Predicate Restriction::getPredicate(ValueType type,
+        filter_kernels::Operator op) {
+    switch (type) {
+        case ValueType::INTEGER:
+        case ValueType::DATE:
+        case ValueType::TIME:
+            return selectPredicate<long long>(op);
+        case ValueType::DOUBLE:
+            return selectPredicate<double>(op);
+        case ValueType::STRING:
+            break;
+    }
+    return selectPredicate<std::string_view>(op);
+}
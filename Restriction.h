@@ -8,43 +8,228 @@
 #ifndef RESTRICTION_H
 #define RESTRICTION_H
 
-#include <stack>
 #include <string>
+#include <vector>
+#include "Column.h"
+#include "filter_kernels.h"
+#include "LikePattern.h"
+#include "query_ast.h"
 #include "Row.h"
+#include "RowBatch.h"
+#include "Schema.h"
 
 /**
- * Represents a restriction on a row. Used for writing to and reading from 
- * tables.
+ * Represents a restriction on a row. Used for writing to and reading from
+ * tables. A restriction is compiled once, when it is bound to the schema of
+ * the rows it is applied to, into a tree of typed comparisons whose columns
+ * and literal values have already been resolved. AND and OR short-circuit,
+ * and their conditions are reordered so that cheap conditions that are
+ * likely to decide the result run first. Since the order adapts to the rows
+ * seen, a restriction must not be applied by several threads at once.
  */
 class Restriction {
 public:
-    Restriction(const std::string& restriction);
+    /**
+     * Creates a restriction from a parsed WHERE clause.
+     *
+     * @param expression The parsed restriction, or null for a restriction
+     * that every row matches
+     */
+    Restriction(query_ast::ExpressionPtr expression = nullptr);
     ~Restriction();
-    
+
+    /**
+     * Compiles the restriction for rows with the given schema. Column names
+     * are resolved to indexes and literal values are parsed into the type of
+     * the column they are compared to. Must be called before applying a
+     * non-empty restriction.
+     *
+     * @param schema The schema of the rows the restriction is applied to
+     * @throw InvalidQueryException if a column does not exist or is
+     * ambiguous, or two columns of different types are compared
+     */
+    void bind(const Schema& schema);
+
     /**
      * Tests whether or not the given row matches the restriction.
-     * 
+     *
      * @param row The row to test
      * @return True if the row matches the restriction, false otherwise
      */
     bool apply(const Row& row);
-    
+
+    /**
+     * Removes the rows that do not match the restriction from the selection
+     * of the given batch. Each condition is evaluated for all of the rows it
+     * is applied to at once, and the conditions of an AND are only applied to
+     * the rows that the conditions before them passed.
+     *
+     * @param batch The batch to filter
+     */
+    void apply(RowBatch& batch);
+
+    /**
+     * Fills the parameters of a bound restriction with values, parsing each
+     * value into the type of the column it is compared to. Only the
+     * comparisons holding parameters are compiled again, so a restriction
+     * of a prepared statement is bound once and filled on each execution.
+     *
+     * @param values The values of the parameters, where the value of $n is
+     * at index n - 1
+     * @throw InvalidQueryException if a value is not of the type of its
+     * column
+     */
+    void setParameters(const std::vector<query_ast::Literal>& values);
+
     /**
-     * Checks if the restriction is empty (has a value of "").
+     * Checks if the restriction is empty (every row matches it).
      */
-    bool isEmpty();
-    
+    bool isEmpty() const;
+
 private:
-    std::string restriction;
-    
+    using Operator = query_ast::Operator;
+
+    /** One side of a comparison. */
+    struct Operand {
+        int columnIndex = -1;  // Index of the column in the row, or -1
+        Column value;          // The parsed value if the operand is a literal
+        unsigned int parameter = 0;  // n if the value is filled from $n
+    };
+
+    /**
+     * Compares two operand values. Chosen once for the operator and type of
+     * each comparison when the restriction is bound.
+     */
+    using Predicate = bool (*)(const Column& left, const Column& right);
+
+    /** A comparison of the form 'left op right'. */
+    struct Comparison {
+        Operand left, right;
+        Operator op;
+        Predicate predicate = nullptr;  // Used for every operator but LIKE
+        // Compiled pattern for LIKE. When the pattern is a column, the last
+        // pattern seen is kept and only recompiled when it changes.
+        LikePattern pattern;
+        // Comparisons of a numeric, date or time column to a constant of the
+        // same type run as a filter kernel over whole batches. The kernel's
+        // operator is turned around when the constant is on the left.
+        bool vectorized = false;
+        filter_kernels::Operator kernelOp;
+    };
+
+    /** A node of the compiled expression tree. */
+    struct Node {
+        enum class Kind : unsigned char { COMPARE, AND, OR } kind;
+        unsigned int comparison = 0;  // Index of the comparison for COMPARE
+        std::vector<unsigned int> children;  // Conditions for AND and OR
+        double cost = 0;         // Estimated cost of evaluating the node
+        double selectivity = 0;  // Estimated fraction of rows that pass
+        unsigned long evaluated = 0, passed = 0;  // Observed since reordering
+    };
+
+    query_ast::ExpressionPtr expression;
+    Schema schema;  // Owns the metadata used by literal values
+    std::vector<Comparison> comparisons;
+    std::vector<Node> nodes;
+    unsigned int root = 0;
+    unsigned long rowsSinceReorder = 0;
+    bool bound = false;
+    filter_kernels::Bitmap matches;  // Reused by vectorized comparisons
+
+    /**
+     * Compiles an expression and its children into nodes.
+     *
+     * @return The index of the node for the expression
+     */
+    unsigned int compile(const query_ast::Expression& expression);
+
+    /**
+     * Compiles a comparison against the bound schema.
+     *
+     * @return The compiled comparison
+     */
+    Comparison compileComparison(const query_ast::Comparison& parsed) const;
+
+    /**
+     * Sets a literal operand of a comparison, parsing the literal into the
+     * type of the column on the other side unless the comparison is LIKE.
+     */
+    void setConstant(const Comparison& comparison, Operand& operand,
+            const query_ast::Literal& literal) const;
+
+    /**
+     * Compiles the parts of a comparison that depend on its literal
+     * operands: the LIKE pattern, the predicate and whether it runs as a
+     * filter kernel.
+     */
+    void compileConstants(Comparison& comparison) const;
+
+    /**
+     * Estimates the cost and selectivity of a compiled comparison.
+     */
+    void estimate(const Comparison& comparison, Node& node) const;
+
+    /**
+     * Adds a node combining the given nodes with AND or OR. Children that
+     * are combined in the same way are merged into the new node.
+     *
+     * @return The index of the new node
+     */
+    unsigned int combine(Node::Kind kind, unsigned int first,
+            unsigned int second);
+
+    /**
+     * Orders the conditions of every AND and OR node by how cheaply they are
+     * expected to decide the result, using the selectivity observed since the
+     * last reordering where enough rows have been seen.
+     */
+    void reorder();
+
+    /**
+     * Evaluates the node at the given index for the given row.
+     */
+    bool evaluate(unsigned int index, const Row& row);
+
+    /**
+     * Removes the rows that do not match the node at the given index from
+     * the selection, which holds positions of rows in the given batch.
+     */
+    void filter(unsigned int index, RowBatch& batch, Selection& selection);
+
+    /**
+     * Removes the rows that do not match a vectorized comparison from the
+     * selection. The comparison is run by a filter kernel on every row of
+     * the batch; rows whose value is not stored in the column's type, such
+     * as nulls, are compared one at a time.
+     */
+    void filterVectorized(Comparison& comparison, RowBatch& batch,
+            Selection& selection);
+
+    /**
+     * Gets the filter kernel operator for 'column op constant', or for
+     * 'constant op column' if the constant comes first.
+     */
+    static filter_kernels::Operator getKernelOperator(Operator op,
+            bool constantFirst);
+
+    /**
+     * Gets the predicate comparing values of the given type with the given
+     * operator. The predicates are instantiated for each pair ahead of time,
+     * so no type or operator is looked up when rows are compared.
+     */
+    static Predicate getPredicate(ValueType type,
+            filter_kernels::Operator op);
+
+    /**
+     * Evaluates a compiled comparison for the given row.
+     */
+    static bool evaluate(Comparison& comparison, const Row& row);
+
     /**
-     * Transforms the restriction into a postfix expression. A postfix 
-     * expression is one where the operator comes after both operands. For 
-     * example, the expression "restriction1 restriction2 and" would mean
-     * "restriction1 and restriction2". This makes the result of the restriction
-     * applied to a row much easier to compute.
+     * Evaluates a compiled comparison for the given operand values.
      */
-    void parseRestriction();
+    static bool evaluate(Comparison& comparison, const Column& left,
+            const Column& right);
 };
 
 #endif /* RESTRICTION_H */
@@ -6,25 +6,28 @@
  */
 #include <stdio.h>
 #include <boost/asio.hpp>
-#include <experimental/filesystem>
 #include <algorithm>
-#include <fstream>
 #include <iomanip>
 #include <list>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <variant>
 #include <vector>
 #include "constants.h"
+#include "csv_loader.h"
 #include "InvalidQueryException.h"
+#include "PreparedStatement.h"
 #include "Query.h"
+#include "query_ast.h"
 #include "Result.h"
+#include "result_writer.h"
 #include "Schema.h"
 #include "string_util.h"
 #include "table_io_util.h"
 #include "JoinedTable.h"
 
-using QueryParts = std::vector<std::string>;
 using ColumnInfo = std::vector<std::string>;
 
 // Helper functions
@@ -40,12 +43,9 @@ namespace {
      */
     void checkValidReferencedColumn(const std::string& tableName,
             const std::string& colName, const std::string& dataType) {
-        std::ifstream is(TABLE_DIRECTORY + tableName + TABLE_EXTENSION);
-        if (!is.good())
+        if (!table_io_util::tableExists(tableName))
             throw InvalidQueryException("Table " + tableName + " not found");
-        std::string schemaString;
-        std::getline(is, schemaString);
-        Schema schema(tableName, schemaString);
+        Schema schema = table_io_util::loadSchema(tableName);
         if (!schema.hasColumn(colName)) {
             throw InvalidQueryException("Column " + colName + " not found in "
                     "table " + tableName);
@@ -87,27 +87,16 @@ namespace {
     }
 
     /**
-     * Gets the path to the file for the given table.
+     * Orders the values of an inserted row as the columns of the table.
      * 
-     * @param tableName The name of the table
-     * @return The path to the table file
-     */
-    std::string getPathToTableFile(const std::string& tableName) {
-        return TABLE_DIRECTORY + tableName + TABLE_EXTENSION;
-    }
-
-    /**
-     * Inserts a new entry into the given table.
-     * 
-     * @param tableFile The file where the table is stored
      * @param schema The schema of the table
      * @param colNames The names of the columns as retrieved from the query
      * @param colValues The values of the columns as retrieved from the query
+     * @return The row to insert
      */
-    void insertIntoTable(std::string& tableName, const Schema& schema,
-            const ColumnInfo& colNames, const ColumnInfo& colValues) {
+    Row createInsertedRow(const Schema& schema, const ColumnInfo& colNames,
+            const ColumnInfo& colValues) {
         std::vector<std::string> orderedColValues;
-        unsigned int index = 0;
         for (const auto& metadata : schema.getMetadataForColumns()) {
             auto colName = metadata.getColumnName();
             unsigned int colIndex = std::distance(colNames.begin(),
@@ -116,112 +105,91 @@ namespace {
                 throw InvalidQueryException("Column not specified: " + colName);
             }
             orderedColValues.push_back(colValues[colIndex]);
-            index++;
         }
-        Table table(tableName, schema);
-        Row row = Row(schema, orderedColValues);
-        table.insertRow(row);
+        return Row(schema, orderedColValues);
     }
 
     /**
      * Executes a CREATE query.
      * 
-     * @param query The query to execute.
+     * @param create The statement to execute
      */
-    void executeCreateQuery(const Query& query) {
-        std::string tableName = query.getProperty("tableName");
-        std::string tablePath = getPathToTableFile(tableName);
+    void executeCreateQuery(const query_ast::CreateStatement& create) {
+        Schema schema;
+        for (const auto& metadata : create.columns) {
+            schema.addColumn(metadata);
+        }
         // Check referenced columns
-        Schema schema(tableName, query.getProperty("schema"));
         checkReferencedColumns(schema);
-        if (std::experimental::filesystem::exists(tablePath))
-            throw InvalidQueryException(tableName + " already exists");
-        std::experimental::filesystem::create_directory(TABLE_DIRECTORY);
-        std::ofstream out(tablePath);
-        out << query.getProperty("schema") << std::endl;
+        table_io_util::createTable(create.tableName, schema,
+                create.temporary);
     }
 
     /**
      * Executes a DROP query.
      * 
-     * @param query The query to execute.
+     * @param drop The statement to execute
      */
-    void executeDropQuery(const Query& query) {
-        std::string tableName = query.getProperty("tableName");
-        std::string tablePath = getPathToTableFile(tableName);
-        if (!std::experimental::filesystem::exists(tablePath))
+    void executeDropQuery(const query_ast::DropStatement& drop) {
+        const std::string& tableName = drop.tableName;
+        if (!table_io_util::tableExists(tableName))
             throw InvalidQueryException(tableName + " does not exist");
-        std::fstream tableFile(TABLE_DIRECTORY + tableName + TABLE_EXTENSION);
-        std::string schemaStr;
-        std::getline(tableFile, schemaStr);
-        Row row(Schema(tableName, schemaStr));
-        while (tableFile >> row) {
+        table_io_util::scanRows(tableName, [](const Row& row) {
             for (const auto& col : row.getColumns()) {
                 table_io_util::validateReferencedBy(col.getMetadata(), col);
             }
-        }
-        std::remove(tablePath.c_str());
+            return true;
+        });
+        table_io_util::dropTable(tableName);
     }
 
     /**
      * Executes an INSERT query.
      * 
-     * @param query The query to execute
+     * @param insert The statement to execute
      */
-    void executeInsertQuery(const Query& query) {
-        std::string tableName = query.getProperty("tableName");
-        std::string tablePath = getPathToTableFile(tableName);
-        if (!std::experimental::filesystem::exists(tablePath))
-            throw InvalidQueryException(tableName + " does not exist");
-        std::fstream tableFile(tablePath, std::ios::in | std::ios::app);
-        std::string schemaString;
-        std::getline(tableFile, schemaString);
-        Schema schema(tableName, schemaString);
-        QueryParts colNames =
-                string_util::split(query.getProperty("columnNames"), ',');
-        QueryParts colValues =
-                string_util::split(query.getProperty("columnValues"), ',',
-                true);
-        if (colNames.size() != colValues.size()) {
-            throw InvalidQueryException("Number of columns and values must "
-                    "match");
+    void executeInsertQuery(const query_ast::InsertStatement& insert) {
+        Schema schema = table_io_util::loadSchema(insert.tableName);
+        for (const auto& values : insert.rows) {
+            if (insert.columnNames.size() != values.size()) {
+                throw InvalidQueryException("Number of columns and values "
+                        "must match");
+            }
         }
-        for (const auto& colName : colNames) {
+        for (const auto& colName : insert.columnNames) {
             if (!schema.hasColumn(colName)) {
                 throw InvalidQueryException("Unknown column: " + colName);
             }
         }
-        insertIntoTable(tableName, schema, colNames, colValues);
+        RowVec rows;
+        rows.reserve(insert.rows.size());
+        for (const auto& values : insert.rows) {
+            ColumnInfo colValues;
+            for (const auto& value : values) {
+                colValues.push_back(value.text);
+            }
+            rows.push_back(createInsertedRow(schema, insert.columnNames,
+                    colValues));
+        }
+        // The rows are validated together and written at once
+        table_io_util::openTable(insert.tableName)->insertRows(rows);
     }
 
     /**
      * Executes an UPDATE query.
      * 
-     * @param query The query to execute
+     * @param update The statement to execute
      */
-    void executeUpdateQuery(const Query& query) {
-        std::string tableName = query.getProperty("tableName");
-        std::string tablePath = TABLE_DIRECTORY + tableName + TABLE_EXTENSION;
-        if (!std::experimental::filesystem::exists(tablePath)) {
-            throw InvalidQueryException(tableName + " does not exist");
+    void executeUpdateQuery(const query_ast::UpdateStatement& update) {
+        auto table = table_io_util::openTable(update.tableName);
+        UpdateMap nameValueMap;
+        for (const auto& assignment : update.assignments) {
+            nameValueMap[assignment.first] = assignment.second.text;
         }
-        ColumnInfo colNames =
-                string_util::split(query.getProperty("columns"), ',', true);
-        ColumnInfo colValues =
-                string_util::split(query.getProperty("values"), ',', true);
-        std::unordered_map<std::string, std::string> nameValueMap;
-        for (unsigned int i = 0; i < colNames.size(); i++) {
-            nameValueMap[colNames[i]] = colValues[i];
-        }
-        std::ifstream in(tablePath);
-        std::string schemaStr;
-        std::getline(in, schemaStr);
-        Schema schema(tableName, schemaStr);
-        Table table(tableName, schema);
-        if (query.getProperty("restrictions") == "") {
-            table.updateRows(nameValueMap);
+        if (!update.restriction) {
+            table->updateRows(nameValueMap);
         } else {
-            table.setRestrictions(query.getProperty("restrictions"))
+            table->setRestrictions(update.restriction)
                     .updateRows(nameValueMap);
         }
     }
@@ -229,36 +197,41 @@ namespace {
     /**
      * Executes a DELETE query.
      * 
-     * @param query The query to execute
+     * @param deleteStatement The statement to execute
      */
-    void executeDeleteQuery(const Query& query) {
-        std::string tableName = query.getProperty("tableName");
-        std::string tablePath = TABLE_DIRECTORY + tableName + TABLE_EXTENSION;
-        if (!std::experimental::filesystem::exists(tablePath)) {
-            throw InvalidQueryException(tableName + " does not exist");
-        }
-        std::ifstream in(tablePath);
-        std::string schemaStr;
-        std::getline(in, schemaStr);
-        Schema schema(tableName, schemaStr);
-        Table table(tableName, schema);
-        if (query.getProperty("restrictions") == "") {
-            table.deleteRows();
+    void executeDeleteQuery(const query_ast::DeleteStatement& deleteStatement) {
+        auto table = table_io_util::openTable(deleteStatement.tableName);
+        if (!deleteStatement.restriction) {
+            table->deleteRows();
         } else {
-            table.setRestrictions(query.getProperty("restrictions"))
+            table->setRestrictions(deleteStatement.restriction)
                     .deleteRows();
         }
     }
 
+    /**
+     * Executes a COPY query.
+     * 
+     * @param copy The statement to execute
+     */
+    void executeCopyQuery(const query_ast::CopyStatement& copy) {
+        csv_loader::Options options;
+        options.delimiter = copy.delimiter;
+        options.header = copy.header;
+        options.parallelism = copy.parallelism;
+        csv_loader::loadFile(copy.tableName, copy.path, options);
+    }
+
     /**
      * Retrieves a table from the given URL and stores it in the given
      * shared_ptr.
      * 
-     * @param query The query being executed
+     * @param select The statement being executed
      * @param url The URL to retrieve that table from
      * @param table The shared_ptr to store the table in
      */
-    void extractTableFromURL(const Query& query, const std::string& url,
+    void extractTableFromURL(const query_ast::SelectStatement& select,
+            const std::string& url,
             std::shared_ptr<Table>& table) {
         using namespace boost::asio::ip;
         auto stopIndex = url.find('/', 7);
@@ -293,57 +266,59 @@ namespace {
         } else {
             Table tableToJoin(stream, url, Schema(url, schemaStr.str()));
             auto joinedTable = table->joinTo(tableToJoin,
-                    query.getProperty("joinConditions"));
+                    select.joinConditions);
             table = std::make_shared<JoinedTable>(joinedTable);
         }
     }
 
     /**
-     * Executes a SELECT query.
+     * Executes a SELECT query. Queries with an INTO OUTFILE clause write
+     * their rows to the file and leave the table empty.
      * 
-     * @param query The query to execute
+     * @param select The statement to execute
+     * @param table Set to the table the rows are extracted from
      */
-    void executeSelectQuery(const Query& query, std::shared_ptr<Table>& table) {
-        auto tableNames = string_util::split(query.getProperty("tableNames"),
-                ',');
-        for (const auto& tableName : tableNames) {
+    void executeSelectQuery(const query_ast::SelectStatement& select,
+            std::shared_ptr<Table>& table) {
+        for (const auto& tableName : select.tableNames) {
             if (tableName.find("http://") == 0) {
-                extractTableFromURL(query, tableName, table);
+                extractTableFromURL(select, tableName, table);
                 if (!table) {
                     return;
                 }
             } else {
-                std::string tablePath = TABLE_DIRECTORY + tableName
-                        + TABLE_EXTENSION;
-                if (!std::experimental::filesystem::exists(tablePath)) {
-                    throw InvalidQueryException(tableName + " does not exist");
-                }
-                std::ifstream in(tablePath);
-                std::string schemaStr;
-                std::getline(in, schemaStr);
-                Schema schema(tableName, schemaStr);
+                auto tableToJoin = table_io_util::openTable(tableName);
+                tableToJoin->setParallelism(select.parallelism);
                 if (!table) {
-                    table = std::make_shared<Table>(tableName, schema);
+                    table = tableToJoin;
                 } else {
-                    Table tableToJoin(tableName, schema);
-                    auto joinedTable = table->joinTo(tableToJoin,
-                            query.getProperty("joinConditions"));
+                    auto joinedTable = table->joinTo(*tableToJoin,
+                            select.joinConditions);
                     table = std::make_shared<JoinedTable>(joinedTable);
                 }
             }
         }
-        if (query.getProperty("restrictions") != "") {
-            table->setRestrictions(query.getProperty("restrictions"));
+        if (select.restriction) {
+            table->setRestrictions(select.restriction);
+        }
+        table->orderBy(select.orderBy, select.desc)
+                .filterDistinct(select.distinct)
+                .filterColumnsByName(select.columnNames);
+        if (!select.outfile.empty()) {
+            // The rows are written to the file instead of being returned
+            result_writer::writeFile(*table, select.outfile, select.format);
+            table.reset();
         }
-        table->orderBy(query.getProperty("orderBy"),
-                query.hasProperty("desc"))
-                .filterDistinct(query.hasProperty("distinct"))
-                .filterColumnsByName(query.getProperty("columnNames"));
     }
 }  // namespace
 
-Result::Result(const Query& query) : query(query) {
-    executeQuery();
+Result::Result(const Query& query) {
+    executeQuery(query);
+}
+
+Result::Result(const PreparedStatement& statement,
+        const std::vector<query_ast::Literal>& arguments) {
+    executePrepared(statement, arguments);
 }
 
 Result::~Result() {
@@ -357,24 +332,51 @@ Result& Result::operator>>(Row& row) {
     return *this;
 }
 
+bool Result::nextBatch(RowBatch& batch) {
+    return table && table->nextBatch(batch);
+}
+
 Result::operator bool() {
     return table && *table;
 }
 
-void Result::executeQuery() {
+void Result::executeQuery(const Query& query) {
+    if (query.getParameterCount() != 0) {
+        throw InvalidQueryException("Parameters can only be used in prepared "
+                "statements");
+    }
+    const query_ast::Statement& statement = query.getStatement();
     if (query.getType() == Query::QueryType::CREATE) {
-        executeCreateQuery(query);
+        executeCreateQuery(std::get<query_ast::CreateStatement>(statement));
     } else if (query.getType() == Query::QueryType::DROP) {
-        executeDropQuery(query);
+        executeDropQuery(std::get<query_ast::DropStatement>(statement));
     } else if (query.getType() == Query::QueryType::INSERT) {
-        executeInsertQuery(query);
+        executeInsertQuery(std::get<query_ast::InsertStatement>(statement));
     } else if (query.getType() == Query::QueryType::UPDATE) {
-        executeUpdateQuery(query);
+        executeUpdateQuery(std::get<query_ast::UpdateStatement>(statement));
     } else if (query.getType() == Query::QueryType::DELETE) {
-        executeDeleteQuery(query);
+        executeDeleteQuery(std::get<query_ast::DeleteStatement>(statement));
     } else if (query.getType() == Query::QueryType::SELECT) {
-        executeSelectQuery(query, table);
+        executeSelectQuery(std::get<query_ast::SelectStatement>(statement),
+                table);
+    } else if (query.getType() == Query::QueryType::COPY) {
+        executeCopyQuery(std::get<query_ast::CopyStatement>(statement));
+    } else if (query.getType() == Query::QueryType::PREPARE) {
+        const auto& prepare = std::get<query_ast::PrepareStatement>(statement);
+        PreparedStatement::add(prepare.name,
+                std::make_shared<PreparedStatement>(prepare.queryString));
+    } else if (query.getType() == Query::QueryType::EXECUTE) {
+        const auto& execute = std::get<query_ast::ExecuteStatement>(statement);
+        executePrepared(*PreparedStatement::find(execute.name),
+                execute.arguments);
     } else {
         throw std::invalid_argument("Invalid query type");
     }
 }
+
+void Result::executePrepared(const PreparedStatement& statement,
+        const std::vector<query_ast::Literal>& arguments) {
+    if (!statement.executePlan(arguments, table)) {
+        executeQuery(statement.bind(arguments));
+    }
+}
@@ -11,6 +11,7 @@
 #include "Table.h"
 
 class Query;  // Forward declaration of class Query
+class PreparedStatement;  // Forward declaration of class PreparedStatement
 
 /**
  * Represents the result of a query. This class can be used to extract rows
@@ -19,23 +20,50 @@ class Query;  // Forward declaration of class Query
 class Result {
 public:
     Result(const Query& query);
+
+    /**
+     * Executes a prepared statement with the given values.
+     *
+     * @param statement The statement
+     * @param arguments The values, in the order of the parameters
+     */
+    Result(const PreparedStatement& statement,
+            const std::vector<query_ast::Literal>& arguments);
     Result(const Result& result);
     ~Result();
     
     // Extraction operator
     Result& operator>>(Row& row);
     
+    /**
+     * Extracts the next batch of rows returned by the query.
+     * 
+     * @param batch The batch to store the rows in
+     * @return False if there are no more rows, true otherwise
+     */
+    bool nextBatch(RowBatch& batch);
+    
     operator bool();
     
 private:
     bool hasRestrictedTable = false;
-    const Query& query;  // Needs to be a reference due to circular dependencies
     std::shared_ptr<Table> table;
     
     /**
-     * Executes the query passed into the constructor.
+     * Executes the given query. PREPARE queries store the prepared statement,
+     * and EXECUTE queries execute the stored statement with its parameters
+     * bound.
+     * 
+     * @param query The query to execute
+     */
+    void executeQuery(const Query& query);
+
+    /**
+     * Executes a prepared statement through its bound plan, or by binding
+     * the values into its query if it has none.
      */
-    void executeQuery();
+    void executePrepared(const PreparedStatement& statement,
+            const std::vector<query_ast::Literal>& arguments);
 };
 
 #endif /* RESULT_H */
@@ -5,29 +5,25 @@
  * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
  */
 
+#include <cctype>
 #include <iostream>
 #include <iomanip>
-#include <sstream>
 #include <string>
+#include <string_view>
 #include "Column.h"
 #include "Row.h"
 #include "string_util.h"
 #include "InvalidQueryException.h"
 
 std::istream& operator>>(std::istream& is, Row& row) {
-    // Clear state information
-    row.columns.clear();
+    // Reused between rows so that reading a line does not allocate
+    static thread_local std::string rowLine;
     row.currentIndex = 0;
-    std::string rowLine;
-    std::getline(is, rowLine);
-    std::istringstream rowScanner(rowLine);
-    std::string colValue;
-    unsigned int index = 0;
-    while (rowScanner >> std::quoted(colValue)) {
-        row.columns.push_back(Column(colValue, 
-                row.schema.getMetadataForColumns()[index]));
-        index++;
+    if (!std::getline(is, rowLine)) {
+        row.columns.clear();
+        return is;
     }
+    row.decodeLine(rowLine);
     return is;
 }
 
@@ -43,10 +39,10 @@ std::ostream& operator<<(std::ostream& os, const Row& row) {
 
 // Row::Row(const Schema& schema) implemented in header
 
-Row::Row(const Schema& schema, const ColumnValues& values) {
+Row::Row(const Schema& schema, const ColumnValues& values) : schema(schema) {
     for (unsigned int i = 0; i < schema.getMetadataForColumns().size(); i++) {
         columns.push_back(Column(string_util::getEscapedString(values[i]), 
-                schema.getMetadataForColumns()[i]));
+                &this->schema.getColumnMetadata(i)));
     }
 }
 
@@ -55,33 +51,35 @@ Row::~Row() {
     // No implementation needed
 }
 
-Column Row::getColumn(const std::string& colName) const {
-    std::string colNameCopy = colName;
-    std::string tableName;
-    Column ret;
+const Column& Row::getColumn(const std::string& colName) const {
+    std::string_view name = colName;
+    std::string tableName, unqualifiedName;
+    const Column* ret = nullptr;
     if (colName.find('.') != std::string::npos) {
         auto parts = string_util::split(colName, '.', true);
         tableName = string_util::extractQuoted(parts[0]);
-        colNameCopy = string_util::extractQuoted(parts[1]);
+        unqualifiedName = string_util::extractQuoted(parts[1]);
+        name = unqualifiedName;
     }
     for (const auto& col : columns) {
-        if (col.getMetadata().getColumnName() == colNameCopy) {
+        if (col.getMetadata().getColumnName() == name) {
             if (tableName.empty() && ret) {
-                throw InvalidQueryException("Ambiguous column: " + colNameCopy);
+                throw InvalidQueryException("Ambiguous column: " 
+                        + std::string(name));
             }
             if (tableName.empty() 
                     || col.getMetadata().getTableName() == tableName) {
-                ret = col;
+                ret = &col;
             }
         }
     }
     if (ret) {
-        return ret;
+        return *ret;
     }
     throw std::invalid_argument("Column " + colName + " does not exist");
 }
 
-ColumnVec Row::getColumns() const {
+const ColumnVec& Row::getColumns() const {
     return columns;
 }
 
@@ -94,21 +92,39 @@ int Row::getColumnIndex(const std::string& colName) const {
     return -1;
 }
 
-void Row::orderAndFilterColumns(const ColumnNames& colNames) {
-    if (colNames.size() == 0) {
+void Row::copyColumnsFrom(const Row& row, const ColumnIndexes& indexes) {
+    setSchema(row.schema);
+    if (indexes.size() == 0) {
+        // Assigns element by element while the sizes match
+        columns = row.columns;
         return;
     }
-    ColumnVec newColumns;
-    for (const auto& name : colNames) {
-        newColumns.push_back(getColumn(name));
+    columns.resize(indexes.size());
+    for (unsigned int i = 0; i < indexes.size(); i++) {
+        columns[i] = row.columns.at(indexes[i]);
+    }
+}
+
+void Row::setSchema(const Schema& schema) {
+    if (!this->schema.sharesMetadataWith(schema)) {
+        this->schema = schema;
     }
-    columns = newColumns;
+    currentIndex = 0;
+}
+
+void Row::clear() {
+    columns.clear();
+    currentIndex = 0;
 }
 
 Column& Row::operator[](unsigned int index) {
     return columns[index];
 }
 
+const Column& Row::operator[](unsigned int index) const {
+    return columns[index];
+}
+
 Row& Row::operator>>(Column& col) {
     if (currentIndex == columns.size()) {
         currentIndex++;
@@ -132,7 +148,7 @@ void Row::merge(const Row& otherRow) {
 void Row::fillBlank(unsigned int count) {
     columns.clear();
     for (unsigned int i = 0; i < count; i++) {
-        columns.push_back(Column("", schema.getMetadataForColumns()[i]));
+        columns.push_back(Column("", &schema.getColumnMetadata(i)));
     }
 }
 
@@ -142,3 +158,48 @@ void Row::checkInitialization() const {
         throw std::logic_error("Row not initialized");
     }
 }
+
+void Row::decodeLine(std::string& line) {
+    // Values are written in the format produced by std::quoted: either a
+    // word, or a quoted string in which \ escapes the next character
+    char* data = &line[0];
+    std::size_t size = line.size(), read = 0;
+    std::size_t colCount = schema.getMetadataForColumns().size();
+    unsigned int index = 0;
+    while (index < colCount) {
+        while (read < size && std::isspace(static_cast<unsigned char> 
+                (data[read]))) {
+            read++;
+        }
+        if (read >= size) {
+            break;
+        }
+        std::size_t start = read, end;
+        if (data[read] == '"') {
+            start = end = ++read;
+            while (read < size && data[read] != '"') {
+                if (data[read] == '\\' && read + 1 < size) {
+                    read++;
+                }
+                data[end++] = data[read++];
+            }
+            read++;  // Skip the closing quote
+        } else {
+            while (read < size && !std::isspace(static_cast<unsigned char> 
+                    (data[read]))) {
+                read++;
+            }
+            end = read;
+        }
+        std::string_view value(data + start, end - start);
+        const ColumnMetadata* metadata = &schema.getColumnMetadata(index);
+        if (index < columns.size()) {
+            columns[index].setValue(value, metadata);
+        } else {
+            columns.emplace_back();
+            columns.back().setValue(value, metadata);
+        }
+        index++;
+    }
+    columns.resize(index);
+}
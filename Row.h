@@ -17,6 +17,12 @@
 using ColumnVec = std::vector<Column>;
 using ColumnNames = std::vector<std::string>;
 using ColumnValues = std::vector<std::string>;
+using ColumnIndexes = std::vector<unsigned int>;
+
+class Row;
+using RowVec = std::vector<Row>;
+
+class RowBatch;  // Forward declaration of class RowBatch
 
 /**
  * Represents a row in a table. Columns can be accessed by name using
@@ -26,22 +32,29 @@ class Row {
 public:
     friend std::istream& operator>>(std::istream& is, Row& row);
     friend std::ostream& operator<<(std::ostream& os, const Row& row);
+    friend class RowBatch;
+    friend class ParallelScan;
     Row() {}
     Row(const Schema& schema) : schema(schema) {}
     Row(const Schema& schema, const ColumnValues& values);
+    Row(const Row& row) = default;
+    Row(Row&& row) = default;
     ~Row();
     
+    Row& operator=(const Row& row) = default;
+    Row& operator=(Row&& row) = default;
+    
     /**
      * Gets the column with the given name.
      * @param colName The name of the column to search for
      * @return The column with the given name
      */
-    Column getColumn(const std::string& colName) const;
+    const Column& getColumn(const std::string& colName) const;
     
     /**
      * Gets the columns in the row.
      */
-    ColumnVec getColumns() const;
+    const ColumnVec& getColumns() const;
     
     /**
      * Gets the index of the column with the given name.
@@ -51,12 +64,25 @@ public:
     int getColumnIndex(const std::string& colName) const;
     
     /**
-     * Changes the columns stored in the row to only match the columns with
-     * the provided names, in the order they are given.
+     * Replaces the columns in this row with the columns of the given row at
+     * the provided indexes, in the order they are given, or with all of its
+     * columns if no indexes are given. The storage of this row's columns is
+     * reused.
      * 
-     * @param colNames The names of the columns to order and filter by
+     * @param row The row to copy columns from
+     * @param indexes The indexes of the columns to copy, as bound by 
+     * Schema::bindColumn()
+     */
+    void copyColumnsFrom(const Row& row, const ColumnIndexes& indexes);
+    
+    /**
+     * Sets the schema used when extracting rows into this row. The row keeps
+     * its columns so that their storage can be reused.
      */
-    void orderAndFilterColumns(const ColumnNames& colNames);
+    void setSchema(const Schema& schema);
+    
+    /** Removes every column from the row. */
+    void clear();
     
     /**
      * Gets the column at the given index.
@@ -64,6 +90,7 @@ public:
      * @return The column at the given index
      */
     Column& operator[](unsigned int index);
+    const Column& operator[](unsigned int index) const;
     
     /**
      * Extracts the next column from this row.
@@ -93,6 +120,13 @@ private:
      * Checks that this row has been initialized with a schema.
      */
     void checkInitialization() const;  
+    
+    /**
+     * Decodes the columns stored in the given line into this row, reusing
+     * the existing columns. Quoted values are unescaped in place, so the
+     * line is modified.
+     */
+    void decodeLine(std::string& line);
 };
 
 #endif /* ROW_H */
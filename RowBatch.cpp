@@ -0,0 +1,191 @@
+/*
+ * File:   RowBatch.cpp
+ * Implementation file for the RowBatch class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <cstdint>
+#include <vector>
+#include "constants.h"
+#include "filter_kernels.h"
+#include "RowBatch.h"
+
+RowBatch::RowBatch() {
+    selection.reserve(BATCH_SIZE);
+}
+
+RowBatch::~RowBatch() {
+    // No implementation needed
+}
+
+void RowBatch::reset(const Schema& schema) {
+    if (!this->schema.sharesMetadataWith(schema)) {
+        this->schema = schema;
+    }
+    columns.resize(schema.getMetadataForColumns().size());
+    for (auto& values : columns) {
+        if (values.size() < BATCH_SIZE) {
+            values.resize(BATCH_SIZE);
+        }
+    }
+    numericColumns.resize(columns.size());
+    for (unsigned int i = 0; i < columns.size(); i++) {
+        NumericVector& vector = numericColumns[i];
+        ValueType type = schema.getColumnMetadata(i).getValueType();
+        vector.numeric = type != ValueType::STRING;
+        vector.real = type == ValueType::DOUBLE;
+        if (!vector.numeric) {
+            continue;
+        }
+        // Every bit is written as its row is appended
+        vector.stored.resize((BATCH_SIZE + 63) / 64);
+        if (vector.real) {
+            vector.doubles.resize(BATCH_SIZE);
+        } else {
+            vector.integers.resize(BATCH_SIZE);
+        }
+    }
+    projection.clear();
+    selection.clear();
+    size = 0;
+}
+
+const Schema& RowBatch::getSchema() const {
+    return schema;
+}
+
+unsigned int RowBatch::getSize() const {
+    return size;
+}
+
+bool RowBatch::isFull() const {
+    return size == BATCH_SIZE;
+}
+
+void RowBatch::appendRow(const Row& row) {
+    const ColumnVec& values = row.getColumns();
+    for (unsigned int i = 0; i < columns.size(); i++) {
+        if (i < values.size()) {
+            appendValue(i, values[i]);
+        } else {
+            // Rows shorter than the schema are padded with undefined columns
+            appendValue(i, Column());
+        }
+    }
+    selection.push_back(size++);
+}
+
+void RowBatch::appendJoinedRow(const RowBatch& batch, unsigned int position,
+        const Row& row) {
+    unsigned int count = batch.getColumnCount();
+    const ColumnVec& values = row.getColumns();
+    for (unsigned int i = 0; i < columns.size(); i++) {
+        if (i < count) {
+            appendValue(i, batch.getColumn(i, position));
+        } else if (i - count < values.size()) {
+            appendValue(i, values[i - count]);
+        } else {
+            appendValue(i, Column());
+        }
+    }
+    selection.push_back(size++);
+}
+
+const ColumnVec& RowBatch::getColumnVector(unsigned int index) const {
+    return columns[index];
+}
+
+void RowBatch::materialize(unsigned int index, const Selection& positions) {
+    const NumericVector& vector = numericColumns[index];
+    if (!vector.numeric) {
+        return;
+    }
+    const ColumnMetadata* metadata = &schema.getColumnMetadata(index);
+    ColumnVec& values = columns[index];
+    for (unsigned int position : positions) {
+        if (!filter_kernels::isSet(vector.stored, position)) {
+            continue;
+        } else if (vector.real) {
+            values[position].setStoredValue(vector.doubles[position],
+                    metadata);
+        } else {
+            values[position].setStoredValue(vector.integers[position],
+                    metadata);
+        }
+    }
+}
+
+void RowBatch::materialize() {
+    if (projection.empty()) {
+        for (unsigned int i = 0; i < columns.size(); i++) {
+            materialize(i, selection);
+        }
+        return;
+    }
+    for (unsigned int index : projection) {
+        materialize(index, selection);
+    }
+}
+
+const NumericVector& RowBatch::getNumericVector(unsigned int index) const {
+    return numericColumns[index];
+}
+
+Selection& RowBatch::getSelection() {
+    return selection;
+}
+
+const Selection& RowBatch::getSelection() const {
+    return selection;
+}
+
+void RowBatch::project(const ColumnIndexes& indexes) {
+    if (indexes.empty()) {
+        return;
+    }
+    if (projection.empty()) {
+        projection = indexes;
+        return;
+    }
+    // Indexes refer to the columns of the current projection
+    ColumnIndexes composed;
+    for (unsigned int index : indexes) {
+        composed.push_back(projection.at(index));
+    }
+    projection.swap(composed);
+}
+
+unsigned int RowBatch::getColumnCount() const {
+    return projection.empty() ? columns.size() : projection.size();
+}
+
+const Column& RowBatch::getColumn(unsigned int index,
+        unsigned int position) const {
+    return columns[projection.empty() ? index : projection[index]][position];
+}
+
+void RowBatch::copyRow(unsigned int position, Row& row) const {
+    row.setSchema(schema);
+    unsigned int count = getColumnCount();
+    row.columns.resize(count);
+    for (unsigned int i = 0; i < count; i++) {
+        row.columns[i] = getColumn(i, position);
+    }
+}
+
+void RowBatch::appendValue(unsigned int index, const Column& value) {
+    NumericVector& vector = numericColumns[index];
+    if (vector.numeric) {
+        bool stored = vector.real ? value.getStoredValue(vector.doubles[size])
+                : value.getStoredValue(vector.integers[size]);
+        std::uint64_t bit = std::uint64_t(1) << (size % 64);
+        if (stored) {
+            // The Column is built by materialize() if the row is selected
+            vector.stored[size / 64] |= bit;
+            return;
+        }
+        vector.stored[size / 64] &= ~bit;
+    }
+    columns[index][size] = value;
+}
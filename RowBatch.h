@@ -0,0 +1,177 @@
+/*
+ * File:   RowBatch.h
+ * Header file for the RowBatch class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef ROWBATCH_H
+#define ROWBATCH_H
+
+#include <vector>
+#include "Column.h"
+#include "filter_kernels.h"
+#include "Row.h"
+#include "Schema.h"
+
+using Selection = std::vector<unsigned int>;
+
+/**
+ * The values of a numeric, date or time column of a batch laid out
+ * contiguously, for the filter kernels. The stored bitmap is the column's
+ * validity bitmap: the bits of nulls, and of values that failed to parse
+ * and are kept as text, are clear, and their slots in the vector hold
+ * arbitrary values.
+ */
+struct NumericVector {
+    bool numeric = false;  // Whether the column has a numeric value type
+    bool real = false;     // Whether the values are stored in doubles
+    std::vector<long long> integers;  // For int, bigint, date and time
+    std::vector<double> doubles;      // For float and double
+    filter_kernels::Bitmap stored;    // The rows whose value is in the vector
+};
+
+/**
+ * A batch of up to BATCH_SIZE rows exchanged between operators in vectorized
+ * execution. The values are stored by column, so an operator can work
+ * through one column of every row at a time. Rows are never removed from a
+ * batch; instead, the selection lists the positions of the rows that are
+ * still part of the result, in ascending order. The storage of the columns
+ * is reused from one batch to the next.
+ *
+ * The values of numeric, date and time columns are stored in contiguous
+ * typed vectors as the rows are appended, and the filter kernels run on
+ * them. Their Columns are only built by materialize(), for the rows still
+ * selected once the batch has been filtered; the other values, such as
+ * nulls, are stored as Columns right away.
+ */
+class RowBatch {
+public:
+    RowBatch();
+    RowBatch(const RowBatch& batch) = default;
+    RowBatch(RowBatch&& batch) = default;
+    ~RowBatch();
+
+    RowBatch& operator=(const RowBatch& batch) = default;
+    RowBatch& operator=(RowBatch&& batch) = default;
+
+    /**
+     * Empties the batch and prepares it for rows with the given schema.
+     */
+    void reset(const Schema& schema);
+
+    /** Gets the schema of the rows in the batch. */
+    const Schema& getSchema() const;
+
+    /** Gets the number of rows stored in the batch, selected or not. */
+    unsigned int getSize() const;
+
+    /** Checks if no more rows can be appended to the batch. */
+    bool isFull() const;
+
+    /**
+     * Appends a row to the batch and selects it.
+     *
+     * @param row The row to append, with the columns of the batch's schema
+     */
+    void appendRow(const Row& row);
+
+    /**
+     * Appends a row made of the columns of a row in another batch followed
+     * by the columns of the given row, and selects it. Used for joins.
+     *
+     * @param batch The batch holding the first part of the row
+     * @param position The position of the row in that batch
+     * @param row The row holding the rest of the columns
+     */
+    void appendJoinedRow(const RowBatch& batch, unsigned int position,
+            const Row& row);
+
+    /**
+     * Gets the values of a column for every row in the batch. Columns are
+     * indexed as in the batch's schema, whether or not they are projected.
+     * The values of a numeric, date or time column are only set for the
+     * rows it has been materialized for.
+     *
+     * @param index The index of the column in the schema
+     */
+    const ColumnVec& getColumnVector(unsigned int index) const;
+
+    /**
+     * Builds the Columns of a numeric, date or time column from its typed
+     * vector for the given rows. Other columns are left as they are.
+     *
+     * @param index The index of the column in the schema
+     * @param positions The positions of the rows
+     */
+    void materialize(unsigned int index, const Selection& positions);
+
+    /**
+     * Builds the Columns of the projected columns for the selected rows, so
+     * that every value read through getColumn() or copyRow() is set. Called
+     * once the batch is filtered, before it is read by other operators.
+     */
+    void materialize();
+
+    /**
+     * Gets the values of a numeric, date or time column in contiguous
+     * storage. Rows whose value is not stored in the column's type, such as
+     * nulls, are left out of the stored bitmap.
+     *
+     * @param index The index of the column in the schema, which must have a
+     * numeric, date or time type
+     */
+    const NumericVector& getNumericVector(unsigned int index) const;
+
+    /**
+     * Gets the positions of the rows that are part of the result.
+     */
+    Selection& getSelection();
+    const Selection& getSelection() const;
+
+    /**
+     * Restricts the columns of the rows in the batch to the given columns,
+     * in the order they are listed. No values are copied.
+     *
+     * @param indexes The indexes of the columns to keep, as bound by
+     * Schema::bindColumn(), or no indexes to keep every column
+     */
+    void project(const ColumnIndexes& indexes);
+
+    /** Gets the number of columns in the rows after projection. */
+    unsigned int getColumnCount() const;
+
+    /**
+     * Gets a column of a row after projection.
+     *
+     * @param index The index of the column in the projected row
+     * @param position The position of the row in the batch
+     */
+    const Column& getColumn(unsigned int index, unsigned int position) const;
+
+    /**
+     * Copies the projected columns of a row in the batch into the given row,
+     * reusing its storage.
+     *
+     * @param position The position of the row in the batch
+     * @param row The row to copy the columns into
+     */
+    void copyRow(unsigned int position, Row& row) const;
+
+private:
+    Schema schema;
+    std::vector<ColumnVec> columns;  // The values of each column, by position
+    std::vector<NumericVector> numericColumns;  // Written by appendValue()
+    ColumnIndexes projection;  // The projected columns, or empty for all
+    Selection selection;
+    unsigned int size = 0;
+
+    /**
+     * Stores a value of the row being appended in its column, and in the
+     * column's numeric vector if it has one.
+     */
+    void appendValue(unsigned int index, const Column& value);
+};
+
+#endif /* ROWBATCH_H */
+
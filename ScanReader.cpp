@@ -0,0 +1,124 @@
+/*
+ * File:   ScanReader.cpp
+ * Implementation file for the ScanReader class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <system_error>
+#include "constants.h"
+#include "PreadScanReader.h"
+#include "ScanReader.h"
+#include "UringScanReader.h"
+
+// Helper variables, classes and functions
+namespace {
+    /** The mode used when opening readers. */
+    std::atomic<ScanReader::Mode> scanMode(ScanReader::Mode::ASYNC);
+
+    /**
+     * A scan reader for files that fit in a single block. The whole file is
+     * read with one pread() call, so no ring or reader thread is set up.
+     */
+    class SingleBlockScanReader : public ScanReader {
+    public:
+        SingleBlockScanReader(int fd, std::size_t fileSize)
+        : ScanReader(fd, fileSize) {}
+
+        virtual bool nextBlock(const char*& data, std::size_t& size) override {
+            if (done) {
+                return false;
+            }
+            done = true;
+            buffer.reset(new char[fileSize]);
+            size = readFully(buffer.get(), fileSize, 0);
+            data = buffer.get();
+            return size > 0;
+        }
+
+    private:
+        std::unique_ptr<char[]> buffer;
+        bool done = false;
+    };
+
+    /**
+     * Opens the file at the given path for a sequential scan.
+     *
+     * @return The file descriptor, or -1 if the file could not be opened
+     */
+    int openForScan(const std::string& path, std::size_t& fileSize) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return -1;
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0) {
+            close(fd);
+            return -1;
+        }
+        fileSize = static_cast<std::size_t>(st.st_size);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        return fd;
+    }
+}  // namespace
+
+ScanReader::~ScanReader() {
+    close(fd);
+}
+
+void ScanReader::setMode(Mode mode) {
+    scanMode = mode;
+}
+
+std::unique_ptr<ScanReader> ScanReader::open(const std::string& path) {
+    std::size_t fileSize;
+    int fd = openForScan(path, fileSize);
+    if (fd < 0) {
+        return nullptr;
+    }
+    if (fileSize <= SCAN_BLOCK_SIZE) {
+        return std::unique_ptr<ScanReader>(
+                new SingleBlockScanReader(fd, fileSize));
+    }
+    if (scanMode == Mode::ASYNC && UringScanReader::isAvailable()) {
+        try {
+            return std::unique_ptr<ScanReader>(
+                    new UringScanReader(fd, fileSize));
+        } catch (const std::exception& e) {
+            // The ring could not be set up for this scan. Its reader closed
+            // the file on the way out, so reopen it for a pread scan.
+            fd = openForScan(path, fileSize);
+            if (fd < 0) {
+                return nullptr;
+            }
+        }
+    }
+    return std::unique_ptr<ScanReader>(new PreadScanReader(fd, fileSize));
+}
+
+std::size_t ScanReader::readFully(char* buffer, std::size_t count,
+        std::size_t offset) {
+    std::size_t total = 0;
+    while (total < count) {
+        ssize_t result = pread(fd, buffer + total, count - total,
+                offset + total);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(),
+                    "Could not read table file");
+        }
+        if (result == 0) {
+            break;
+        }
+        total += static_cast<std::size_t>(result);
+    }
+    return total;
+}
+
@@ -0,0 +1,71 @@
+/*
+ * File:   ScanReader.h
+ * Header file for the ScanReader class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef SCANREADER_H
+#define SCANREADER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/**
+ * Reads a table file sequentially in large blocks. Implementations keep
+ * several reads in flight ahead of the caller so that parsing one block
+ * overlaps with reading the next ones from disk.
+ */
+class ScanReader {
+public:
+    /** The ways a table file can be read during a scan. */
+    enum class Mode {
+        ASYNC,    // io_uring when available, otherwise PREFETCH
+        PREFETCH  // A dedicated reader thread fills a bounded queue of blocks
+    };
+
+    virtual ~ScanReader();
+
+    /** Sets the mode used by readers opened after this call. */
+    static void setMode(Mode mode);
+
+    /**
+     * Opens a reader for the file at the given path using the current mode.
+     * The kernel is told that the file will be read sequentially. Files no
+     * larger than one block are read with a single pread() whatever the mode,
+     * and an ASYNC reader falls back to PREFETCH if its ring cannot be set up.
+     *
+     * @param path The path of the file to read
+     * @return The reader, or nullptr if the file could not be opened
+     */
+    static std::unique_ptr<ScanReader> open(const std::string& path);
+
+    /**
+     * Gets the next block of the file. The block remains valid until the
+     * next call to this method.
+     *
+     * @param data Set to the start of the block
+     * @param size Set to the number of bytes in the block
+     * @return False if the end of the file has been reached, true otherwise
+     */
+    virtual bool nextBlock(const char*& data, std::size_t& size) = 0;
+
+protected:
+    ScanReader(int fd, std::size_t fileSize) : fd(fd), fileSize(fileSize) {}
+
+    int fd;
+    std::size_t fileSize;
+
+    /**
+     * Reads exactly count bytes at the given offset unless the end of the
+     * file is reached first.
+     *
+     * @return The number of bytes read
+     * @throw std::system_error if the read fails
+     */
+    std::size_t readFully(char* buffer, std::size_t count, std::size_t offset);
+};
+
+#endif /* SCANREADER_H */
+
@@ -0,0 +1,36 @@
+/*
+ * File:   ScanStream.cpp
+ * Implementation file for the ScanStream class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <string>
+#include "ScanStream.h"
+
+ScanStream::ScanStream(const std::string& path)
+: std::istream(nullptr), buffer(ScanReader::open(path)) {
+    rdbuf(&buffer);
+    // Report read errors from the reader instead of treating them as EOF
+    exceptions(std::ios::badbit);
+}
+
+ScanStream::~ScanStream() {
+    // No implementation needed
+}
+
+ScanStream::ScanBuffer::int_type ScanStream::ScanBuffer::underflow() {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+    const char* data;
+    std::size_t size;
+    if (!reader || !reader->nextBlock(data, size)) {
+        return traits_type::eof();
+    }
+    // The get area is only read from, so casting away const is safe
+    char* begin = const_cast<char*>(data);
+    setg(begin, begin, begin + size);
+    return traits_type::to_int_type(*gptr());
+}
+
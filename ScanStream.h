@@ -0,0 +1,46 @@
+/*
+ * File:   ScanStream.h
+ * Header file for the ScanStream class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef SCANSTREAM_H
+#define SCANSTREAM_H
+
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include "ScanReader.h"
+
+/**
+ * An input stream that reads a table file front to back through a
+ * ScanReader. Used for full table scans so that rows can be parsed out of one
+ * block while the following blocks are still being read from disk. If the
+ * file cannot be opened, the stream is empty.
+ */
+class ScanStream : public std::istream {
+public:
+    explicit ScanStream(const std::string& path);
+    virtual ~ScanStream();
+
+private:
+    /** Exposes the blocks of a ScanReader as a stream buffer. */
+    class ScanBuffer : public std::streambuf {
+    public:
+        explicit ScanBuffer(std::unique_ptr<ScanReader> reader)
+        : reader(std::move(reader)) {}
+
+    protected:
+        virtual int_type underflow() override;
+
+    private:
+        std::unique_ptr<ScanReader> reader;
+    };
+
+    ScanBuffer buffer;
+};
+
+#endif /* SCANSTREAM_H */
+
@@ -11,10 +11,11 @@
 #include "Schema.h"
 #include "string_util.h"
 #include "ColumnMetadata.h"
+#include "InvalidQueryException.h"
 
 using MetadataStrings = std::vector<std::string>;
 
-Schema::Schema() {
+Schema::Schema() : metadata(std::make_shared<MetadataVec>()) {
     // No implementation needed
 }
 
@@ -22,7 +23,8 @@ Schema::~Schema() {
     // No implementation needed
 }
 
-Schema::Schema(const std::string& tableName, const std::string& s) {
+Schema::Schema(const std::string& tableName, const std::string& s)
+: metadata(std::make_shared<MetadataVec>()) {
     auto tableNameCopy = tableName;
     if (tableName.find("http://") == 0) {
         tableNameCopy = tableName.substr(tableName.rfind("/") + 1);
@@ -41,9 +43,9 @@ std::string Schema::toString() const {
     std::ostringstream os;
     os << std::boolalpha;
     unsigned int index = 0;
-    for (const auto& colMetadata : metadata) {
+    for (const auto& colMetadata : *metadata) {
         os << colMetadata;
-        if (index < metadata.size() - 1) {
+        if (index < metadata->size() - 1) {
             os << "\t";
         }
         index++;
@@ -52,18 +54,44 @@ std::string Schema::toString() const {
 }
 
 void Schema::addColumn(const ColumnMetadata& colMetadata) {
-    metadata.push_back(colMetadata);
+    getUnsharedMetadata().push_back(colMetadata);
 }
 
 int Schema::getColumnIndex(const std::string& colName) const {
-    for (unsigned int i = 0; i < metadata.size(); i++) {
-        if (metadata[i].getColumnName() == colName) {
+    for (unsigned int i = 0; i < metadata->size(); i++) {
+        if ((*metadata)[i].getColumnName() == colName) {
             return i;
         }
     }
     return -1;
 }
 
+unsigned int Schema::bindColumn(const std::string& colName) const {
+    std::string name = colName;
+    std::string tableName;
+    if (colName.find('.') != std::string::npos) {
+        auto parts = string_util::split(colName, '.', true);
+        tableName = string_util::extractQuoted(parts[0]);
+        name = string_util::extractQuoted(parts[1]);
+    }
+    int index = -1;
+    for (unsigned int i = 0; i < metadata->size(); i++) {
+        const ColumnMetadata& colMetadata = (*metadata)[i];
+        if (colMetadata.getColumnName() != name) {
+            continue;
+        }
+        if (tableName.empty() && index != -1) {
+            throw InvalidQueryException("Ambiguous column: " + name);
+        }
+        if (tableName.empty() || colMetadata.getTableName() == tableName) {
+            index = i;
+        }
+    }
+    if (index == -1) {
+        throw std::invalid_argument("Column " + colName + " does not exist");
+    }
+    return index;
+}
 
 bool Schema::hasColumn(const std::string& colName) const {
     std::string colNameCopy = colName;
@@ -73,7 +101,7 @@ bool Schema::hasColumn(const std::string& colName) const {
         tableName = parts[0];
         colNameCopy = parts[1];
     }
-    for (const auto& colMetadata : metadata) {
+    for (const auto& colMetadata : *metadata) {
         if (colMetadata.getColumnName() == colNameCopy) {
             if (tableName.empty() || colMetadata.getTableName() == tableName) {
                 return true;
@@ -83,21 +111,38 @@ bool Schema::hasColumn(const std::string& colName) const {
     return false;
 }
 
-const MetadataVec Schema::getMetadataForColumns() const {
-    return metadata;
+const MetadataVec& Schema::getMetadataForColumns() const {
+    return *metadata;
 }
 
 ColumnMetadata Schema::getColumnMetadata(const std::string& colName) const {
-    for (const auto& colMetadata : metadata) {
+    for (const auto& colMetadata : *metadata) {
         if (colMetadata.getColumnName() == colName)
             return colMetadata;
     }
     throw std::invalid_argument("Column " + colName + " does not exist");
 }
 
+const ColumnMetadata& Schema::getColumnMetadata(unsigned int index) const {
+    return metadata->at(index);
+}
+
+bool Schema::sharesMetadataWith(const Schema& schema) const {
+    return metadata == schema.metadata;
+}
+
 void Schema::merge(const Schema& schema) {
-    for (const auto& colMetadata : schema.metadata) {
-        metadata.push_back(colMetadata);
+    // Copy first in case the schema is merged with itself
+    MetadataVec otherMetadata = *schema.metadata;
+    MetadataVec& ownMetadata = getUnsharedMetadata();
+    ownMetadata.insert(ownMetadata.end(), otherMetadata.begin(),
+            otherMetadata.end());
+}
+
+MetadataVec& Schema::getUnsharedMetadata() {
+    if (metadata.use_count() > 1) {
+        metadata = std::make_shared<MetadataVec>(*metadata);
     }
+    return *metadata;
 }
 
@@ -8,6 +8,7 @@
 #ifndef SCHEMA_H
 #define SCHEMA_H
 
+#include <memory>
 #include <string>
 #include <vector>
 #include "ColumnMetadata.h"
@@ -38,20 +39,51 @@ public:
      */
     int getColumnIndex(const std::string& colName) const;
     
+    /**
+     * Resolves a column reference, which may be qualified with a table name
+     * (table.column), to the index of the column in the schema. Queries bind
+     * their column references once so that rows can be accessed by index.
+     * 
+     * @param colName The column reference to resolve
+     * @return The index of the column
+     * @throw InvalidQueryException if an unqualified name matches more than
+     * one column
+     * @throw std::invalid_argument if no column matches
+     */
+    unsigned int bindColumn(const std::string& colName) const;
+    
     /** Checks if the schema contains a column with the given name. */
     bool hasColumn(const std::string& colName) const;
     
     /** Returns the metadata for the columns in the schema. */
-    const MetadataVec getMetadataForColumns() const;
+    const MetadataVec& getMetadataForColumns() const;
     
     /** Gets the metadata for the given column. */
     ColumnMetadata getColumnMetadata(const std::string& colName) const;
     
+    /**
+     * Gets the metadata for the column at the given index. The reference
+     * stays valid for as long as this schema or a copy of it exists.
+     */
+    const ColumnMetadata& getColumnMetadata(unsigned int index) const;
+    
+    /**
+     * Checks if this schema and the given schema share their metadata, which
+     * means that they describe the same columns.
+     */
+    bool sharesMetadataWith(const Schema& schema) const;
+    
     /** Merges this schema with the given schema. */
     void merge(const Schema& schema);
     
 private:
-    MetadataVec metadata;
+    // Shared between copies so that columns can refer to their metadata
+    // without copying it. Copied before the first modification of a shared
+    // vector.
+    std::shared_ptr<MetadataVec> metadata;
+    
+    /** Gets a copy of the metadata that is not shared with other schemas. */
+    MetadataVec& getUnsharedMetadata();
 };
 
 #endif /* SCHEMA_H */
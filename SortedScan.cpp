@@ -0,0 +1,231 @@
+/*
+ * File:   SortedScan.cpp
+ * Implementation file for the SortedScan class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include <unistd.h>
+#include "Column.h"
+#include "constants.h"
+#include "FlatHashTable.h"
+#include "InvalidQueryException.h"
+#include "RowBatch.h"
+#include "SortedScan.h"
+#include "Table.h"
+#include "table_io_util.h"
+
+// Helper functions
+namespace {
+    /**
+     * Creates an empty temporary file with a unique name.
+     *
+     * @return The path of the file
+     * @throw InvalidQueryException if the file cannot be created
+     */
+    std::string createTemporaryFile() {
+        std::string path = (fs::temp_directory_path()
+                / "db-join-XXXXXX").string();
+        int fd = mkstemp(path.data());
+        if (fd < 0) {
+            throw InvalidQueryException("Could not create a temporary file");
+        }
+        close(fd);
+        return path;
+    }
+
+    /** Estimates the memory used by a row and its key. */
+    std::size_t getEntrySize(const Row& row, const std::string& key) {
+        std::size_t size = sizeof(Row) + sizeof(std::string) + key.size()
+                + row.getColumns().size() * sizeof(Column);
+        std::string_view text;
+        for (const auto& col : row.getColumns()) {
+            if (col.getStoredValue(text)) {
+                size += text.size();
+            }
+        }
+        return size;
+    }
+}  // namespace
+
+SortedScan::SortedScan(std::shared_ptr<Table> table,
+        const std::vector<unsigned int>& keyIndexes,
+        const std::vector<bool>& typedKeys, std::size_t memoryBudget)
+        : table(table), schema(table->getSchema()), keyIndexes(keyIndexes),
+          typedKeys(typedKeys), memoryBudget(memoryBudget) {
+    // No implementation needed
+}
+
+SortedScan::~SortedScan() {
+    for (auto& run : runs) {
+        run->stream.close();
+        std::remove(run->path.c_str());
+    }
+}
+
+bool SortedScan::nextRow(Row& row, std::string& key) {
+    if (!started) {
+        started = true;
+        readRuns();
+    }
+    if (runs.empty()) {
+        if (entryPosition == entries.size()) {
+            return false;
+        }
+        Entry& entry = entries[entryPosition++];
+        key.swap(entry.first);
+        std::swap(row, entry.second);
+        return true;
+    }
+    return nextMerged(row, key);
+}
+
+void SortedScan::packKey(const Row& row, std::string& key) const {
+    key.clear();
+    for (unsigned int c = 0; c < keyIndexes.size(); c++) {
+        FlatHashTable::appendKey(key, row[keyIndexes[c]], typedKeys[c]);
+    }
+}
+
+void SortedScan::readRuns() {
+    RowBatch batch;
+    std::size_t size = 0;
+    while (table->nextBatch(batch)) {
+        for (unsigned int position : batch.getSelection()) {
+            entries.emplace_back();
+            Entry& entry = entries.back();
+            batch.copyRow(position, entry.second);
+            packKey(entry.second, entry.first);
+            size += getEntrySize(entry.second, entry.first);
+            if (size >= memoryBudget) {
+                writeRun();
+                size = 0;
+            }
+        }
+    }
+    if (runs.empty()) {
+        sortEntries();
+        return;
+    }
+    if (!entries.empty()) {
+        writeRun();
+    }
+    // The last runs are merged until few enough are left to merge at once
+    while (runs.size() > SORT_MERGE_FAN_IN) {
+        mergeRuns(runs.size() - SORT_MERGE_FAN_IN);
+    }
+    startMerge(0);
+}
+
+void SortedScan::sortEntries() {
+    auto byKey = [](const Entry& entry1, const Entry& entry2) {
+        return entry1.first < entry2.first;
+    };
+    // Tables stored in key order are not sorted again
+    if (!std::is_sorted(entries.begin(), entries.end(), byKey)) {
+        std::stable_sort(entries.begin(), entries.end(), byKey);
+    }
+}
+
+void SortedScan::writeRun() {
+    sortEntries();
+    auto run = std::make_unique<Run>();
+    run->path = createTemporaryFile();
+    std::ofstream out(run->path, std::ios::out | std::ios::trunc);
+    for (const auto& entry : entries) {
+        out << entry.second << '\n';
+    }
+    finishRun(*run, out);
+    runs.push_back(std::move(run));
+    entries.clear();
+    // Levels only decrease along the runs, so SORT_MERGE_FAN_IN runs of one
+    // level are always the last runs. Merging them like carries in a
+    // counter rewrites each row once per level.
+    while (runs.size() >= SORT_MERGE_FAN_IN && runs.back()->level
+            == runs[runs.size() - SORT_MERGE_FAN_IN]->level) {
+        mergeRuns(runs.size() - SORT_MERGE_FAN_IN);
+    }
+}
+
+void SortedScan::mergeRuns(std::size_t first) {
+    auto merged = std::make_unique<Run>();
+    merged->path = createTemporaryFile();
+    merged->level = runs[first]->level + 1;
+    std::ofstream out(merged->path, std::ios::out | std::ios::trunc);
+    startMerge(first);
+    Entry entry;
+    while (nextMerged(entry.second, entry.first)) {
+        out << entry.second << '\n';
+    }
+    finishRun(*merged, out);
+    // The merged runs are consecutive, so rows with equal keys stay in
+    // table order
+    for (std::size_t i = first; i < runs.size(); i++) {
+        runs[i]->stream.close();
+        std::remove(runs[i]->path.c_str());
+    }
+    runs.resize(first);
+    runs.push_back(std::move(merged));
+}
+
+void SortedScan::finishRun(Run& run, std::ofstream& out) {
+    out.close();
+    if (!out) {
+        std::remove(run.path.c_str());
+        throw InvalidQueryException("Could not write " + run.path);
+    }
+}
+
+void SortedScan::startMerge(std::size_t first) {
+    heap.clear();
+    for (std::size_t i = first; i < runs.size(); i++) {
+        runs[i]->stream.open(runs[i]->path);
+        if (readNext(*runs[i])) {
+            heap.push_back(i);
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(),
+            [this](unsigned int run1, unsigned int run2) {
+        return comesAfter(run1, run2);
+    });
+}
+
+bool SortedScan::nextMerged(Row& row, std::string& key) {
+    if (heap.empty()) {
+        return false;
+    }
+    // The run with the smallest next key is at the front of the heap
+    auto laterRun = [this](unsigned int run1, unsigned int run2) {
+        return comesAfter(run1, run2);
+    };
+    std::pop_heap(heap.begin(), heap.end(), laterRun);
+    Run& run = *runs[heap.back()];
+    key.swap(run.next.first);
+    std::swap(row, run.next.second);
+    if (readNext(run)) {
+        std::push_heap(heap.begin(), heap.end(), laterRun);
+    } else {
+        heap.pop_back();
+    }
+    return true;
+}
+
+bool SortedScan::comesAfter(unsigned int run1, unsigned int run2) const {
+    const std::string& key1 = runs[run1]->next.first;
+    const std::string& key2 = runs[run2]->next.first;
+    return key1 != key2 ? key1 > key2 : run1 > run2;
+}
+
+bool SortedScan::readNext(Run& run) {
+    Row& row = run.next.second;
+    row.setSchema(schema);
+    if (!(run.stream >> row)) {
+        return false;
+    }
+    packKey(row, run.next.first);
+    return true;
+}
@@ -0,0 +1,150 @@
+/*
+ * File:   SortedScan.h
+ * Header file for the SortedScan class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef SORTEDSCAN_H
+#define SORTEDSCAN_H
+
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Row.h"
+#include "Schema.h"
+
+class Table;  // Forward declaration required due to circular dependencies
+
+/**
+ * A scan of a table's rows in the order of their join keys, using a bounded
+ * amount of memory. Keys are packed with FlatHashTable::appendKey, so they
+ * compare in the order of their values. The rows are read in runs that fit
+ * in the memory budget, and each run is sorted unless its rows are already
+ * in order. If the whole table fits in one run it stays in memory;
+ * otherwise each run is written to a temporary file, and the files are
+ * merged as the rows are read. Runs are merged SORT_MERGE_FAN_IN at a
+ * time, level by level, so each row is rewritten a logarithmic number of
+ * times and few files are open at once. Rows with equal keys are returned
+ * in the order of the table.
+ */
+class SortedScan {
+public:
+    /**
+     * Prepares the scan. No rows are read until the first call to nextRow.
+     *
+     * @param table The table to scan, which the scan reads to the end
+     * @param keyIndexes The index in the rows of each column of the key
+     * @param typedKeys Whether each column of the key is packed in the form
+     * it is stored in, rather than as text
+     * @param memoryBudget The most bytes of rows held in memory at once
+     */
+    SortedScan(std::shared_ptr<Table> table,
+            const std::vector<unsigned int>& keyIndexes,
+            const std::vector<bool>& typedKeys, std::size_t memoryBudget);
+
+    /** Removes the temporary files of the runs. */
+    ~SortedScan();
+
+    SortedScan(const SortedScan&) = delete;
+    SortedScan& operator=(const SortedScan&) = delete;
+
+    /**
+     * Gets the next row in the order of the keys.
+     *
+     * @param row Set to the row
+     * @param key Set to the packed key of the row
+     * @return False if there are no more rows, true otherwise
+     */
+    bool nextRow(Row& row, std::string& key);
+
+private:
+    /** A row and its packed key. */
+    using Entry = std::pair<std::string, Row>;
+
+    /** A sorted run written to a temporary file, and its next row. */
+    struct Run {
+        std::string path;
+        std::ifstream stream;  // Opened once the run is merged
+        Entry next;
+        unsigned int level = 0;  // How many merges made the run
+    };
+
+    std::shared_ptr<Table> table;
+    Schema schema;
+    std::vector<unsigned int> keyIndexes;
+    std::vector<bool> typedKeys;
+    std::size_t memoryBudget;
+    bool started = false;
+    std::vector<Entry> entries;  // The run kept in memory, if there is one
+    std::size_t entryPosition = 0;  // The next of those entries to return
+    std::vector<std::unique_ptr<Run>> runs;  // The runs written to files
+    std::vector<unsigned int> heap;  // The runs with rows left, by next key
+
+    /** Packs the key of a row. */
+    void packKey(const Row& row, std::string& key) const;
+
+    /** Sorts the entries by key, keeping equal keys in order. */
+    void sortEntries();
+
+    /**
+     * Reads the table into sorted runs, writing each run to a file unless
+     * the whole table fits in memory.
+     */
+    void readRuns();
+
+    /**
+     * Sorts the entries and writes them to a new run, then merges the last
+     * runs while SORT_MERGE_FAN_IN of them have the same level.
+     */
+    void writeRun();
+
+    /**
+     * Merges the runs from the given one on into a single run of the next
+     * level.
+     *
+     * @param first The index of the first run to merge
+     */
+    void mergeRuns(std::size_t first);
+
+    /**
+     * Closes the file a run was written to.
+     *
+     * @throw InvalidQueryException if the run could not be written
+     */
+    void finishRun(Run& run, std::ofstream& out);
+
+    /**
+     * Opens the runs from the given one on, reads the first row of each and
+     * orders them in the heap.
+     *
+     * @param first The index of the first run to merge
+     */
+    void startMerge(std::size_t first);
+
+    /**
+     * Gets the next row of the runs being merged.
+     *
+     * @return False if the runs have no more rows, true otherwise
+     */
+    bool nextMerged(Row& row, std::string& key);
+
+    /**
+     * Checks whether the next row of a run comes after the next row of
+     * another run. Runs with equal keys are ordered as they were written.
+     */
+    bool comesAfter(unsigned int run1, unsigned int run2) const;
+
+    /**
+     * Reads the next row of a run.
+     *
+     * @return False if the run has no more rows, true otherwise
+     */
+    bool readNext(Run& run);
+};
+
+#endif /* SORTEDSCAN_H */
+
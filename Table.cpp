@@ -9,13 +9,18 @@
 #include <algorithm>
 #include <iomanip>
 #include <limits>
+#include <sstream>
 #include <string>
+#include <unordered_set>
 #include <vector>
 #include "constants.h"
 #include "InvalidQueryException.h"
 #include "JoinedTable.h"
+#include "ParallelScan.h"
 #include "Restriction.h"
 #include "Row.h"
+#include "ScanReader.h"
+#include "ScanStream.h"
 #include "string_util.h"
 #include "Table.h"
 #include "table_io_util.h"
@@ -26,10 +31,10 @@ namespace {
      * Compares rows when ordering them.
      */
     bool compareRows(const Row& row1, const Row& row2, 
-            const ColumnNames& nameVec, bool desc) {
-        for (const auto& colName : nameVec) {
-            auto col1 = row1.getColumn(colName);
-            auto col2 = row2.getColumn(colName);
+            const ColumnIndexes& indexes, bool desc) {
+        for (unsigned int index : indexes) {
+            const Column& col1 = row1[index];
+            const Column& col2 = row2[index];
             if (col1 == col2) {
                 continue;
             }
@@ -37,16 +42,18 @@ namespace {
         }
         return false;
     }
+
 }  // namespace
 
-Table::Table() : restriction(Restriction("")) {
+Table::Table() : restriction(Restriction()) {
     // No implementation needed
 }
 
 Table::Table(const std::string& tableName, const Schema& schema)
-: schema(schema), tableName(tableName), restriction(Restriction("")) {
+: schema(schema), tableName(tableName), restriction(Restriction()) {
     tableStream = std::make_shared<std::fstream>
         (TABLE_DIRECTORY + tableName + TABLE_EXTENSION);
+    isFileBacked = true;
     if (!tableStream->good())
         hasRows = false;
     if (!isFromURL) {
@@ -57,7 +64,7 @@ Table::Table(const std::string& tableName, const Schema& schema)
 Table::Table(const std::shared_ptr<std::iostream>& tableStream,
         const std::string& tableName, const Schema& schema)
         : schema(schema), tableName(tableName),
-          restriction(Restriction("")), tableStream(tableStream) {
+          restriction(Restriction()), tableStream(tableStream) {
     if (!tableStream->good()) {
         hasRows = false;
     }
@@ -75,42 +82,136 @@ Table::~Table() {
 }
 
 Table& Table::operator>>(Row& row) {
-    if (tableStream->tellg() == 0) {
-        // Skip schema header
-        std::string schema;
-        std::getline(*tableStream, schema);
-    }
-    row = Row(schema);
+    // Keep the row's columns so that their storage is reused
+    row.setSchema(schema);
     extractRow(row);
     return *this;
 }
 
+bool Table::nextBatch(RowBatch& batch) {
+    do {
+        if (isFileBacked && !orderedRows) {
+            // Rows are decoded and restricted by the morsels of the scan
+            if (!parallelScan) {
+                parallelScan = std::make_shared<ParallelScan>(TABLE_DIRECTORY
+                        + tableName + TABLE_EXTENSION, schema, restriction,
+                        parallelism);
+            }
+            if (!parallelScan->nextBatch(batch)) {
+                batch.reset(schema);
+                hasRows = false;
+                return false;
+            }
+        } else {
+            batch.reset(schema);
+            readBatch(batch);
+            restriction.apply(batch);
+        }
+        batch.project(colFilter);
+        batch.materialize();
+        if (distinct) {
+            removeDuplicates(batch);
+        }
+    } while (hasRows && batch.getSelection().empty());
+    return !batch.getSelection().empty();
+}
+
 Table::operator bool() const {
     return hasRows;
 }
 
-const Schema Table::getSchema() const {
+const Schema& Table::getSchema() const {
     return schema;
 }
 
+MetadataVec Table::getResultColumns() const {
+    const MetadataVec& metadataVec = getSchema().getMetadataForColumns();
+    if (colFilter.empty()) {
+        return metadataVec;
+    }
+    MetadataVec columns;
+    for (unsigned int index : colFilter) {
+        columns.push_back(metadataVec[index]);
+    }
+    return columns;
+}
+
+void Table::setParallelism(unsigned int parallelism) {
+    this->parallelism = parallelism;
+}
+
+unsigned int Table::getParallelism() const {
+    return parallelism;
+}
+
 void Table::insertRow(Row& row) {
-    if (isFromURL) {
+    RowVec rows{row};
+    insertRows(rows);
+    row = rows[0];
+}
+
+void Table::insertRows(RowVec& rows) {
+    if (isFromURL || rows.empty()) {
         return;
     }
-    for (unsigned int index = 0; index < row.getColumns().size(); index++) {
-        ColumnMetadata metadata = row[index].getMetadata();
-        std::string colValue = row[index];
-        validateColumnValue(metadata, colValue, index);
-        table_io_util::formatColumnValue(metadata.getColumnType(), colValue);
-        row[index] = Column(colValue);
+    for (auto& row : rows) {
+        for (unsigned int index = 0; index < row.getColumns().size();
+                index++) {
+            const ColumnMetadata& metadata = row[index].getMetadata();
+            std::string colValue = row[index];
+            validateDataType(metadata.getColumnName(),
+                    metadata.getColumnType(), colValue);
+            if (metadata.isNotNull() && colValue == Column::NULL_VALUE) {
+                throw InvalidQueryException(metadata.getColumnName()
+                        + " cannot be null");
+            }
+            table_io_util::formatColumnValue(metadata.getColumnType(),
+                    colValue);
+            row[index] = Column(colValue, &metadata);
+        }
     }
-    std::fstream::pos_type original = tableStream->tellg();
-    // Go to end of file
-    tableStream->seekg(0, tableStream->end);
-    *tableStream << row << std::endl;
-    // Reset file pointer
-    tableStream->seekg(original);
-    rowCount++;
+    insertFormattedRows(rows);
+}
+
+void Table::insertFormattedRows(const RowVec& rows) {
+    if (isFromURL || rows.empty()) {
+        return;
+    }
+    // Keys and references are compared as they are stored
+    checkForDuplicateKeys(rows);
+    table_io_util::validateReferencedColumns(rows);
+    appendRows(rows);
+    rowCount += rows.size();
+}
+
+void Table::insertFormattedRows(const RowVec& rows, LoadKeys& keys) {
+    if (isFromURL || rows.empty()) {
+        return;
+    }
+    if (!keys.loaded) {
+        loadKeys(keys);
+    }
+    // The keys of the batch are added as they are checked, since a load
+    // stops at its first invalid batch. Keys are compared by their text, as
+    // in checkForDuplicateKeys().
+    std::string key;
+    for (auto& primaryKey : keys.primaryKeys) {
+        for (const auto& row : rows) {
+            const Column& col = row[primaryKey.first];
+            if (col.isNull()) {
+                continue;
+            }
+            key.clear();
+            FlatHashTable::appendKey(key, col, false);
+            if (!primaryKey.second.insert(key, FlatHashTable::hash(key))
+                    .second) {
+                throw InvalidQueryException("Primary key must be unique");
+            }
+        }
+    }
+    table_io_util::validateReferencedColumns(rows, keys.references);
+    appendRows(rows);
+    rowCount += rows.size();
 }
 
 void Table::updateRows(UpdateMap& columnsToUpdate) {
@@ -127,81 +228,73 @@ void Table::updateRows(UpdateMap& columnsToUpdate) {
         table_io_util::formatColumnValue(metadata.getColumnType(),
                 entry.second);
     }
-    auto original = tableStream->tellg();
-    tableStream->seekg(0);
-    std::string schemaStr;
-    std::getline(*tableStream, schemaStr);
     writeUpdatedRows(columnsToUpdate);
-    tableStream->seekg(original);
 }
 
 void Table::deleteRows() {
     if (isFromURL) {
         throw InvalidQueryException("Cannot delete from a remote table");
     }
-    auto original = tableStream->tellg();
-    tableStream->seekg(0);
-    std::string schemaStr;
-    std::getline(*tableStream, schemaStr);
     writeUndeletedRows();
-    tableStream->seekg(original);
     rowCount--;
 }
 
-Table& Table::filterColumnsByName(const std::string& colNames) {
-    if (colNames == "") {
+Table& Table::filterColumnsByName(const ColNames& colNames) {
+    if (colNames.empty()) {
         colFilter.clear();
         return *this;
     }
-    if (colNames != "*") {
-        colFilter = string_util::split(colNames, ',');
+    if (colNames.size() != 1 || colNames[0] != "*") {
+        colFilter = bindColumns(colNames);
     }
     return *this;
 }
 
+Table& Table::filterColumns(const ColumnIndexes& indexes) {
+    colFilter = indexes;
+    return *this;
+}
+
 Table& Table::filterDistinct(bool distinct) {
     this->distinct = distinct;
     return *this;
 }
 
-Table& Table::orderBy(const std::string& colNames, bool desc) {
-    if (colNames.empty()) {
+Table& Table::orderBy(const ColNames& colNames, bool desc) {
+    return orderBy(bindColumns(colNames), desc);
+}
+
+Table& Table::orderBy(const ColumnIndexes& indexes, bool desc) {
+    if (indexes.empty()) {
         return *this;
     }
-    ColumnNames nameVec = string_util::split(colNames, ',');
-    std::vector<Row> rows;
-    Row row;
-    while (*this >> row) {
-        rows.push_back(row);
-    }
-    std::sort(rows.begin(), rows.end(), [&](Row row1, Row row2) {
-        return compareRows(row1, row2, nameVec, desc);
-    });
-    tableStream = std::make_shared<std::stringstream>();
-    *tableStream << schema.toString() << std::endl;
-    unsigned int index = 0;
-    for (const auto& row : rows) {
-        *tableStream << row;
-        if (index != rows.size() - 1) {
-            *tableStream << std::endl;
-        }
-        index++;
-    }
+    // The sorted rows are kept in memory and extracted from there
+    orderedRows = std::make_shared<RowVec>(extractSortedRows(indexes, desc));
+    orderedPosition = 0;
     hasRows = true;
     return *this;
 }
 
-Table& Table::setRestrictions(const std::string& restrictions) {
+Table& Table::setRestrictions(query_ast::ExpressionPtr restrictions) {
     restriction = Restriction(restrictions);
+    restriction.bind(schema);
+    return *this;
+}
+
+Table& Table::setRestriction(const Restriction& restriction) {
+    this->restriction = restriction;
     return *this;
 }
 
 JoinedTable Table::joinTo(Table& other,
-        const std::string& joinCondition) {
-    return JoinedTable(*this, other, joinCondition);
+        const JoinConditions& joinConditions) {
+    return JoinedTable(*this, other, joinConditions);
 }
 
 void Table::reset() {
+    orderedPosition = 0;
+    scanStream.reset();
+    parallelScan.reset();
     tableStream->clear();
     tableStream->seekg(0);
     hasRows = true;
@@ -215,6 +308,80 @@ std::shared_ptr<Table> Table::clone() const {
     return std::make_shared<Table>(*this);
 }
 
+bool Table::readRow(Row& row) {
+    if (orderedRows) {
+        if (orderedPosition >= orderedRows->size()) {
+            return false;
+        }
+        row = (*orderedRows)[orderedPosition++];
+        return true;
+    }
+    return static_cast<bool>(getScanStream() >> row);
+}
+
+void Table::readBatch(RowBatch& batch) {
+    if (orderedRows) {
+        while (orderedPosition < orderedRows->size() && !batch.isFull()) {
+            batch.appendRow((*orderedRows)[orderedPosition++]);
+        }
+        hasRows = orderedPosition < orderedRows->size();
+        return;
+    }
+    scanRow.setSchema(schema);
+    while (hasRows && !batch.isFull()) {
+        if (!readRow(scanRow)) {
+            hasRows = false;
+        } else {
+            batch.appendRow(scanRow);
+        }
+    }
+}
+
+void Table::appendRows(const RowVec& rows) {
+    std::ostringstream buffer;
+    for (const auto& row : rows) {
+        buffer << row << '\n';
+    }
+    std::fstream::pos_type original = tableStream->tellg();
+    // Go to end of file
+    tableStream->seekg(0, tableStream->end);
+    *tableStream << buffer.str() << std::flush;
+    // Reset file pointer
+    tableStream->seekg(original);
+}
+
+std::vector<Row> Table::extractSortedRows(const ColumnIndexes& indexes,
+        bool desc) {
+    std::vector<Row> rows;
+    RowBatch batch;
+    while (nextBatch(batch)) {
+        for (unsigned int position : batch.getSelection()) {
+            rows.emplace_back();
+            batch.copyRow(position, rows.back());
+        }
+    }
+    std::sort(rows.begin(), rows.end(), [&](const Row& row1, const Row& row2) {
+        return compareRows(row1, row2, indexes, desc);
+    });
+    return rows;
+}
+
+BoundUpdateVec Table::bindUpdates(const UpdateMap& columnsToUpdate) const {
+    BoundUpdateVec updates(schema.getMetadataForColumns().size(), nullptr);
+    for (const auto& entry : columnsToUpdate) {
+        updates[schema.bindColumn(entry.first)] = &entry.second;
+    }
+    return updates;
+}
+
+ColumnIndexes Table::bindColumns(const ColNames& colNames) const {
+    ColumnIndexes indexes;
+    for (const auto& name : colNames) {
+        indexes.push_back(schema.bindColumn(name));
+    }
+    return indexes;
+}
+
 void Table::validateColumnValue(const ColumnMetadata& metadata,
         const std::string& colValue, const unsigned int indexInSchema) {
     std::string colName = metadata.getColumnName();
@@ -262,9 +429,11 @@ void Table::validateDataType(const std::string& colName,
 
 void Table::checkForDuplicateValue(const std::string& value,
         const unsigned int index) {
-    std::fstream::pos_type returnPos = tableStream->tellg();
+    ScanStream in(TABLE_DIRECTORY + tableName + TABLE_EXTENSION);
     std::string line;
-    while (std::getline(*tableStream, line)) {
+    // Skip schema header
+    std::getline(in, line);
+    while (std::getline(in, line)) {
         std::istringstream is(line);
         std::string column;
         for (unsigned int i = 0; i <= index; i++) {
@@ -274,13 +443,84 @@ void Table::checkForDuplicateValue(const std::string& value,
             throw InvalidQueryException("Primary key must be unique");
         }
     }
-    // Clear eof bit on file
-    tableStream->clear();
-    // Return file read position to original location
-    tableStream->seekg(returnPos);
+}
+
+void Table::checkForDuplicateKeys(const RowVec& rows) const {
+    const Row& first = rows.front();
+    for (unsigned int index = 0; index < first.getColumns().size(); index++) {
+        if (!first[index].getMetadata().isPrimaryKey()) {
+            continue;
+        }
+        std::unordered_set<std::string> keys;
+        for (const auto& row : rows) {
+            if (!row[index].isNull()
+                    && !keys.insert(static_cast<std::string> (row[index]))
+                    .second) {
+                throw InvalidQueryException("Primary key must be unique");
+            }
+        }
+        if (keys.empty()) {
+            continue;
+        }
+        bool duplicate = false;
+        table_io_util::scanRows(tableName, [&](const Row& row) {
+            const Column& col = row[index];
+            duplicate = !col.isNull()
+                    && keys.count(static_cast<std::string> (col)) != 0;
+            return !duplicate;
+        });
+        if (duplicate) {
+            throw InvalidQueryException("Primary key must be unique");
+        }
+    }
+}
+
+void Table::loadKeys(LoadKeys& keys) const {
+    keys.loaded = true;
+    const MetadataVec& columns = schema.getMetadataForColumns();
+    for (unsigned int index = 0; index < columns.size(); index++) {
+        if (columns[index].isPrimaryKey()) {
+            keys.primaryKeys.emplace_back(index, FlatHashTable(rowCount));
+        }
+    }
+    if (!keys.primaryKeys.empty()) {
+        std::string key;
+        table_io_util::scanRows(tableName, [&](const Row& row) {
+            for (auto& primaryKey : keys.primaryKeys) {
+                const Column& col = row[primaryKey.first];
+                if (!col.isNull()) {
+                    key.clear();
+                    FlatHashTable::appendKey(key, col, false);
+                    primaryKey.second.insert(key, FlatHashTable::hash(key));
+                }
+            }
+            return true;
+        });
+    }
+    keys.references = table_io_util::loadReferencedValues(schema);
 }
 
 void Table::countRows() {
+    if (isFileBacked) {
+        // Count line breaks block by block instead of parsing lines
+        auto reader = ScanReader::open(TABLE_DIRECTORY + tableName
+                + TABLE_EXTENSION);
+        const char* data;
+        std::size_t size;
+        unsigned int lines = 0;
+        char last = '\n';
+        while (reader && reader->nextBlock(data, size)) {
+            lines += std::count(data, data + size, '\n');
+            last = data[size - 1];
+        }
+        if (last != '\n') {
+            lines++;
+        }
+        // The first line holds the schema
+        rowCount = (lines > 0 ? lines - 1 : 0);
+        reset();
+        return;
+    }
     std::string line;
     if (tableStream->tellg() == 0) {
         std::getline(*tableStream, line);
@@ -294,19 +534,23 @@ void Table::countRows() {
 void Table::writeUpdatedRows(const UpdateMap& columnsToUpdate) {
     std::string tableStreamPath = TABLE_DIRECTORY + tableName + TABLE_EXTENSION;
     std::string tmpFilePath = TABLE_DIRECTORY + tableName + TEMP_EXTENSION;
+    BoundUpdateVec updates = bindUpdates(columnsToUpdate);
     std::ofstream out(tmpFilePath);
     out << schema.toString() << std::endl;
+    ScanStream in(tableStreamPath);
+    std::string schemaStr;
+    std::getline(in, schemaStr);
     Row row(schema);
-    while (*tableStream >> row) {
+    while (in >> row) {
         if (!restriction.apply(row)) {
             out << row << std::endl;
             continue;
         }
-        for (const auto& col : row.getColumns()) {
-            std::string colName = col.getMetadata().getColumnName();
-            if (columnsToUpdate.find(colName) != columnsToUpdate.end()) {
+        for (unsigned int i = 0; i < row.getColumns().size(); i++) {
+            const Column& col = row[i];
+            if (updates[i]) {
                 table_io_util::validateReferencedBy(col.getMetadata(), col);
-                out << std::quoted(columnsToUpdate.at(colName)) << " ";
+                out << std::quoted(*updates[i]) << " ";
             } else {
                 out << std::quoted(static_cast<std::string> (col)) << " ";
             }
@@ -321,8 +565,11 @@ void Table::writeUndeletedRows() {
     std::string tmpFilePath = TABLE_DIRECTORY + tableName + TEMP_EXTENSION;
     std::ofstream out(tmpFilePath);
     out << schema.toString() << std::endl;
+    ScanStream in(tableStreamPath);
+    std::string schemaStr;
+    std::getline(in, schemaStr);
     Row row(schema);
-    while (*tableStream >> row) {
+    while (in >> row) {
         if (!restriction.apply(row)) {
             out << row << std::endl;
         } else {
@@ -339,29 +586,67 @@ void Table::writeUndeletedRows() {
     std::rename(tmpFilePath.c_str(), tableStreamPath.c_str());
 }
 
+bool Table::addDistinctRow(const Row& row) {
+    // The rows have the same columns, so only their values are compared
+    std::string key;
+    for (const auto& col : row.getColumns()) {
+        FlatHashTable::appendKey(key, col, false);
+    }
+    return rowsFound.insert(key, FlatHashTable::hash(key)).second;
+}
+
 void Table::extractRow(Row& row) {
+    // Rows are read straight into the given row unless columns are filtered,
+    // in which case every column is needed to apply the restriction
+    Row& source = colFilter.empty() ? row : scanRow;
+    source.setSchema(schema);
     while (hasRows) {
         do {
-            if (!(*tableStream >> row)) {
+            if (!readRow(source)) {
                 hasRows = false;
+                row.clear();
                 break;
             }
-        } while (!restriction.apply(row));
-        if (hasRows) {
-            row.orderAndFilterColumns(colFilter);
+        } while (!restriction.apply(source));
+        if (hasRows && &source != &row) {
+            row.copyColumnsFrom(source, colFilter);
         }
-        if (!distinct) {
+        if (!distinct || addDistinctRow(row)) {
             break;
-        } else {
-            std::string colValues;
-            for (const auto& col : row.getColumns()) {
-                colValues += col.getMetadata().getColumnName() + "="
-                        + static_cast<std::string> (col) + ";";
-            }
-            if (columnsFound.find(colValues) == columnsFound.end()) {
-                columnsFound.insert(colValues);
-                break;
-            }
         }
     }
 }
+
+void Table::removeDuplicates(RowBatch& batch) {
+    Selection& selection = batch.getSelection();
+    unsigned int kept = 0;
+    std::string key;
+    for (unsigned int position : selection) {
+        key.clear();
+        for (unsigned int i = 0; i < batch.getColumnCount(); i++) {
+            FlatHashTable::appendKey(key, batch.getColumn(i, position));
+        }
+        if (rowsFound.insert(key, FlatHashTable::hash(key)).second) {
+            selection[kept++] = position;
+        }
+    }
+    selection.resize(kept);
+}
+
+std::istream& Table::getScanStream() {
+    if (!isFileBacked) {
+        if (tableStream->tellg() == 0) {
+            // Skip schema header
+            std::string schemaStr;
+            std::getline(*tableStream, schemaStr);
+        }
+        return *tableStream;
+    }
+    if (!scanStream) {
+        scanStream = std::make_shared<ScanStream>(TABLE_DIRECTORY + tableName
+                + TABLE_EXTENSION);
+        std::string schemaStr;
+        std::getline(*scanStream, schemaStr);
+    }
+    return *scanStream;
+}
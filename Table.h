@@ -12,15 +12,23 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
+#include <utility>
 #include <vector>
+#include "FlatHashTable.h"
+#include "query_ast.h"
 #include "Restriction.h"
 #include "Row.h"
+#include "RowBatch.h"
 #include "Schema.h"
+#include "table_io_util.h"
 
+using ColNames = std::vector<std::string>;
+using JoinConditions = std::vector<query_ast::Comparison>;
 using UpdateMap = std::unordered_map<std::string, std::string>;
+using BoundUpdateVec = std::vector<const std::string*>;
 
 class JoinedTable;  // Forward declaration required due to circular dependencies
+class ParallelScan;  // Forward declaration of class ParallelScan
 
 /**
  * Represents a table in the database. Every table has an associated schema
@@ -29,6 +37,17 @@ class JoinedTable;  // Forward declaration required due to circular dependencies
  */
 class Table {
 public:
+    /**
+     * The primary keys of a table and the values its columns reference, read
+     * once to validate every batch of rows of a bulk load.
+     */
+    struct LoadKeys {
+        bool loaded = false;
+        // The keys of each primary key column, by the index of the column
+        std::vector<std::pair<unsigned int, FlatHashTable>> primaryKeys;
+        std::vector<table_io_util::ReferencedValues> references;
+    };
+
     Table();
     Table(const std::string& tableName, const Schema& schema);
     Table(const std::shared_ptr<std::iostream>& tableStream, 
@@ -41,19 +60,97 @@ public:
      */
     virtual Table& operator>>(Row& row);
 
+    /**
+     * Extracts the next batch of rows from the table, for vectorized
+     * execution. Restrictions, column filters and the distinct filter are
+     * applied to the whole batch at once. Batches may hold fewer than
+     * BATCH_SIZE selected rows, but never none.
+     * 
+     * @param batch The batch to store the rows in, whose storage is reused
+     * @return False if there are no more rows, true otherwise
+     */
+    bool nextBatch(RowBatch& batch);
+
     /**
      * Gets the schema associated with this table.
      */
-    virtual const Schema getSchema() const;
+    virtual const Schema& getSchema() const;
+
+    /**
+     * Gets the metadata of the columns of the rows extracted from this table,
+     * in order, once its columns are filtered.
+     */
+    MetadataVec getResultColumns() const;
+
+    /**
+     * Sets the degree of parallelism of batched scans of this table.
+     *
+     * @param parallelism The most morsels decoded at once, or 0 for one per
+     * thread of the shared ThreadPool
+     */
+    void setParallelism(unsigned int parallelism);
+
+    /** Gets the degree of parallelism of batched scans of this table. */
+    unsigned int getParallelism() const;
 
     /**
      * Inserts the given row into the table.
      * 
      * @param row The row to insert
-     * @param lineNum The number of the line to overwrite
      */
     virtual void insertRow(Row& row);
 
+    /**
+     * Inserts the given rows into the table. Every row is validated before
+     * any is inserted: each primary key is checked against the table and
+     * the other rows in one scan of the table, and the values referencing
+     * each other table in one scan of that table. The rows are then
+     * appended at once.
+     * 
+     * @param rows The rows to insert, which are formatted in place
+     * @throw InvalidQueryException if a row is invalid, in which case no
+     * rows are inserted
+     */
+    virtual void insertRows(RowVec& rows);
+
+    /**
+     * Inserts rows whose values have already been validated against their
+     * data types and formatted as they are stored. Primary keys and
+     * references are validated as in insertRows().
+     * 
+     * @param rows The rows to insert
+     * @throw InvalidQueryException if a row is invalid, in which case no
+     * rows are inserted
+     */
+    void insertFormattedRows(const RowVec& rows);
+
+    /**
+     * Inserts a batch of formatted rows of a bulk load. The primary keys of
+     * the table and the values its columns reference are read with the
+     * first batch, and the keys of each batch are added to them, so the
+     * table and the referenced tables are scanned once per load rather than
+     * once per batch.
+     * 
+     * @param rows The rows to insert
+     * @param keys The keys read for the load, shared by all of its batches
+     * @throw InvalidQueryException if a row is invalid, in which case no
+     * rows of the batch are inserted and the keys must not be used again
+     */
+    void insertFormattedRows(const RowVec& rows, LoadKeys& keys);
+
+    /**
+     * Validates the data type based on the column value.
+     * 
+     * @param colName The name of the column whose value is being validated.
+     * Used for error messages.
+     * @param dataType The data type to validate
+     * @param value The value to validate the data type for, as written in a
+     * query
+     * @throw InvalidQueryException if the value is not of the data type
+     */
+    static void validateDataType(const std::string& colName,
+            const std::string& dataType, const std::string& value);
+
     /**
      * Updates the rows in the table. IMPORTANT: this function will update ALL
      * rows in the table. If you need to update specific rows, use
@@ -79,9 +176,18 @@ public:
      * accessing them.
      * 
      * @param colNames The names of the columns to extract in the order they
-     * are to be extracted in, separated by commas
+     * are to be extracted in, or just "*" for every column
+     */
+    Table& filterColumnsByName(const ColNames& colNames);
+
+    /**
+     * Tells the table to filter the columns in the rows retrieved from the
+     * table, as filterColumnsByName() does with columns already bound.
+     *
+     * @param indexes The indexes of the columns in the table's schema, in
+     * the order they are to be extracted in, or none for every column
      */
-    Table& filterColumnsByName(const std::string& colNames);
+    Table& filterColumns(const ColumnIndexes& indexes);
     
     /**
      * If distinct is true, tells the table to filter out rows where all columns
@@ -97,27 +203,45 @@ public:
      * @param colNames The names of the columns to sort by
      * @param desc Whether or not the rows should be sorted in descending order
      */
-    virtual Table& orderBy(const std::string& colNames, bool desc);
+    virtual Table& orderBy(const ColNames& colNames, bool desc);
+
+    /**
+     * Orders the rows in the table by the columns at the given indexes.
+     *
+     * @param indexes The indexes of the columns in the table's schema
+     * @param desc Whether or not the rows should be sorted in descending order
+     */
+    Table& orderBy(const ColumnIndexes& indexes, bool desc);
 
     /**
      * Adds constraints to the table that filter out the rows that are returned.
      * 
-     * @param restrictions The restrictions to put on the table, in the form
-     * you would find in a SQL WHERE clause.
+     * @param restrictions The restrictions to put on the table, as parsed
+     * from a SQL WHERE clause.
      * 
      * @return The table with the given constraints.
      */
-    virtual Table& setRestrictions(const std::string& restrictions);
+    virtual Table& setRestrictions(query_ast::ExpressionPtr restrictions);
+
+    /**
+     * Sets a restriction that has already been bound to the table's schema,
+     * such as one compiled once for a prepared statement.
+     *
+     * @param restriction The bound restriction
+     * @return The table with the given restriction.
+     */
+    Table& setRestriction(const Restriction& restriction);
     
     /**
      * Joins this table to another table.
      * 
      * @param other The table to join to
-     * @param joinCondition The condition to join on
+     * @param joinConditions The comparisons between columns of the query's
+     * tables; those between columns of these two tables are joined on
      * @return A JoinedTable representing the result of joining the tables
      */
     virtual JoinedTable joinTo(Table& other, 
-        const std::string& joinCondition);
+        const JoinConditions& joinConditions);
 
     /** Used for extracting rows in while loops. */
     virtual operator bool() const;
@@ -125,7 +249,7 @@ public:
     /**
      * Resets the table so that it begins pulling rows from the beginning again.
      */
-    void reset();
+    virtual void reset();
     
     /** Gets the number of rows in the table. */
     virtual unsigned int getRowCount() const;
@@ -139,36 +263,42 @@ protected:
     bool isFromURL = false;
     bool distinct = false;
     std::string tableName;  // Used for copying tables
-    std::vector<std::string> colFilter;  // Used to filter columns
-    std::unordered_set<std::string> columnsFound;  // Used to filter duplicates
+    ColumnIndexes colFilter;  // Used to filter columns
+    FlatHashTable rowsFound;  // Used to filter duplicates
     Restriction restriction;  // Used for WHERE clauses
     unsigned int rowCount = 0;
     std::shared_ptr<std::iostream> tableStream;
+    bool isFileBacked = false;  // Whether rows are scanned from the table file
+    std::shared_ptr<std::istream> scanStream;  // Used for full table scans
+    std::shared_ptr<ParallelScan> parallelScan;  // Used for batched scans
+    unsigned int parallelism = 0;  // Of batched scans; 0 for the default
+    Row scanRow;  // Holds unfiltered rows when columns are filtered
+    std::shared_ptr<RowVec> orderedRows;  // Set once orderBy() is applied
+    unsigned int orderedPosition = 0;  // The next ordered row to extract
     
-private:
     /**
-     * Ensures that not null, primary key, and reference conditions are met for 
-     * the given column value.
+     * Reads the next stored row, without applying restrictions or filters.
      * 
-     * @param metadata The metadata for the column whose value is being 
-     * validated
-     * @param colValue The value to validate
-     * @param indexInFile The index of the column in the table's schema
-     * @throw InvalidQueryException if one or more conditions are not met
+     * @param row The row to store the values in
+     * @return False if there are no more rows, true otherwise
      */
-    void validateColumnValue(const ColumnMetadata& metadata, 
-            const std::string& colValue, const unsigned int indexInSchema);
+    virtual bool readRow(Row& row);
     
     /**
-     * Validates the data type based on the column value.
+     * Appends stored rows to the batch until it is full or there are no more
+     * rows, without applying restrictions or filters. Sets hasRows to false
+     * once every row has been read.
      * 
-     * @param colName The name of the column whose value is being validated.
-     * Used for error messages.
-     * @param dataType The data type to validate
-     * @param value The value to validate the data type for
+     * @param batch The batch to append the rows to
      */
-    void validateDataType(const std::string& colName,
-            const std::string& dataType, const std::string& value);
+    virtual void readBatch(RowBatch& batch);
+    
+    /**
+     * Appends validated and formatted rows to the stored rows.
+     * 
+     * @param rows The rows to append
+     */
+    virtual void appendRows(const RowVec& rows);
     
     /**
      * Checks to see if a duplicate value exists in the table. This function
@@ -178,13 +308,25 @@ private:
      * @param index The index of the column in the table's schema
      * @throw InvalidQueryException if a duplicate value exists
      */
-    void checkForDuplicateValue(const std::string& value, 
+    virtual void checkForDuplicateValue(const std::string& value, 
             const unsigned int index);
     
     /**
-     * Counts the rows in the table.
+     * Checks that the primary keys of the given rows are unique, both among
+     * the rows and in the table.
+     * 
+     * @param rows The rows being inserted
+     * @throw InvalidQueryException if a primary key is not unique
      */
-    void countRows();
+    void checkForDuplicateKeys(const RowVec& rows) const;
+    
+    /**
+     * Reads the primary keys of the table and the values its columns
+     * reference for a bulk load.
+     * 
+     * @param keys Set to the keys
+     */
+    void loadKeys(LoadKeys& keys) const;
     
     /**
      * Writes updated rows into the temporary table, then replaces the table
@@ -192,16 +334,82 @@ private:
      * 
      * @param See updateRows().
      */
-    void writeUpdatedRows(const UpdateMap& columnsToUpdate);
+    virtual void writeUpdatedRows(const UpdateMap& columnsToUpdate);
     
     /**
      * Writes undeleted rows into the temporary table, then replaces the table
      * file.
      */
-    void writeUndeletedRows();
+    virtual void writeUndeletedRows();
+    
+    /**
+     * Extracts every remaining row from the table and sorts them.
+     * 
+     * @param See orderBy().
+     * @return The sorted rows
+     */
+    std::vector<Row> extractSortedRows(const ColumnIndexes& indexes,
+            bool desc);
+    
+    /**
+     * Binds a list of column names to their indexes in the table's schema.
+     * 
+     * @param colNames The names of the columns
+     * @return The indexes of the columns, in the order they are listed
+     */
+    ColumnIndexes bindColumns(const ColNames& colNames) const;
+    
+    /**
+     * Binds the columns being updated to their indexes in the table's schema.
+     * 
+     * @param columnsToUpdate A map of column names to updated values
+     * @return A pointer to the updated value for each column in the schema, 
+     * or nullptr for columns that are not updated
+     */
+    BoundUpdateVec bindUpdates(const UpdateMap& columnsToUpdate) const;
+    
+    /**
+     * Records a row for the distinct filter.
+     * 
+     * @param row The row, with its columns filtered
+     * @return False if an equal row was recorded before, true otherwise
+     */
+    bool addDistinctRow(const Row& row);
+    
+private:
+    /**
+     * Ensures that not null, primary key, and reference conditions are met for 
+     * the given column value.
+     * 
+     * @param metadata The metadata for the column whose value is being 
+     * validated
+     * @param colValue The value to validate
+     * @param indexInFile The index of the column in the table's schema
+     * @throw InvalidQueryException if one or more conditions are not met
+     */
+    void validateColumnValue(const ColumnMetadata& metadata, 
+            const std::string& colValue, const unsigned int indexInSchema);
+    
+    /**
+     * Counts the rows in the table.
+     */
+    void countRows();
     
     /** Extracts the next row from the table. */
     void extractRow(Row& row);
+    
+    /**
+     * Removes rows whose columns all duplicate those of a row extracted
+     * beforehand from the selection of the given batch.
+     */
+    void removeDuplicates(RowBatch& batch);
+    
+    /**
+     * Gets the stream rows are extracted from, positioned after the schema
+     * header. Tables stored in files are scanned through a ScanStream so that
+     * reading the file overlaps with parsing its rows.
+     */
+    std::istream& getScanStream();
 };
 
 #endif /* TABLE_H */
@@ -0,0 +1,185 @@
+/*
+ * File:   ThreadPool.cpp
+ * Implementation file for the ThreadPool class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include "ThreadPool.h"
+
+unsigned int ThreadPool::sharedThreadCount = 0;
+
+// Helper functions
+namespace {
+    /** The pool and index of the worker running on the calling thread. */
+    struct CurrentWorker {
+        const ThreadPool* pool = nullptr;
+        unsigned int index = 0;
+    };
+
+    thread_local CurrentWorker currentWorker;
+}  // namespace
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned int i = 0; i < threadCount; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (unsigned int i = 0; i < threadCount; i++) {
+        threads.emplace_back(&ThreadPool::runTasks, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    taskAdded.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::runSlices(std::size_t size, unsigned int sliceCount,
+        const std::function<void(unsigned int, std::size_t,
+                std::size_t)>& function,
+        Priority priority) {
+    sliceCount = std::max<std::size_t>(std::min<std::size_t>(sliceCount,
+            size), 1);
+    std::vector<std::future<void>> slices;
+    for (unsigned int i = 1; i < sliceCount; i++) {
+        slices.push_back(submit([&function, i, size, sliceCount] {
+            function(i, size * i / sliceCount, size * (i + 1) / sliceCount);
+        }, priority));
+    }
+    std::exception_ptr error;
+    try {
+        function(0, 0, size / sliceCount);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    // Every slice refers to the function, so all of them must finish first
+    for (auto& slice : slices) {
+        wait(slice);
+        try {
+            slice.get();
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+bool ThreadPool::runPendingTask() {
+    TaskFunction task;
+    if (!takeTask(getCurrentWorker(), task)) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+unsigned int ThreadPool::getThreadCount() const {
+    return threads.size();
+}
+
+unsigned int ThreadPool::getParallelism(unsigned int parallelism) const {
+    if (parallelism == 0 || parallelism > getThreadCount()) {
+        return getThreadCount();
+    }
+    return parallelism;
+}
+
+ThreadPool& ThreadPool::getShared() {
+    static ThreadPool pool(sharedThreadCount);
+    return pool;
+}
+
+void ThreadPool::setSharedThreadCount(unsigned int threadCount) {
+    sharedThreadCount = threadCount;
+}
+
+void ThreadPool::push(TaskFunction task, Priority priority) {
+    unsigned int index = getCurrentWorker();
+    if (index == workers.size()) {
+        index = nextWorker++ % workers.size();
+    }
+    Worker& worker = *workers[index];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks[static_cast<unsigned int>(priority)].push_back(
+                std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queued++;
+    }
+    taskAdded.notify_one();
+}
+
+bool ThreadPool::takeTask(unsigned int self, TaskFunction& task) {
+    unsigned int count = workers.size();
+    for (unsigned int priority = 0; priority < PRIORITY_COUNT; priority++) {
+        for (unsigned int i = 0; i < count; i++) {
+            // Start with the calling worker's own deque, if it has one.
+            // Threads that are not workers only run tasks while waiting on
+            // them, so they take the oldest tasks as workers do their own.
+            unsigned int index = (self + i) % count;
+            bool oldest = self == index || self == count;
+            Worker& worker = *workers[index];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            auto& tasks = worker.tasks[priority];
+            if (tasks.empty()) {
+                continue;
+            }
+            if (oldest) {
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            } else {
+                task = std::move(tasks.back());
+                tasks.pop_back();
+            }
+            std::lock_guard<std::mutex> sleepLock(sleepMutex);
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned int ThreadPool::getCurrentWorker() const {
+    return currentWorker.pool == this ? currentWorker.index
+            : workers.size();
+}
+
+void ThreadPool::runTasks(unsigned int index) {
+    currentWorker.pool = this;
+    currentWorker.index = index;
+    TaskFunction task;
+    while (true) {
+        if (takeTask(index, task)) {
+            // Exceptions are stored in the task's future
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        taskAdded.wait(lock, [this] {
+            return queued != 0 || stopping;
+        });
+        if (queued == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,182 @@
+/*
+ * File:   ThreadPool.h
+ * Header file for the ThreadPool class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A work-stealing pool of worker threads shared by every operator that runs
+ * in parallel, so that concurrent queries never start more threads than the
+ * pool has. Each worker has its own deque of tasks for each priority. Tasks
+ * submitted by a worker go to its own deques, and tasks submitted by other
+ * threads are spread over the workers in turn. A worker runs the tasks of
+ * its deques in the order they were submitted, and when they are empty it
+ * steals the most recently submitted task of another worker. Tasks of a
+ * higher priority are always taken first.
+ */
+class ThreadPool {
+public:
+    /** The priorities of tasks, from highest to lowest. */
+    enum class Priority : unsigned char {
+        HIGH,    // Work that a caller is waiting on interactively
+        NORMAL,  // Query operators
+        LOW      // Bulk work such as loading files
+    };
+
+    /**
+     * Starts the worker threads.
+     *
+     * @param threadCount The number of threads; 0 for one per hardware thread
+     */
+    ThreadPool(unsigned int threadCount = 0);
+
+    /** Runs the tasks already submitted, then stops the threads. */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Submits a task to be run by one of the threads.
+     *
+     * @param task A callable taking no arguments
+     * @param priority The priority of the task
+     * @return A future holding the task's result, or the exception it threw
+     */
+    template<typename Task>
+    auto submit(Task task, Priority priority = Priority::NORMAL)
+            -> std::future<decltype(task())> {
+        using ResultType = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<ResultType()>>(
+                std::move(task));
+        std::future<ResultType> result = packaged->get_future();
+        push([packaged] { (*packaged)(); }, priority);
+        return result;
+    }
+
+    /**
+     * Waits for a task to finish, running queued tasks on the calling thread
+     * in the meantime. A task can therefore wait on the tasks it submits
+     * without tying up a worker.
+     *
+     * @param future The future of the task
+     */
+    template<typename ResultType>
+    void wait(const std::future<ResultType>& future) {
+        while (future.wait_for(std::chrono::seconds(0))
+                != std::future_status::ready) {
+            if (!runPendingTask()) {
+                future.wait_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    /**
+     * Splits a range into slices of about the same size and runs a function
+     * on each slice in parallel, the first on the calling thread. Returns
+     * once every slice has finished.
+     *
+     * @param size The size of the range
+     * @param sliceCount The number of slices, which is reduced if the range
+     * is smaller
+     * @param function Called with the index, start and end of each slice
+     * @param priority The priority of the slices run by other threads
+     * @throw The first exception thrown by a slice
+     */
+    void runSlices(std::size_t size, unsigned int sliceCount,
+            const std::function<void(unsigned int, std::size_t,
+                    std::size_t)>& function,
+            Priority priority = Priority::NORMAL);
+
+    /**
+     * Runs one queued task on the calling thread.
+     *
+     * @return False if no task was queued, true otherwise
+     */
+    bool runPendingTask();
+
+    /** Gets the number of worker threads. */
+    unsigned int getThreadCount() const;
+
+    /**
+     * Gets the number of tasks an operator may keep running at once.
+     *
+     * @param parallelism The degree of parallelism requested for a query,
+     * or 0 for the default
+     * @return The requested degree, or the number of threads if it is 0 or
+     * greater
+     */
+    unsigned int getParallelism(unsigned int parallelism) const;
+
+    /** Gets the pool shared by the whole database, created on first use. */
+    static ThreadPool& getShared();
+
+    /**
+     * Sets the number of threads of the shared pool. Has no effect once the
+     * pool has been created.
+     *
+     * @param threadCount The number of threads; 0 for one per hardware thread
+     */
+    static void setSharedThreadCount(unsigned int threadCount);
+
+private:
+    static const unsigned int PRIORITY_COUNT = 3;
+
+    using TaskFunction = std::function<void()>;
+
+    /** The tasks submitted to one worker. */
+    struct Worker {
+        std::mutex mutex;
+        std::deque<TaskFunction> tasks[PRIORITY_COUNT];  // By priority
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<unsigned int> nextWorker{0};  // For tasks from other threads
+    std::mutex sleepMutex;
+    std::condition_variable taskAdded;
+    unsigned long queued = 0;  // Guarded by sleepMutex
+    bool stopping = false;     // Guarded by sleepMutex
+    static unsigned int sharedThreadCount;
+
+    /** Adds a task to the deques of a worker and wakes a thread. */
+    void push(TaskFunction task, Priority priority);
+
+    /**
+     * Takes the next task to run: the oldest task of the given worker's
+     * deques, or else the newest task of another worker, highest priority
+     * first. Callers that are not workers take the oldest task of any
+     * worker.
+     *
+     * @param self The index of the calling worker, or the number of workers
+     * if the caller is not a worker
+     * @param task Set to the task
+     * @return False if no task is queued, true otherwise
+     */
+    bool takeTask(unsigned int self, TaskFunction& task);
+
+    /** Gets the index of the calling thread's worker in this pool. */
+    unsigned int getCurrentWorker() const;
+
+    /** The body of each worker thread. */
+    void runTasks(unsigned int index);
+};
+
+#endif /* THREADPOOL_H */
+
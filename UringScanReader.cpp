@@ -0,0 +1,237 @@
+/*
+ * File:   UringScanReader.cpp
+ * Implementation file for the UringScanReader class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include "constants.h"
+#include "UringScanReader.h"
+
+// Helper functions
+namespace {
+    /** Wrapper for the io_uring_setup system call. */
+    int ioUringSetup(unsigned int entries, struct io_uring_params& params) {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    }
+
+    /** Wrapper for the io_uring_enter system call. */
+    int ioUringEnter(int ringFd, unsigned int toSubmit,
+            unsigned int minComplete, unsigned int flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit,
+                minComplete, flags, nullptr, 0));
+    }
+
+    /** Maps one of the rings shared with the kernel. */
+    void* mapRing(int ringFd, std::size_t size, off_t offset) {
+        void* ring = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, ringFd, offset);
+        if (ring == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(),
+                    "Could not map io_uring ring");
+        }
+        return ring;
+    }
+
+    /** Gets a pointer to a field at the given offset in a ring. */
+    unsigned* ringField(void* ring, unsigned int offset) {
+        return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset);
+    }
+}  // namespace
+
+UringScanReader::UringScanReader(int fd, std::size_t fileSize)
+: ScanReader(fd, fileSize), slots(SCAN_QUEUE_DEPTH) {
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ringFd = ioUringSetup(SCAN_QUEUE_DEPTH, params);
+    if (ringFd < 0) {
+        throw std::system_error(errno, std::generic_category(),
+                "io_uring is not available");
+    }
+    try {
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes
+                + params.cq_entries * sizeof(struct io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+        sqRing = mapRing(ringFd, sqRingSize, IORING_OFF_SQ_RING);
+        cqRing = (params.features & IORING_FEAT_SINGLE_MMAP) ? sqRing
+                : mapRing(ringFd, cqRingSize, IORING_OFF_CQ_RING);
+        sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+        sqes = static_cast<struct io_uring_sqe*>(
+                mapRing(ringFd, sqesSize, IORING_OFF_SQES));
+    } catch (...) {
+        releaseRing();
+        throw;
+    }
+    sqTail = ringField(sqRing, params.sq_off.tail);
+    sqMask = ringField(sqRing, params.sq_off.ring_mask);
+    sqArray = ringField(sqRing, params.sq_off.array);
+    cqHead = ringField(cqRing, params.cq_off.head);
+    cqTail = ringField(cqRing, params.cq_off.tail);
+    cqMask = ringField(cqRing, params.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe*>(
+            static_cast<char*>(cqRing) + params.cq_off.cqes);
+    try {
+        // Left uninitialized since every byte handed out is read from the file
+        std::size_t blockSize = std::min(SCAN_BLOCK_SIZE, fileSize);
+        for (unsigned int i = 0; i < slots.size(); i++) {
+            slots[i].buffer.reset(new char[blockSize]);
+            submitRead(i);
+        }
+    } catch (...) {
+        while (inFlight > 0) {
+            waitForCompletion();
+            reapCompletions();
+        }
+        releaseRing();
+        throw;
+    }
+}
+
+UringScanReader::~UringScanReader() {
+    // The kernel may still be writing into the buffers, so wait for every
+    // outstanding read before they are freed
+    try {
+        while (inFlight > 0) {
+            waitForCompletion();
+            reapCompletions();
+        }
+    } catch (const std::exception& e) {
+        // Nothing else can be done while destroying the reader
+    }
+    releaseRing();
+}
+
+bool UringScanReader::isAvailable() {
+    static const bool available = [] {
+        struct io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        int probeFd = ioUringSetup(1, params);
+        if (probeFd < 0) {
+            return false;
+        }
+        close(probeFd);
+        return true;
+    }();
+    return available;
+}
+
+bool UringScanReader::nextBlock(const char*& data, std::size_t& size) {
+    if (holdingSlot) {
+        // The previous block has been consumed, so reuse its buffer
+        holdingSlot = false;
+        unsigned int previous = current;
+        current = (current + 1) % slots.size();
+        submitRead(previous);
+    }
+    if (returnOffset >= fileSize) {
+        return false;
+    }
+    Slot& slot = slots[current];
+    while (slot.pending) {
+        reapCompletions();
+        if (slot.pending) {
+            waitForCompletion();
+        }
+    }
+    if (slot.result < 0) {
+        throw std::system_error(-slot.result, std::generic_category(),
+                "Could not read table file");
+    }
+    std::size_t count = slot.iov.iov_len;
+    std::size_t bytesRead = static_cast<std::size_t>(slot.result);
+    if (bytesRead < count) {
+        // Finish a short read synchronously to keep the blocks contiguous
+        bytesRead += readFully(slot.buffer.get() + bytesRead,
+                count - bytesRead, slot.offset + bytesRead);
+    }
+    if (bytesRead == 0) {
+        return false;
+    }
+    data = slot.buffer.get();
+    size = bytesRead;
+    returnOffset += count;
+    holdingSlot = true;
+    return true;
+}
+
+void UringScanReader::submitRead(unsigned int slotIndex) {
+    if (submitOffset >= fileSize) {
+        return;
+    }
+    Slot& slot = slots[slotIndex];
+    slot.offset = submitOffset;
+    slot.iov.iov_base = slot.buffer.get();
+    slot.iov.iov_len = std::min(SCAN_BLOCK_SIZE, fileSize - submitOffset);
+    slot.pending = true;
+    submitOffset += slot.iov.iov_len;
+
+    unsigned tail = *sqTail;
+    unsigned index = tail & *sqMask;
+    struct io_uring_sqe& sqe = sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_READV;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<unsigned long>(&slot.iov);
+    sqe.len = 1;
+    sqe.off = slot.offset;
+    sqe.user_data = slotIndex;
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    int ret;
+    while ((ret = ioUringEnter(ringFd, 1, 0, 0)) < 0 && errno == EINTR) {
+    }
+    if (ret < 0) {
+        throw std::system_error(errno, std::generic_category(),
+                "Could not submit read");
+    }
+    inFlight++;
+}
+
+void UringScanReader::reapCompletions() {
+    unsigned head = *cqHead;
+    unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        const struct io_uring_cqe& cqe = cqes[head & *cqMask];
+        Slot& slot = slots[cqe.user_data];
+        slot.result = cqe.res;
+        slot.pending = false;
+        inFlight--;
+        head++;
+    }
+    __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+}
+
+void UringScanReader::waitForCompletion() {
+    while (ioUringEnter(ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0) {
+        if (errno != EINTR) {
+            throw std::system_error(errno, std::generic_category(),
+                    "Could not wait for read");
+        }
+    }
+}
+
+void UringScanReader::releaseRing() {
+    if (sqes) {
+        munmap(sqes, sqesSize);
+    }
+    if (cqRing && cqRing != sqRing) {
+        munmap(cqRing, cqRingSize);
+    }
+    if (sqRing) {
+        munmap(sqRing, sqRingSize);
+    }
+    if (ringFd >= 0) {
+        close(ringFd);
+    }
+}
+
@@ -0,0 +1,79 @@
+/*
+ * File:   UringScanReader.h
+ * Header file for the UringScanReader class.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef URINGSCANREADER_H
+#define URINGSCANREADER_H
+
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include <memory>
+#include <vector>
+#include "ScanReader.h"
+
+/**
+ * A scan reader that keeps several block reads in flight using Linux's
+ * io_uring interface. Blocks are handed out in file order; the buffer of
+ * each block is resubmitted for a read further ahead in the file as soon as
+ * the caller moves on to the next block.
+ */
+class UringScanReader : public ScanReader {
+public:
+    /**
+     * Sets up the submission and completion rings and submits the first
+     * reads.
+     *
+     * @throw std::system_error if io_uring is not available
+     */
+    UringScanReader(int fd, std::size_t fileSize);
+    virtual ~UringScanReader() override;
+
+    /**
+     * Checks whether io_uring can be used in this process. It may be missing
+     * on older kernels or blocked by a seccomp filter.
+     */
+    static bool isAvailable();
+
+    virtual bool nextBlock(const char*& data, std::size_t& size) override;
+
+private:
+    struct Slot {
+        std::unique_ptr<char[]> buffer;
+        struct iovec iov;
+        std::size_t offset = 0;
+        int result = 0;
+        bool pending = false;
+    };
+
+    int ringFd = -1;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    struct io_uring_sqe* sqes = nullptr;
+    std::size_t sqRingSize = 0, cqRingSize = 0, sqesSize = 0;
+    unsigned *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    struct io_uring_cqe* cqes;
+
+    std::vector<Slot> slots;
+    unsigned int current = 0, inFlight = 0;
+    std::size_t submitOffset = 0, returnOffset = 0;
+    bool holdingSlot = false;
+
+    /** Submits a read of the next unread block into the given slot. */
+    void submitRead(unsigned int slotIndex);
+
+    /** Records every available completion in its slot. */
+    void reapCompletions();
+
+    /** Blocks until at least one completion is available. */
+    void waitForCompletion();
+
+    /** Unmaps the rings and closes the ring file descriptor. */
+    void releaseRing();
+};
+
+#endif /* URINGSCANREADER_H */
+
@@ -8,6 +8,7 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
+#include <cstddef>
 #include <string>
 
 /** The directory in which tables are stored */
@@ -16,6 +17,28 @@ const std::string TABLE_DIRECTORY = "./tables/";
 const std::string TABLE_EXTENSION = ".table";
 /** The extension used for temporary files created when modifying tables */
 const std::string TEMP_EXTENSION = ".tmp";
+/** The size of each block read from a table file during a scan */
+const std::size_t SCAN_BLOCK_SIZE = 1 << 20;
+/** The number of blocks a scan keeps in flight ahead of the parser */
+const unsigned int SCAN_QUEUE_DEPTH = 4;
+/** The number of rows in each batch exchanged in vectorized execution */
+const unsigned int BATCH_SIZE = 1024;
+/** The approximate size of each chunk of a file parsed by one COPY task */
+const std::size_t COPY_CHUNK_SIZE = 1 << 20;
+/** The amount of a file COPY parses before validating and writing it */
+const std::size_t COPY_SEGMENT_SIZE = 64 << 20;
+/** The most build rows a hash join puts in one partition, if it can */
+const std::size_t JOIN_PARTITION_ROWS = 1 << 12;
+/** The most bits of a key's hash used to choose its hash join partition */
+const unsigned int JOIN_MAX_PARTITION_BITS = 10;
+/** The fewest rows hashed or probed by each task of a hash join */
+const std::size_t JOIN_SLICE_ROWS = 256;
+/** The most memory a join uses before it sorts and merges its tables */
+const std::size_t JOIN_MEMORY_BUDGET = std::size_t(256) << 20;
+/** The most sorted runs merged at once by a sort-merge join */
+const std::size_t SORT_MERGE_FAN_IN = 64;
+/** The amount of output buffered before it is written to an exported file */
+const std::size_t EXPORT_BUFFER_SIZE = 1 << 20;
 
 #endif /* CONSTANTS_H */
 
@@ -0,0 +1,359 @@
+/*
+ * File:   csv_loader.cpp
+ * Implementation file for csv_loader.h.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Column.h"
+#include "constants.h"
+#include "csv_loader.h"
+#include "InvalidQueryException.h"
+#include "Row.h"
+#include "ScanReader.h"
+#include "Schema.h"
+#include "Table.h"
+#include "table_io_util.h"
+#include "ThreadPool.h"
+
+// Helper functions
+namespace {
+    /** The rows parsed from one chunk of a file. */
+    struct ChunkResult {
+        RowVec rows;
+        unsigned long lines = 0;  // The number of lines in the chunk
+        std::string error;        // Set if a record is invalid
+        unsigned long errorLine = 0;  // The line of the record in the chunk
+    };
+
+    /**
+     * Finds the end of a record: the position after a newline that is not
+     * within a quoted field. Quotes are read as readRecord() reads them: a
+     * quote only opens a quoted field at the start of a field, and the field
+     * is closed by a quote that is not doubled.
+     *
+     * @param data The data to search
+     * @param delimiter The character separating fields
+     * @param start The position of the start of a record
+     * @param position The position to search from
+     * @return The end of the first record ending at or after the position;
+     * if there is none, the end of the last record after the start, or
+     * npos if no record after the start ends
+     */
+    std::size_t findRecordEnd(std::string_view data, char delimiter,
+            std::size_t start, std::size_t position) {
+        bool quoted = false, fieldStart = true;
+        std::size_t lastEnd = std::string_view::npos;
+        for (std::size_t i = start; i < data.size(); i++) {
+            char c = data[i];
+            if (quoted) {
+                if (c == '"' && i + 1 < data.size() && data[i + 1] == '"') {
+                    i++;
+                } else if (c == '"') {
+                    quoted = false;
+                }
+            } else if (c == '"' && fieldStart) {
+                quoted = true;
+                fieldStart = false;
+            } else if (c == '\n') {
+                lastEnd = i + 1;
+                if (i >= position) {
+                    break;
+                }
+                fieldStart = true;
+            } else {
+                fieldStart = c == delimiter;
+            }
+        }
+        return lastEnd;
+    }
+
+    /**
+     * Finds the end of the chunk of a segment starting at the given position.
+     *
+     * @param segment The segment
+     * @param delimiter The character separating fields
+     * @param start The position of the start of a record
+     * @param finished Whether the segment ends at the end of the file
+     * @return The end of the chunk, or npos if there are no more records or
+     * they are completed by the next segment
+     */
+    std::size_t findChunkEnd(std::string_view segment, char delimiter,
+            std::size_t start, bool finished) {
+        if (start >= segment.size()) {
+            return std::string_view::npos;
+        }
+        std::size_t end = findRecordEnd(segment, delimiter, start,
+                start + COPY_CHUNK_SIZE);
+        if (end == std::string_view::npos && finished) {
+            return segment.size();
+        }
+        return end;
+    }
+
+    /**
+     * How the fields of a char or varchar column are stored: cut to the
+     * column's length, and padded to it for char columns.
+     */
+    struct TextFormat {
+        bool isText = false;
+        std::size_t length = 0;
+        bool padded = false;
+    };
+
+    TextFormat getTextFormat(const std::string& dataType) {
+        TextFormat format;
+        std::size_t open = dataType.find('(');
+        if (dataType.find("char") == std::string::npos
+                || open == std::string::npos) {
+            return format;
+        }
+        format.isText = true;
+        format.length = std::stoul(dataType.substr(open + 1));
+        format.padded = dataType.compare(0, open, "char") == 0;
+        return format;
+    }
+
+    /**
+     * Reads the fields of the next record.
+     *
+     * @param chunk The chunk holding the record
+     * @param i The position of the record. Set to the position after it.
+     * @param delimiter The character separating fields
+     * @param fields Set to the fields, reusing their storage; only the first
+     * count entries belong to the record
+     * @param quoted Set to whether each field was quoted
+     * @param lines Incremented for each line the record spans
+     * @return The number of fields in the record
+     * @throw InvalidQueryException if a quote is not closed
+     */
+    unsigned int readRecord(std::string_view chunk, std::size_t& i,
+            char delimiter, std::vector<std::string>& fields,
+            std::vector<bool>& quoted, unsigned long& lines) {
+        unsigned int count = 0;
+        while (true) {
+            if (count == fields.size()) {
+                fields.emplace_back();
+                quoted.push_back(false);
+            }
+            std::string& field = fields[count];
+            field.clear();
+            quoted[count] = i < chunk.size() && chunk[i] == '"';
+            if (quoted[count]) {
+                for (i++; ; i++) {
+                    if (i >= chunk.size()) {
+                        throw InvalidQueryException("Unterminated quoted "
+                                "field");
+                    } else if (chunk[i] == '"' && i + 1 < chunk.size()
+                            && chunk[i + 1] == '"') {
+                        field += '"';
+                        i++;
+                    } else if (chunk[i] == '"') {
+                        i++;
+                        break;
+                    } else {
+                        lines += chunk[i] == '\n';
+                        field += chunk[i];
+                    }
+                }
+            }
+            std::size_t end = i;
+            while (end < chunk.size() && chunk[end] != delimiter
+                    && chunk[end] != '\n') {
+                end++;
+            }
+            field.append(chunk.substr(i, end - i));
+            i = end;
+            count++;
+            if (i >= chunk.size() || chunk[i] == '\n') {
+                break;
+            }
+            i++;  // Skip the delimiter
+        }
+        if (!fields[count - 1].empty() && fields[count - 1].back() == '\r') {
+            fields[count - 1].pop_back();
+        }
+        i++;  // Skip the newline
+        lines++;
+        return count;
+    }
+
+    /**
+     * Parses the records of a chunk into rows, converting each field to the
+     * type of its column and formatting it as it is stored.
+     *
+     * @param chunk The records, ending at a record boundary
+     * @param schema The schema of the table being loaded
+     * @param delimiter The character separating fields
+     * @return The rows, or the first error
+     */
+    ChunkResult parseChunk(std::string_view chunk, const Schema& schema,
+            char delimiter) {
+        ChunkResult result;
+        const MetadataVec& columns = schema.getMetadataForColumns();
+        std::vector<TextFormat> textFormats;
+        for (const auto& metadata : columns) {
+            textFormats.push_back(getTextFormat(metadata.getColumnType()));
+        }
+        Row blank(schema);
+        blank.fillBlank(columns.size());
+        std::vector<std::string> fields;
+        std::vector<bool> quoted;
+        std::string value;
+        std::size_t i = 0;
+        while (i < chunk.size()) {
+            unsigned long recordLine = result.lines;
+            try {
+                unsigned int count = readRecord(chunk, i, delimiter, fields,
+                        quoted, result.lines);
+                if (count == 1 && fields[0].empty() && !quoted[0]) {
+                    continue;  // Blank line
+                } else if (count != columns.size()) {
+                    throw InvalidQueryException("Expected "
+                            + std::to_string(columns.size())
+                            + " values but got " + std::to_string(count));
+                }
+                result.rows.push_back(blank);
+                Row& row = result.rows.back();
+                for (unsigned int c = 0; c < count; c++) {
+                    const ColumnMetadata& metadata = columns[c];
+                    const std::string& dataType = metadata.getColumnType();
+                    const TextFormat& textFormat = textFormats[c];
+                    if (fields[c].empty() && !quoted[c]) {
+                        value = Column::NULL_VALUE;
+                    } else if (textFormat.isText) {
+                        // Text is stored as it is, so it is not converted
+                        if (fields[c].find('\n') != std::string::npos) {
+                            // Table files store one row per line
+                            throw InvalidQueryException("Values cannot "
+                                    "contain newlines");
+                        }
+                        value = fields[c];
+                        if (value.size() > textFormat.length) {
+                            value.resize(textFormat.length);
+                        } else if (textFormat.padded) {
+                            value.resize(textFormat.length, ' ');
+                        }
+                    } else {
+                        value = fields[c];
+                        Table::validateDataType(metadata.getColumnName(),
+                                dataType, value);
+                        table_io_util::formatColumnValue(dataType, value);
+                    }
+                    if (metadata.isNotNull() && value == Column::NULL_VALUE) {
+                        throw InvalidQueryException(metadata.getColumnName()
+                                + " cannot be null");
+                    }
+                    row[c].setValue(value, &metadata);
+                }
+            } catch (const std::exception& e) {
+                result.error = e.what();
+                result.errorLine = recordLine;
+                return result;
+            }
+        }
+        return result;
+    }
+}  // namespace
+
+unsigned long csv_loader::loadFile(const std::string& tableName,
+        const std::string& path, const Options& options) {
+    char delimiter = options.delimiter;
+    if (delimiter == '"' || delimiter == '\n' || delimiter == '\r') {
+        throw InvalidQueryException("Invalid delimiter");
+    }
+    auto table = table_io_util::openTable(tableName);
+    const Schema& schema = table->getSchema();
+    auto reader = ScanReader::open(path);
+    if (!reader) {
+        throw InvalidQueryException("Could not open " + path);
+    }
+    ThreadPool& pool = ThreadPool::getShared();
+    unsigned int parallelism = pool.getParallelism(options.parallelism);
+    std::string buffer;
+    Table::LoadKeys keys;  // Read with the first segment
+    unsigned long line = 0, loaded = 0;
+    bool skipHeader = options.header, finished = false;
+    while (!finished) {
+        // Read the next segment, after the partial record left in the buffer
+        const char* data;
+        std::size_t size;
+        while (buffer.size() < COPY_SEGMENT_SIZE) {
+            if (!reader->nextBlock(data, size)) {
+                finished = true;
+                break;
+            }
+            buffer.append(data, size);
+        }
+        std::string_view segment = buffer;
+        std::size_t start = 0;
+        if (skipHeader) {
+            std::size_t end = findRecordEnd(segment, delimiter, 0, 0);
+            if (end == std::string_view::npos && !finished) {
+                throw InvalidQueryException("Header is too long");
+            }
+            start = end == std::string_view::npos ? segment.size() : end;
+            skipHeader = false;
+            line++;
+        }
+        // Split the segment into chunks of whole records and parse them,
+        // with at most one chunk in flight per degree of parallelism
+        std::deque<std::future<ChunkResult>> chunks;
+        unsigned long chunkCount = 0;
+        RowVec rows;
+        std::string error;
+        while (true) {
+            while (error.empty() && chunks.size() < parallelism) {
+                std::size_t end = findChunkEnd(segment, delimiter, start,
+                        finished);
+                if (end == std::string_view::npos) {
+                    break;
+                }
+                std::string_view chunk = segment.substr(start, end - start);
+                chunks.push_back(pool.submit([chunk, &schema, delimiter] {
+                    return parseChunk(chunk, schema, delimiter);
+                }, ThreadPool::Priority::LOW));
+                chunkCount++;
+                start = end;
+            }
+            if (chunks.empty()) {
+                break;
+            }
+            pool.wait(chunks.front());
+            ChunkResult result = chunks.front().get();
+            chunks.pop_front();
+            if (!error.empty()) {
+                // The chunks in flight refer to the buffer, so they must
+                // finish before the error is reported
+                continue;
+            } else if (!result.error.empty()) {
+                error = "Line " + std::to_string(line + result.errorLine + 1)
+                        + ": " + result.error;
+                continue;
+            }
+            line += result.lines;
+            rows.insert(rows.end(), std::make_move_iterator(
+                    result.rows.begin()), std::make_move_iterator(
+                    result.rows.end()));
+        }
+        if (!error.empty()) {
+            throw InvalidQueryException(error);
+        } else if (chunkCount == 0 && !finished) {
+            throw InvalidQueryException("Line " + std::to_string(line + 1)
+                    + ": Record is too long");
+        }
+        table->insertFormattedRows(rows, keys);
+        loaded += rows.size();
+        buffer.erase(0, start);
+    }
+    return loaded;
+}
@@ -0,0 +1,50 @@
+/*
+ * File:   csv_loader.h
+ * Loads tables from delimited text files in parallel.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef CSV_LOADER_H
+#define CSV_LOADER_H
+
+#include <string>
+
+namespace csv_loader {
+    /** How the records of a file are written. */
+    struct Options {
+        char delimiter = ',';  // Separates the fields of a record
+        bool header = false;   // Whether the first record names the columns
+        // The most chunks parsed at once, or 0 for one per thread of the pool
+        unsigned int parallelism = 0;
+    };
+
+    /**
+     * Appends the records of a delimited text file to a table. Each record
+     * holds one field per column of the table, in the order of the table's
+     * columns. Fields may be enclosed in double quotes, in which case they
+     * may hold delimiters and doubled quotes (""). Values cannot hold
+     * newlines, since table files store one row per line. An empty field
+     * that is not quoted is null.
+     *
+     * The file is split into chunks at record boundaries, which are parsed
+     * and converted to their columns' types in parallel on the shared
+     * ThreadPool, at low priority. The rows of each segment of the file are
+     * then validated together and appended to the table at once, so if a
+     * record is invalid, the segments before it remain in the table. The
+     * table's primary keys and the values its columns reference are read
+     * once, with the first segment, and kept for the rest of the load.
+     *
+     * @param tableName The name of the table
+     * @param path The path of the file
+     * @param options How the records are written
+     * @return The number of rows added
+     * @throw InvalidQueryException if the file cannot be read or a record is
+     * invalid
+     */
+    unsigned long loadFile(const std::string& tableName,
+            const std::string& path, const Options& options);
+}
+
+#endif /* CSV_LOADER_H */
+
@@ -0,0 +1,240 @@
+/*
+ * File:   filter_kernels.cpp
+ * Implementation file for filter_kernels.h.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include "filter_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FILTER_KERNELS_X86
+#endif
+
+// Helper functions
+namespace {
+    using filter_kernels::Bitmap;
+    using filter_kernels::Operator;
+
+    /**
+     * How an operator is computed from the less than and greater than tests:
+     * 'value op constant' is ((less && value < constant)
+     * || (greater && value > constant)) != invert.
+     */
+    struct Plan {
+        bool less;
+        bool greater;
+        bool invert;
+    };
+
+    /** The instruction sets there are kernels for. */
+    enum class InstructionSet {
+        AVX2, SSE42, SCALAR
+    };
+
+    Plan getPlan(Operator op) {
+        switch (op) {
+            case Operator::EQUAL:
+                return {true, true, true};
+            case Operator::NOT_EQUAL:
+                return {true, true, false};
+            case Operator::LESS:
+                return {true, false, false};
+            case Operator::LESS_EQUAL:
+                return {false, true, true};
+            case Operator::GREATER:
+                return {false, true, false};
+            case Operator::GREATER_EQUAL:
+                return {true, false, true};
+        }
+        return {false, false, false};
+    }
+
+    InstructionSet detectInstructionSet() {
+#ifdef FILTER_KERNELS_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return InstructionSet::AVX2;
+        } else if (__builtin_cpu_supports("sse4.2")) {
+            return InstructionSet::SSE42;
+        }
+#endif
+        return InstructionSet::SCALAR;
+    }
+
+    /** The instruction set of the kernels, chosen once at startup. */
+    const InstructionSet instructionSet = detectInstructionSet();
+
+    /**
+     * Compares up to 64 values, returning the results as the bits of a word.
+     */
+    template<typename T>
+    std::uint64_t compareWord(const T* values, std::size_t count,
+            T constant, Plan plan) {
+        std::uint64_t word = 0;
+        for (std::size_t i = 0; i < count; i++) {
+            bool hit = (plan.less && values[i] < constant)
+                    || (plan.greater && values[i] > constant);
+            word |= static_cast<std::uint64_t> (hit != plan.invert) << i;
+        }
+        return word;
+    }
+
+    /**
+     * Compares blocks of 64 values, writing one word of results per block.
+     */
+    template<typename T>
+    void compareBlocksScalar(const T* values, std::size_t blocks,
+            T constant, Plan plan, std::uint64_t* words) {
+        for (std::size_t b = 0; b < blocks; b++) {
+            words[b] = compareWord(values + b * 64, 64, constant, plan);
+        }
+    }
+
+#ifdef FILTER_KERNELS_X86
+    __attribute__((target("avx2")))
+    void compareBlocksAvx2(const long long* values, std::size_t blocks,
+            long long constant, Plan plan, std::uint64_t* words) {
+        const __m256i c = _mm256_set1_epi64x(constant);
+        for (std::size_t b = 0; b < blocks; b++) {
+            const long long* block = values + b * 64;
+            std::uint64_t word = 0;
+            for (unsigned int i = 0; i < 64; i += 4) {
+                __m256i v = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*> (block + i));
+                __m256i mask = _mm256_setzero_si256();
+                if (plan.less) {
+                    mask = _mm256_or_si256(mask, _mm256_cmpgt_epi64(c, v));
+                }
+                if (plan.greater) {
+                    mask = _mm256_or_si256(mask, _mm256_cmpgt_epi64(v, c));
+                }
+                word |= static_cast<std::uint64_t> (_mm256_movemask_pd(
+                        _mm256_castsi256_pd(mask))) << i;
+            }
+            words[b] = plan.invert ? ~word : word;
+        }
+        // Clear the upper halves of the AVX registers so that the SSE code
+        // that runs next does not pay for saving them. Compilers only do
+        // this on their own at higher optimization levels.
+        _mm256_zeroupper();
+    }
+
+    __attribute__((target("avx2")))
+    void compareBlocksAvx2(const double* values, std::size_t blocks,
+            double constant, Plan plan, std::uint64_t* words) {
+        const __m256d c = _mm256_set1_pd(constant);
+        for (std::size_t b = 0; b < blocks; b++) {
+            const double* block = values + b * 64;
+            std::uint64_t word = 0;
+            for (unsigned int i = 0; i < 64; i += 4) {
+                __m256d v = _mm256_loadu_pd(block + i);
+                // Ordered comparisons are false for NaN, like operator<
+                __m256d mask = _mm256_setzero_pd();
+                if (plan.less) {
+                    mask = _mm256_or_pd(mask, _mm256_cmp_pd(v, c, _CMP_LT_OQ));
+                }
+                if (plan.greater) {
+                    mask = _mm256_or_pd(mask, _mm256_cmp_pd(v, c, _CMP_GT_OQ));
+                }
+                word |= static_cast<std::uint64_t> (_mm256_movemask_pd(mask))
+                        << i;
+            }
+            words[b] = plan.invert ? ~word : word;
+        }
+        _mm256_zeroupper();
+    }
+
+    __attribute__((target("sse4.2")))
+    void compareBlocksSse42(const long long* values, std::size_t blocks,
+            long long constant, Plan plan, std::uint64_t* words) {
+        const __m128i c = _mm_set1_epi64x(constant);
+        for (std::size_t b = 0; b < blocks; b++) {
+            const long long* block = values + b * 64;
+            std::uint64_t word = 0;
+            for (unsigned int i = 0; i < 64; i += 2) {
+                __m128i v = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*> (block + i));
+                __m128i mask = _mm_setzero_si128();
+                if (plan.less) {
+                    mask = _mm_or_si128(mask, _mm_cmpgt_epi64(c, v));
+                }
+                if (plan.greater) {
+                    mask = _mm_or_si128(mask, _mm_cmpgt_epi64(v, c));
+                }
+                word |= static_cast<std::uint64_t> (_mm_movemask_pd(
+                        _mm_castsi128_pd(mask))) << i;
+            }
+            words[b] = plan.invert ? ~word : word;
+        }
+    }
+
+    __attribute__((target("sse4.2")))
+    void compareBlocksSse42(const double* values, std::size_t blocks,
+            double constant, Plan plan, std::uint64_t* words) {
+        const __m128d c = _mm_set1_pd(constant);
+        for (std::size_t b = 0; b < blocks; b++) {
+            const double* block = values + b * 64;
+            std::uint64_t word = 0;
+            for (unsigned int i = 0; i < 64; i += 2) {
+                __m128d v = _mm_loadu_pd(block + i);
+                __m128d mask = _mm_setzero_pd();
+                if (plan.less) {
+                    mask = _mm_or_pd(mask, _mm_cmplt_pd(v, c));
+                }
+                if (plan.greater) {
+                    mask = _mm_or_pd(mask, _mm_cmpgt_pd(v, c));
+                }
+                word |= static_cast<std::uint64_t> (_mm_movemask_pd(mask))
+                        << i;
+            }
+            words[b] = plan.invert ? ~word : word;
+        }
+    }
+#endif
+
+    /**
+     * Compares the values with the kernel for the CPU, then compares the
+     * values past the last whole block of 64 one at a time.
+     */
+    template<typename T>
+    void compareValues(const T* values, std::size_t count, Operator op,
+            T constant, Bitmap& result) {
+        Plan plan = getPlan(op);
+        std::size_t blocks = count / 64;
+        result.assign((count + 63) / 64, 0);
+        switch (instructionSet) {
+#ifdef FILTER_KERNELS_X86
+            case InstructionSet::AVX2:
+                compareBlocksAvx2(values, blocks, constant, plan,
+                        result.data());
+                break;
+            case InstructionSet::SSE42:
+                compareBlocksSse42(values, blocks, constant, plan,
+                        result.data());
+                break;
+#endif
+            default:
+                compareBlocksScalar(values, blocks, constant, plan,
+                        result.data());
+                break;
+        }
+        if (count % 64 != 0) {
+            result[blocks] = compareWord(values + blocks * 64, count % 64,
+                    constant, plan);
+        }
+    }
+}  // namespace
+
+void filter_kernels::compare(const long long* values, std::size_t count,
+        Operator op, long long constant, Bitmap& result) {
+    compareValues(values, count, op, constant, result);
+}
+
+void filter_kernels::compare(const double* values, std::size_t count,
+        Operator op, double constant, Bitmap& result) {
+    compareValues(values, count, op, constant, result);
+}
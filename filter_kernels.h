@@ -0,0 +1,53 @@
+/*
+ * File:   filter_kernels.h
+ * Vectorized kernels comparing columns of numbers to constants.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef FILTER_KERNELS_H
+#define FILTER_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace filter_kernels {
+    /** The comparisons the kernels can apply. */
+    enum class Operator : unsigned char {
+        EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL
+    };
+
+    /** A set of rows, where bit i % 64 of word i / 64 stands for row i. */
+    using Bitmap = std::vector<std::uint64_t>;
+
+    /**
+     * Checks if the given row is set in the bitmap.
+     */
+    inline bool isSet(const Bitmap& bitmap, unsigned int row) {
+        return (bitmap[row / 64] >> (row % 64)) & 1;
+    }
+
+    /**
+     * Compares every value to a constant, 'value op constant'. The kernel is
+     * chosen once for the instruction sets the CPU supports: AVX2, then
+     * SSE4.2, then plain C++.
+     *
+     * Values compare the way Column does: two values are equal when neither
+     * is less than the other, so NaN is equal to everything.
+     *
+     * @param values The values to compare
+     * @param count The number of values
+     * @param op The comparison to apply
+     * @param constant The value to compare to
+     * @param result Set to the rows for which the comparison holds; bits
+     * past count are cleared
+     */
+    void compare(const long long* values, std::size_t count, Operator op,
+            long long constant, Bitmap& result);
+    void compare(const double* values, std::size_t count, Operator op,
+            double constant, Bitmap& result);
+}
+
+#endif /* FILTER_KERNELS_H */
+
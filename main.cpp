@@ -11,10 +11,15 @@
 #include <string>
 #include <unordered_map>
 
-#include "Query.h"
+#include "JoinedTable.h"
+#include "PlanCache.h"
 #include "Result.h"
 #include "Row.h"
+#include "RowBatch.h"
+#include "ScanReader.h"
 #include "Table.h"
+#include "table_io_util.h"
+#include "ThreadPool.h"
 
 // Helper functions
 namespace {
@@ -43,7 +48,7 @@ namespace {
      * Prints the column headers of the given row.
      */
     void printColumnHeaders(const Row& row) {
-        for (Column col : row.getColumns()) {
+        for (const auto& col : row.getColumns()) {
             auto width = getWidthForColumn(col.getMetadata().getColumnType());
             auto header = col.getMetadata().getTableName() + "." 
                           + col.getMetadata().getColumnName();
@@ -57,7 +62,7 @@ namespace {
      * Prints the row, formatted to account for width of columns
      */
     void printRow(const Row& row) {
-        for (Column col : row.getColumns()) {
+        for (const auto& col : row.getColumns()) {
                 auto width = getWidthForColumn(col.getMetadata()
                     .getColumnType());
                 std::cout << std::setw(width) << std::left 
@@ -67,35 +72,147 @@ namespace {
         std::cout << std::endl;
     }
 
+    /** Whether results are extracted in batches instead of row by row. */
+    bool vectorized = true;
+
+    /** The number of parsed queries kept by the plan cache. */
+    std::size_t planCacheSize = PlanCache::DEFAULT_CAPACITY;
+
+    /** Whether the plan cache's hits and misses are reported on exit. */
+    bool reportPlanCache = false;
+
+    /**
+     * Prints a row of a query's result, preceded by the column headers if it
+     * is the first row.
+     */
+    void printResultRow(const Row& row, bool& firstLine) {
+        if (firstLine) {
+            std::cout << std::endl;
+            printColumnHeaders(row);
+            std::cout << std::endl;
+            firstLine = false;
+        }
+        printRow(row);
+        std::cout << std::endl;
+    }
+
+    /**
+     * Prints the rows of a query's result.
+     */
+    void printResult(Result& result) {
+        Row row;
+        bool firstLine = true;
+        if (!vectorized) {
+            while (result >> row) {
+                printResultRow(row, firstLine);
+            }
+            return;
+        }
+        RowBatch batch;
+        while (result.nextBatch(batch)) {
+            for (unsigned int position : batch.getSelection()) {
+                batch.copyRow(position, row);
+                printResultRow(row, firstLine);
+            }
+        }
+    }
+
+    /**
+     * Parses the value of a numeric command line option, which must be a
+     * non-negative integer of at most the given number of digits.
+     *
+     * @param value The text after the option's = sign
+     * @param maxDigits The most digits the value may have
+     * @param number Set to the value
+     * @return False if the value is not valid, true otherwise
+     */
+    bool parseOptionValue(const std::string& value, std::size_t maxDigits,
+            std::size_t& number) {
+        if (value.empty() || value.size() > maxDigits
+                || value.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        number = std::stoull(value);
+        return true;
+    }
+
+    /**
+     * Applies the command line options.
+     *
+     * @return False if an option is not recognized, true otherwise
+     */
+    bool parseArguments(int argc, char** argv) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--scan=async") {
+                ScanReader::setMode(ScanReader::Mode::ASYNC);
+            } else if (arg == "--scan=prefetch") {
+                ScanReader::setMode(ScanReader::Mode::PREFETCH);
+            } else if (arg == "--exec=batch") {
+                vectorized = true;
+            } else if (arg == "--exec=row") {
+                vectorized = false;
+            } else if (arg == ":memory:") {
+                table_io_util::setInMemory(true);
+            } else if (arg.find("--plan-cache=") == 0) {
+                if (!parseOptionValue(arg.substr(13), 9, planCacheSize)) {
+                    std::cerr << "Expected a number of queries: " << arg
+                            << std::endl;
+                    return false;
+                }
+            } else if (arg.find("--join-memory=") == 0) {
+                std::size_t budget;
+                if (!parseOptionValue(arg.substr(14), 18, budget)) {
+                    std::cerr << "Expected a number of bytes: " << arg
+                            << std::endl;
+                    return false;
+                }
+                JoinedTable::setMemoryBudget(budget);
+            } else if (arg.find("--threads=") == 0) {
+                // 0 starts one thread per hardware thread, as by default
+                std::size_t threadCount;
+                if (!parseOptionValue(arg.substr(10), 4, threadCount)) {
+                    std::cerr << "Expected a number of threads: " << arg
+                            << std::endl;
+                    return false;
+                }
+                ThreadPool::setSharedThreadCount(threadCount);
+            } else if (arg == "--plan-cache-stats") {
+                reportPlanCache = true;
+            } else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
 }  // namespace
 
 /**
  * The main function of the program. Handles the CLI.
  */
 int main(int argc, char** argv) {
+    if (!parseArguments(argc, argv)) {
+        return 1;
+    }
+    PlanCache planCache(planCacheSize);
     std::string queryString;
     std::cout << "query> ";
     while (std::getline(std::cin, queryString) && queryString != "quit") {
         try {
-            Query query(queryString);
-            Result result = query.execute();
-            Row row;
-            bool firstLine = true;
-            while (result >> row) {
-                if (firstLine) {
-                    std::cout << std::endl;
-                    printColumnHeaders(row);
-                    std::cout << std::endl;
-                    firstLine = false;
-                }
-                printRow(row);
-                std::cout << std::endl;
-            }
+            Result result = planCache.execute(queryString);
+            printResult(result);
         } catch (const std::exception& e) {
             std::cout << "Error: " << e.what() << std::endl;
         }
         std::cout << "query> ";
     }
+    if (reportPlanCache) {
+        std::cerr << "Plan cache: " << planCache.getHits() << " hits, "
+                << planCache.getMisses() << " misses, " << planCache.size()
+                << " entries" << std::endl;
+    }
     return 0;
 }
 
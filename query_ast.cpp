@@ -0,0 +1,35 @@
+/*
+ * File:   query_ast.cpp
+ * Implementation file for query_ast.h.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <string>
+#include <string_view>
+#include "Column.h"
+#include "query_ast.h"
+#include "query_lexer.h"
+#include "string_util.h"
+
+std::string query_ast::Literal::getValue() const {
+    return kind == Kind::STRING ? string_util::extractQuoted(text) : text;
+}
+
+const std::string& query_ast::Operand::getText() const {
+    return isColumn ? column : literal.text;
+}
+
+query_ast::Literal query_ast::makeLiteral(std::string_view text) {
+    Literal literal;
+    if (query_lexer::findKeyword(text) == query_lexer::Keyword::NULL_VALUE) {
+        literal.kind = Literal::Kind::NULL_VALUE;
+        literal.text = Column::NULL_VALUE;
+        return literal;
+    }
+    bool quoted = !text.empty() && (text.front() == '"'
+            || text.front() == '\'');
+    literal.kind = quoted ? Literal::Kind::STRING : Literal::Kind::NUMERIC;
+    literal.text = text;
+    return literal;
+}
@@ -0,0 +1,167 @@
+/*
+ * File:   query_ast.h
+ * The syntax tree that queries are parsed into.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef QUERY_AST_H
+#define QUERY_AST_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "result_writer.h"
+#include "Schema.h"
+
+namespace query_ast {
+    /** A literal value, kept as it was written in the query. */
+    struct Literal {
+        enum class Kind : unsigned char {
+            NULL_VALUE,  // The keyword null
+            STRING,      // A quoted string
+            NUMERIC,     // An unquoted number, date or time
+            PARAMETER    // A placeholder of a prepared statement, ? or $n
+        } kind = Kind::NULL_VALUE;
+        std::string text;  // Quotes included; Column::NULL_VALUE for null
+        // For parameters, n for $n, or 0 for ? (numbered in query order)
+        unsigned int parameter = 0;
+
+        /**
+         * Gets the value of the literal, without quotes.
+         */
+        std::string getValue() const;
+    };
+
+    /** One side of a comparison: a column or a literal value. */
+    struct Operand {
+        bool isColumn = false;
+        std::string column;  // The column name, possibly qualified
+        Literal literal;     // The value if the operand is not a column
+
+        /** Gets the operand as it was written in the query. */
+        const std::string& getText() const;
+    };
+
+    /** The comparison operators. */
+    enum class Operator : unsigned char {
+        EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL, LIKE
+    };
+
+    /** A comparison of the form 'left op right'. */
+    struct Comparison {
+        Operand left;
+        Operator op = Operator::EQUAL;
+        Operand right;
+    };
+
+    /**
+     * A boolean expression: a comparison, or the AND or OR of two or more
+     * expressions.
+     */
+    struct Expression {
+        enum class Kind : unsigned char { COMPARISON, AND, OR } kind =
+                Kind::COMPARISON;
+        Comparison comparison;  // Set for COMPARISON
+        std::vector<Expression> children;  // Set for AND and OR
+    };
+
+    /** A restriction shared between a statement and the tables using it. */
+    using ExpressionPtr = std::shared_ptr<const Expression>;
+
+    /** CREATE [TEMPORARY] TABLE tableName ( columns ) */
+    struct CreateStatement {
+        std::string tableName;
+        MetadataVec columns;
+        bool temporary = false;
+    };
+
+    /** DROP TABLE tableName */
+    struct DropStatement {
+        std::string tableName;
+    };
+
+    /**
+     * INSERT INTO tableName ( columnNames ) VALUES ( values ) [, ( values )
+     * ...]
+     */
+    struct InsertStatement {
+        std::string tableName;
+        std::vector<std::string> columnNames;
+        // The values of each row, in the order of columnNames
+        std::vector<std::vector<Literal>> rows;
+    };
+
+    /** UPDATE tableName SET column = value, ... [WHERE restriction] */
+    struct UpdateStatement {
+        std::string tableName;
+        std::vector<std::pair<std::string, Literal>> assignments;
+        ExpressionPtr restriction;  // Null if there is no WHERE clause
+    };
+
+    /** DELETE FROM tableName [WHERE restriction] */
+    struct DeleteStatement {
+        std::string tableName;
+        ExpressionPtr restriction;  // Null if there is no WHERE clause
+    };
+
+    /**
+     * SELECT [DISTINCT] columnNames FROM tableNames [WHERE restriction]
+     * [ORDER BY orderBy [DESC]] [INTO OUTFILE 'path' [FORMAT format]]
+     * [WITH (PARALLELISM n)]
+     */
+    struct SelectStatement {
+        bool distinct = false;
+        std::vector<std::string> columnNames;  // Just "*" for every column
+        std::vector<std::string> tableNames;
+        ExpressionPtr restriction;  // Null if there is no WHERE clause
+        // The comparisons between two columns in the restriction's top-level
+        // AND conjuncts, which the tables are joined on
+        std::vector<Comparison> joinConditions;
+        std::vector<std::string> orderBy;
+        bool desc = false;
+        std::string outfile;  // The file the rows are written to, if any
+        result_writer::Format format = result_writer::Format::CSV;
+        unsigned int parallelism = 0;  // Of table scans; 0 for the default
+    };
+
+    /** COPY tableName FROM 'path' [WITH ( options )] */
+    struct CopyStatement {
+        std::string tableName;
+        std::string path;  // The file the rows are read from
+        char delimiter = ',';
+        bool header = false;  // Whether the first line names the columns
+        unsigned int parallelism = 0;  // Of parsing; 0 for the default
+    };
+
+    /** PREPARE name AS query */
+    struct PrepareStatement {
+        std::string name;
+        std::string queryString;  // The query being prepared
+    };
+
+    /** EXECUTE name [( arguments )] */
+    struct ExecuteStatement {
+        std::string name;
+        std::vector<Literal> arguments;  // The values of the parameters
+    };
+
+    using Statement = std::variant<CreateStatement, DropStatement,
+            InsertStatement, UpdateStatement, DeleteStatement,
+            SelectStatement, CopyStatement, PrepareStatement,
+            ExecuteStatement>;
+
+    /**
+     * Creates the literal for a value written as in a query: null, a quoted
+     * string, or an unquoted number, date or time.
+     *
+     * @param text The value as written
+     */
+    Literal makeLiteral(std::string_view text);
+}
+
+#endif /* QUERY_AST_H */
+
@@ -0,0 +1,227 @@
+/*
+ * File:   query_lexer.cpp
+ * Implementation file for query_lexer.h.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <string_view>
+#include "query_lexer.h"
+
+// Helper functions
+namespace {
+    using query_lexer::Keyword;
+
+    struct KeywordEntry {
+        std::string_view text;
+        Keyword keyword;
+    };
+
+    /** The keywords, in lowercase. */
+    constexpr KeywordEntry KEYWORDS[] = {
+        {"and", Keyword::AND}, {"as", Keyword::AS}, {"by", Keyword::BY},
+        {"copy", Keyword::COPY}, {"create", Keyword::CREATE},
+        {"delete", Keyword::DELETE},
+        {"desc", Keyword::DESC}, {"distinct", Keyword::DISTINCT},
+        {"drop", Keyword::DROP}, {"execute", Keyword::EXECUTE},
+        {"from", Keyword::FROM}, {"insert", Keyword::INSERT},
+        {"into", Keyword::INTO}, {"key", Keyword::KEY},
+        {"like", Keyword::LIKE}, {"not", Keyword::NOT},
+        {"null", Keyword::NULL_VALUE}, {"or", Keyword::OR},
+        {"order", Keyword::ORDER}, {"prepare", Keyword::PREPARE},
+        {"primary", Keyword::PRIMARY}, {"references", Keyword::REFERENCES},
+        {"select", Keyword::SELECT}, {"set", Keyword::SET},
+        {"table", Keyword::TABLE}, {"temporary", Keyword::TEMPORARY},
+        {"update", Keyword::UPDATE}, {"values", Keyword::VALUES},
+        {"where", Keyword::WHERE}, {"with", Keyword::WITH}
+    };
+
+    const std::size_t KEYWORD_COUNT = sizeof(KEYWORDS) / sizeof(KEYWORDS[0]);
+
+    /** The lengths of the shortest and longest keywords. */
+    const std::size_t MIN_KEYWORD_LENGTH = 2;
+    const std::size_t MAX_KEYWORD_LENGTH = 10;
+
+    /** The number of slots in the keyword table; a power of two. */
+    constexpr unsigned int TABLE_SIZE = 64;
+
+    constexpr char toLower(char c) {
+        return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+    }
+
+    /**
+     * Hashes a word by its first and last letters and its length, ignoring
+     * case. The multipliers were chosen so that no two keywords collide.
+     */
+    constexpr unsigned int hashWord(std::string_view word) {
+        return (static_cast<unsigned char> (toLower(word.front()))
+                + 33 * static_cast<unsigned char> (toLower(word.back()))
+                + 7 * word.size()) % TABLE_SIZE;
+    }
+
+    /**
+     * The index in KEYWORDS plus one of the keyword in each slot, or zero if
+     * the slot is empty.
+     */
+    struct KeywordTable {
+        std::array<unsigned char, TABLE_SIZE> slots{};
+        bool perfect = true;  // False if two keywords share a slot
+    };
+
+    constexpr KeywordTable buildKeywordTable() {
+        KeywordTable table;
+        for (std::size_t i = 0; i < KEYWORD_COUNT; i++) {
+            unsigned int slot = hashWord(KEYWORDS[i].text);
+            if (table.slots[slot] != 0) {
+                table.perfect = false;
+            }
+            table.slots[slot] = i + 1;
+        }
+        return table;
+    }
+
+    constexpr KeywordTable keywordTable = buildKeywordTable();
+    static_assert(keywordTable.perfect, "Keywords must hash to distinct slots");
+
+    bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n'
+                || c == '\f' || c == '\v';
+    }
+
+    /** Checks if the character is a symbol that ends a word. */
+    bool isSymbol(char c) {
+        switch (c) {
+            case '(':
+            case ')':
+            case ',':
+            case ';':
+            case '=':
+            case '<':
+            case '>':
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * Gets the length of the symbol starting at the given position, or zero
+     * if no symbol starts there.
+     */
+    std::size_t getSymbolLength(std::string_view query, std::size_t i) {
+        bool equalsNext = i + 1 < query.size() && query[i + 1] == '=';
+        if (query[i] == '<' || query[i] == '>') {
+            return equalsNext ? 2 : 1;
+        } else if (query[i] == '!') {
+            return equalsNext ? 2 : 0;
+        }
+        return isSymbol(query[i]) ? 1 : 0;
+    }
+}  // namespace
+
+query_lexer::Keyword query_lexer::findKeyword(std::string_view word) {
+    if (word.size() < MIN_KEYWORD_LENGTH || word.size() > MAX_KEYWORD_LENGTH) {
+        return Keyword::NONE;
+    }
+    unsigned char entry = keywordTable.slots[hashWord(word)];
+    if (entry == 0) {
+        return Keyword::NONE;
+    }
+    std::string_view text = KEYWORDS[entry - 1].text;
+    if (text.size() != word.size()) {
+        return Keyword::NONE;
+    }
+    for (std::size_t i = 0; i < word.size(); i++) {
+        if (toLower(word[i]) != text[i]) {
+            return Keyword::NONE;
+        }
+    }
+    return KEYWORDS[entry - 1].keyword;
+}
+
+bool query_lexer::tokenize(std::string_view query, TokenVec& tokens) {
+    tokens.clear();
+    std::size_t i = 0;
+    while (i < query.size()) {
+        if (isSpace(query[i])) {
+            i++;
+            continue;
+        }
+        std::size_t start = i;
+        std::size_t symbolLength = getSymbolLength(query, i);
+        if (symbolLength != 0) {
+            tokens.push_back({query.substr(start, symbolLength)});
+            i += symbolLength;
+            continue;
+        }
+        bool quoted = false;
+        while (i < query.size() && !isSpace(query[i])
+                && getSymbolLength(query, i) == 0) {
+            char c = query[i];
+            if (c == '\\') {
+                i += 2;
+            } else if (c == '"' || c == '\'') {
+                // Read up to the closing quote
+                quoted = true;
+                for (i++; i < query.size() && query[i] != c; i++) {
+                    if (query[i] == '\\') {
+                        i++;
+                    }
+                }
+                if (i >= query.size()) {
+                    return false;
+                }
+                i++;
+            } else {
+                i++;
+            }
+        }
+        i = std::min(i, query.size());
+        Token token{query.substr(start, i - start)};
+        if (!quoted) {
+            token.keyword = findKeyword(token.text);
+        }
+        tokens.push_back(token);
+    }
+    return true;
+}
+
+bool query_lexer::isComparison(const Token& token) {
+    return token.keyword == Keyword::LIKE || token == "=" || token == "!="
+            || token == "<" || token == "<=" || token == ">" || token == ">=";
+}
+
+bool query_lexer::isQuoted(const Token& token) {
+    return token.text.front() == '"' || token.text.front() == '\'';
+}
+
+bool query_lexer::isNumeric(const Token& token) {
+    std::string_view text = token.text;
+    if (text.front() == '-' || text.front() == '+') {
+        text.remove_prefix(1);
+    }
+    if (!text.empty() && text.front() == '.') {
+        text.remove_prefix(1);
+    }
+    return !text.empty() && std::isdigit(
+            static_cast<unsigned char> (text.front()));
+}
+
+bool query_lexer::isParameter(const Token& token) {
+    std::string_view text = token.text;
+    if (text == "?") {
+        return true;
+    } else if (text.size() < 2 || text.front() != '$') {
+        return false;
+    }
+    for (char c : text.substr(1)) {
+        if (!std::isdigit(static_cast<unsigned char> (c))) {
+            return false;
+        }
+    }
+    return true;
+}
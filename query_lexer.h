@@ -0,0 +1,79 @@
+/*
+ * File:   query_lexer.h
+ * Splits query strings into tokens in a single pass.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef QUERY_LEXER_H
+#define QUERY_LEXER_H
+
+#include <string_view>
+#include <vector>
+
+namespace query_lexer {
+    /** The keywords recognized by the parser. */
+    enum class Keyword : unsigned char {
+        NONE, AND, AS, BY, COPY, CREATE, DELETE, DESC, DISTINCT, DROP,
+        EXECUTE, FROM, INSERT, INTO, KEY, LIKE, NOT, NULL_VALUE, OR, ORDER,
+        PREPARE, PRIMARY, REFERENCES, SELECT, SET, TABLE, TEMPORARY, UPDATE,
+        VALUES, WHERE, WITH
+    };
+
+    /**
+     * A token of a query. The text is a view into the query string, so a
+     * token is only valid as long as the string it was read from.
+     */
+    struct Token {
+        std::string_view text;
+        Keyword keyword = Keyword::NONE;  // Set for unquoted keywords
+
+        /** Checks if the token is the given symbol or word. */
+        bool operator==(std::string_view s) const {
+            return text == s;
+        }
+        bool operator!=(std::string_view s) const {
+            return text != s;
+        }
+    };
+
+    using TokenVec = std::vector<Token>;
+
+    /**
+     * Finds the keyword matching the given word, ignoring case. Keywords are
+     * looked up in a perfect hash table built at compile time.
+     *
+     * @return The keyword, or Keyword::NONE if the word is not a keyword
+     */
+    Keyword findKeyword(std::string_view word);
+
+    /**
+     * Splits a query into tokens. The symbols ( ) , ; = < <= > >= and != are
+     * tokens of their own; everything else is split on whitespace. Quoted
+     * strings are kept whole, quotes included, and a backslash escapes the
+     * character after it.
+     *
+     * @param query The query string
+     * @param tokens Set to the tokens of the query
+     * @return False if a quoted string is not closed
+     */
+    bool tokenize(std::string_view query, TokenVec& tokens);
+
+    /** Checks if the token is a comparison operator, including LIKE. */
+    bool isComparison(const Token& token);
+
+    /** Checks if the token is a quoted string. */
+    bool isQuoted(const Token& token);
+
+    /**
+     * Checks if the token is an unquoted number, date or time: a digit,
+     * optionally preceded by a sign and a decimal point.
+     */
+    bool isNumeric(const Token& token);
+
+    /** Checks if the token is a parameter placeholder, ? or $n. */
+    bool isParameter(const Token& token);
+}
+
+#endif /* QUERY_LEXER_H */
+
@@ -0,0 +1,345 @@
+/*
+ * File:   result_writer.cpp
+ * Implementation file for result_writer.h.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Column.h"
+#include "ColumnMetadata.h"
+#include "constants.h"
+#include "InvalidQueryException.h"
+#include "result_writer.h"
+#include "RowBatch.h"
+#include "Schema.h"
+#include "Table.h"
+
+using result_writer::Format;
+
+// Helper functions
+namespace {
+    /**
+     * A file written through a buffer, which is written out only when it
+     * holds at least EXPORT_BUFFER_SIZE bytes.
+     */
+    struct OutputFile {
+        std::ofstream stream;
+        std::string buffer;
+        std::string path;
+
+        /** Writes out the buffer if it is full. */
+        void flushIfFull() {
+            if (buffer.size() >= EXPORT_BUFFER_SIZE) {
+                flush();
+            }
+        }
+
+        /** Writes out the buffer. */
+        void flush() {
+            stream.write(buffer.data(), buffer.size());
+            buffer.clear();
+            if (!stream) {
+                throw InvalidQueryException("Could not write " + path);
+            }
+        }
+    };
+
+    /** How a column is written. */
+    struct OutputColumn {
+        ValueType valueType;
+        bool wide = true;  // For binary files: bigint, double and time
+        std::string key;   // For JSON lines: the quoted name and a colon
+    };
+
+    void appendInteger(std::string& out, long long value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, result.ptr);
+    }
+
+    void appendDouble(std::string& out, double value) {
+        char digits[32];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, result.ptr);
+    }
+
+    /** Appends a number of at least two digits, padded with zeros. */
+    void appendTwoDigits(std::string& out, long long value) {
+        if (value < 10) {
+            out += '0';
+        }
+        appendInteger(out, value);
+    }
+
+    /** Appends a date stored as YYYYMMDD as YYYY-MM-DD. */
+    void appendDate(std::string& out, long long value) {
+        long long year = value / 10000;
+        for (long long place = 1000; place > 1 && year < place; place /= 10) {
+            out += '0';
+        }
+        appendInteger(out, year);
+        out += '-';
+        appendTwoDigits(out, value / 100 % 100);
+        out += '-';
+        appendTwoDigits(out, value % 100);
+    }
+
+    /**
+     * Appends a time stored as microseconds since midnight as hh:mm:ss,
+     * followed by the fraction of a second if there is one.
+     */
+    void appendTime(std::string& out, long long value) {
+        long long seconds = value / 1000000;
+        appendTwoDigits(out, seconds / 3600);
+        out += ':';
+        appendTwoDigits(out, seconds / 60 % 60);
+        out += ':';
+        appendTwoDigits(out, seconds % 60);
+        if (value % 1000000 != 0) {
+            std::string fraction = std::to_string(value % 1000000);
+            out += '.';
+            out.append(6 - fraction.size(), '0');
+            out += fraction;
+        }
+    }
+
+    /**
+     * Appends the text of a value that is not null.
+     *
+     * @param buffer Holds the text of values that are not stored as text
+     * @return True if the value is written as a number: it is an int,
+     * bigint, float or double and was stored in its type
+     */
+    bool appendValue(std::string& out, const Column& col,
+            ValueType valueType, std::string& buffer) {
+        long long integer;
+        double real;
+        if (valueType == ValueType::INTEGER && col.getStoredValue(integer)) {
+            appendInteger(out, integer);
+            return true;
+        } else if (valueType == ValueType::DOUBLE
+                && col.getStoredValue(real)) {
+            appendDouble(out, real);
+            return std::isfinite(real);
+        } else if (valueType == ValueType::DATE
+                && col.getStoredValue(integer)) {
+            appendDate(out, integer);
+        } else if (valueType == ValueType::TIME && col.getStoredValue(integer)
+                && integer >= 0) {
+            appendTime(out, integer);
+        } else {
+            out += col.getText(buffer);
+        }
+        return false;
+    }
+
+    /**
+     * Appends a field of a CSV or TSV record, quoting it if it is empty or
+     * holds the delimiter, a quote or a line break.
+     */
+    void appendField(std::string& out, std::string_view text,
+            char delimiter) {
+        const char specials[] = {delimiter, '"', '\n', '\r', '\0'};
+        if (!text.empty() && text.find_first_of(specials) == text.npos) {
+            out += text;
+            return;
+        }
+        out += '"';
+        for (char c : text) {
+            if (c == '"') {
+                out += '"';
+            }
+            out += c;
+        }
+        out += '"';
+    }
+
+    /** Appends a JSON string, escaping quotes, backslashes and controls. */
+    void appendJsonString(std::string& out, std::string_view text) {
+        static const char hexDigits[] = "0123456789abcdef";
+        out += '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (c == '\n') {
+                out += "\\n";
+            } else if (c == '\t') {
+                out += "\\t";
+            } else if (c == '\r') {
+                out += "\\r";
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                out += "\\u00";
+                out += hexDigits[c >> 4];
+                out += hexDigits[c & 0xf];
+            } else {
+                out += c;
+            }
+        }
+        out += '"';
+    }
+
+    /** Appends the bytes of a number in the machine's byte order. */
+    template<typename Number>
+    void appendBytes(std::string& out, Number value) {
+        char bytes[sizeof(Number)];
+        std::memcpy(bytes, &value, sizeof(Number));
+        out.append(bytes, sizeof(Number));
+    }
+
+    /** Appends text preceded by its length as a uint32. */
+    void appendSized(std::string& out, std::string_view text) {
+        appendBytes(out, static_cast<std::uint32_t>(text.size()));
+        out += text;
+    }
+
+    /**
+     * Appends a value to a binary file in its column's type.
+     *
+     * @throw InvalidQueryException if the value is not stored in the
+     * column's type
+     */
+    void appendBinaryValue(std::string& out, const Column& col,
+            const OutputColumn& column, std::string& buffer) {
+        if (col.isNull()) {
+            out += '\1';
+            return;
+        }
+        out += '\0';
+        long long integer;
+        double real;
+        std::string_view text;
+        if (column.valueType == ValueType::STRING
+                && col.getStoredValue(text)) {
+            appendSized(out, text);
+        } else if (column.valueType == ValueType::DOUBLE
+                && col.getStoredValue(real)) {
+            if (column.wide) {
+                appendBytes(out, real);
+            } else {
+                appendBytes(out, static_cast<float>(real));
+            }
+        } else if (column.valueType != ValueType::STRING
+                && column.valueType != ValueType::DOUBLE
+                && col.getStoredValue(integer)) {
+            if (column.wide) {
+                appendBytes(out, static_cast<std::int64_t>(integer));
+            } else {
+                appendBytes(out, static_cast<std::int32_t>(integer));
+            }
+        } else {
+            throw InvalidQueryException("Cannot write "
+                    + std::string(col.getText(buffer)) + " as "
+                    + col.getMetadata().getColumnType());
+        }
+    }
+
+    /**
+     * Appends a row of the batch to the file's buffer.
+     *
+     * @param batch The batch holding the row
+     * @param position The position of the row in the batch
+     * @param columns How each column of the row is written
+     * @param format The format of the file
+     * @param text Holds the text of each value before it is quoted
+     * @param buffer Holds the text of values that are not stored as text
+     */
+    void appendRow(std::string& out, const RowBatch& batch,
+            unsigned int position, const std::vector<OutputColumn>& columns,
+            Format format, std::string& text, std::string& buffer) {
+        char delimiter = format == Format::TSV ? '\t' : ',';
+        for (unsigned int c = 0; c < columns.size(); c++) {
+            const Column& col = batch.getColumn(c, position);
+            const OutputColumn& column = columns[c];
+            if (format == Format::BINARY) {
+                appendBinaryValue(out, col, column, buffer);
+                continue;
+            } else if (format == Format::JSONL) {
+                out += c == 0 ? '{' : ',';
+                out += column.key;
+                if (col.isNull()) {
+                    out += "null";
+                    continue;
+                }
+                text.clear();
+                if (appendValue(text, col, column.valueType, buffer)) {
+                    out += text;
+                } else {
+                    appendJsonString(out, text);
+                }
+                continue;
+            }
+            if (c != 0) {
+                out += delimiter;
+            }
+            if (!col.isNull()) {
+                text.clear();
+                appendValue(text, col, column.valueType, buffer);
+                appendField(out, text, delimiter);
+            }
+        }
+        if (format == Format::JSONL) {
+            out += columns.empty() ? "{}" : "}";
+        }
+        if (format != Format::BINARY) {
+            out += '\n';
+        }
+    }
+}  // namespace
+
+unsigned long result_writer::writeFile(Table& table, const std::string& path,
+        Format format) {
+    OutputFile file;
+    file.path = path;
+    file.stream.open(path, std::ios::out | std::ios::trunc
+            | std::ios::binary);
+    if (!file.stream) {
+        throw InvalidQueryException("Could not open " + path);
+    }
+    file.buffer.reserve(EXPORT_BUFFER_SIZE + EXPORT_BUFFER_SIZE / 4);
+    MetadataVec metadataVec = table.getResultColumns();
+    std::vector<OutputColumn> columns;
+    if (format == Format::BINARY) {
+        file.buffer += "DBR1";
+        appendBytes(file.buffer,
+                static_cast<std::uint32_t>(metadataVec.size()));
+    }
+    for (const auto& metadata : metadataVec) {
+        const std::string& dataType = metadata.getColumnType();
+        std::string name = metadata.getTableName() + "."
+                + metadata.getColumnName();
+        OutputColumn column;
+        column.valueType = metadata.getValueType();
+        column.wide = dataType == "bigint" || dataType == "double"
+                || dataType == "time";
+        if (format == Format::JSONL) {
+            appendJsonString(column.key, name);
+            column.key += ':';
+        } else if (format == Format::BINARY) {
+            appendSized(file.buffer, name);
+            appendSized(file.buffer, dataType);
+        }
+        columns.push_back(column);
+    }
+    RowBatch batch;
+    std::string text, buffer;
+    unsigned long written = 0;
+    while (table.nextBatch(batch)) {
+        for (unsigned int position : batch.getSelection()) {
+            appendRow(file.buffer, batch, position, columns, format, text,
+                    buffer);
+            file.flushIfFull();
+        }
+        written += batch.getSelection().size();
+    }
+    file.flush();
+    return written;
+}
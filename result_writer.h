@@ -0,0 +1,54 @@
+/*
+ * File:   result_writer.h
+ * Writes the rows of query results to files.
+ *
+ * Copyright (C) Jared Higgins (higginjt@miamioh.edu) 2019
+ */
+
+#ifndef RESULT_WRITER_H
+#define RESULT_WRITER_H
+
+#include <string>
+
+class Table;  // Forward declaration of class Table
+
+namespace result_writer {
+    /** The formats results can be written in. */
+    enum class Format : unsigned char {
+        CSV,    // Comma separated values, quoted as COPY reads them
+        TSV,    // Tab separated values, quoted as COPY reads them
+        JSONL,  // One JSON object per row, keyed by column name
+        BINARY  // Length-prefixed values in the machine's byte order
+    };
+
+    /**
+     * Writes the remaining rows of a table to a file, replacing it. The rows
+     * are extracted in batches and formatted into a large buffer, which is
+     * written out whenever it fills, so no row is flushed on its own.
+     *
+     * CSV and TSV files hold one record per row and no header, so they can be
+     * loaded back with COPY. Null values are empty fields; fields that are
+     * empty strings or hold the delimiter, quotes or line breaks are quoted.
+     *
+     * Binary files start with the bytes "DBR1", the number of columns as a
+     * uint32, and the name and data type of each column as uint32
+     * length-prefixed strings. Each row follows as one value per column: a
+     * uint8 that is 1 if the value is null, then, if it is not, an int32
+     * (int), int64 (bigint), float32 (float), float64 (double), int32 holding
+     * YYYYMMDD (date), int64 holding microseconds since midnight (time), or
+     * uint32 length-prefixed bytes (char and varchar).
+     *
+     * @param table The table whose rows are written, with its restrictions,
+     * ordering and column filters applied
+     * @param path The path of the file
+     * @param format The format to write the rows in
+     * @return The number of rows written
+     * @throw InvalidQueryException if the file cannot be written or a value
+     * cannot be written in its column's type
+     */
+    unsigned long writeFile(Table& table, const std::string& path,
+            Format format);
+}
+
+#endif /* RESULT_WRITER_H */
+
@@ -7,16 +7,182 @@
 
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 #include "Column.h"
 #include "constants.h"
 #include "InvalidQueryException.h"
+#include "MemoryTable.h"
 #include "Row.h"
+#include "ScanStream.h"
 #include "Schema.h"
 #include "string_util.h"
+#include "Table.h"
 #include "table_io_util.h"
 
+// Helper variables and functions
+namespace {
+    /** Whether the whole database is kept in memory. */
+    bool inMemory = false;
+
+    /** The tables stored in memory, by name. */
+    std::unordered_map<std::string, std::shared_ptr<MemoryTableData>>
+            memoryTables;
+
+    /**
+     * The schemas of the tables stored in files, by name, so that the first
+     * line of a table file is only read and parsed once.
+     */
+    std::unordered_map<std::string, Schema> fileSchemas;
+
+    /** Incremented whenever a table is created or dropped. */
+    unsigned long catalogVersion = 0;
+
+    /** The values of a column that must exist in the column it references. */
+    struct ReferenceCheck {
+        unsigned int index;     // The index of the referencing column
+        unsigned int refIndex;  // The index of the referenced column
+        std::unordered_set<std::string> missing;  // The values not yet found
+    };
+
+    /** Gets the path to the file for the given table. */
+    std::string getPathToTableFile(const std::string& tableName) {
+        return TABLE_DIRECTORY + tableName + TABLE_EXTENSION;
+    }
+
+    /**
+     * Gets the data of the given table if it is stored in memory.
+     * 
+     * @return The data, or nullptr if the table is not in memory
+     */
+    std::shared_ptr<MemoryTableData> findMemoryTable(
+            const std::string& tableName) {
+        auto entry = memoryTables.find(tableName);
+        return entry == memoryTables.end() ? nullptr : entry->second;
+    }
+}  // namespace
+
+void table_io_util::setInMemory(bool enabled) {
+    inMemory = enabled;
+}
+
+bool table_io_util::isInMemory() {
+    return inMemory;
+}
+
+bool table_io_util::tableExists(const std::string& tableName) {
+    if (findMemoryTable(tableName)) {
+        return true;
+    }
+    return !inMemory && fs::exists(getPathToTableFile(tableName));
+}
+
+Schema table_io_util::loadSchema(const std::string& tableName) {
+    auto data = findMemoryTable(tableName);
+    if (data) {
+        return data->schema;
+    }
+    auto cached = fileSchemas.find(tableName);
+    if (cached != fileSchemas.end()) {
+        return cached->second;
+    }
+    if (!tableExists(tableName)) {
+        throw InvalidQueryException(tableName + " does not exist");
+    }
+    std::ifstream in(getPathToTableFile(tableName));
+    std::string schemaStr;
+    std::getline(in, schemaStr);
+    Schema schema(tableName, schemaStr);
+    fileSchemas.emplace(tableName, schema);
+    return schema;
+}
+
+std::shared_ptr<Table> table_io_util::openTable(const std::string& tableName) {
+    auto data = findMemoryTable(tableName);
+    if (data) {
+        return std::make_shared<MemoryTable>(tableName, data);
+    }
+    return std::make_shared<Table>(tableName, loadSchema(tableName));
+}
+
+void table_io_util::createTable(const std::string& tableName,
+        const Schema& schema, bool temporary) {
+    if (tableExists(tableName)) {
+        throw InvalidQueryException(tableName + " already exists");
+    }
+    catalogVersion++;
+    if (temporary || inMemory) {
+        auto data = std::make_shared<MemoryTableData>();
+        data->schema = schema;
+        memoryTables[tableName] = data;
+        return;
+    }
+    fileSchemas.erase(tableName);
+    fs::create_directory(TABLE_DIRECTORY);
+    std::ofstream out(getPathToTableFile(tableName));
+    out << schema.toString() << std::endl;
+}
+
+unsigned long table_io_util::getCatalogVersion() {
+    return catalogVersion;
+}
+
+void table_io_util::dropTable(const std::string& tableName) {
+    catalogVersion++;
+    if (memoryTables.erase(tableName) == 0) {
+        fileSchemas.erase(tableName);
+        std::remove(getPathToTableFile(tableName).c_str());
+    }
+}
+
+std::vector<std::string> table_io_util::getTableNames() {
+    std::set<std::string> names;
+    for (const auto& entry : memoryTables) {
+        names.insert(entry.first);
+    }
+    if (!inMemory && fs::exists(TABLE_DIRECTORY)) {
+        for (const auto& dirEntry : fs::directory_iterator(TABLE_DIRECTORY)) {
+            if (fs::is_regular_file(dirEntry.status())
+                    && dirEntry.path().extension() == TABLE_EXTENSION) {
+                names.insert(dirEntry.path().stem());
+            }
+        }
+    }
+    return std::vector<std::string>(names.begin(), names.end());
+}
+
+void table_io_util::scanRows(const std::string& tableName,
+        const RowVisitor& visitor) {
+    auto data = findMemoryTable(tableName);
+    if (data) {
+        for (const auto& row : data->rows) {
+            if (!visitor(row)) {
+                return;
+            }
+        }
+        return;
+    }
+    if (inMemory) {
+        return;
+    }
+    ScanStream tableFile(getPathToTableFile(tableName));
+    std::string schemaStr;
+    std::getline(tableFile, schemaStr);
+    Row row(Schema(tableName, schemaStr));
+    while (tableFile >> row) {
+        if (!visitor(row)) {
+            return;
+        }
+    }
+}
+
 void table_io_util::formatColumnValue(const std::string& colType,
         std::string& colValue) {
     if (colType == "date") {
@@ -51,44 +217,167 @@ void table_io_util::validateReferencedColumn(const ColumnMetadata& metadata,
             metadata.getReferencedColumn(), '.');
     auto table = referencedColParts[0];
     auto refColName = referencedColParts[1];
-    std::ifstream tableFile(TABLE_DIRECTORY + table + TABLE_EXTENSION);
-    std::string tmp;
-    std::getline(tableFile, tmp);
-    Row row(Schema(metadata.getTableName(), tmp));
+    unsigned int index = loadSchema(table).bindColumn(refColName);
     bool valid = false;
-    while (!valid && tableFile >> row) {
-        Column col = row.getColumn(refColName);
+    scanRows(table, [&](const Row& row) {
+        const Column& col = row[index];
         if (!col.isNull() && static_cast<std::string> (col) == colValue) {
             valid = true;
         }
-    }
+        return !valid;
+    });
     if (!valid) {
         throw InvalidQueryException("Value " + colValue
                 + " does not reference " + metadata.getReferencedColumn());
     }
 }
 
+void table_io_util::validateReferencedColumns(const RowVec& rows) {
+    const Row& first = rows.front();
+    // The checks for each referenced table, in the order they are found
+    std::vector<std::pair<std::string, std::vector<ReferenceCheck>>> checks;
+    for (unsigned int index = 0; index < first.getColumns().size(); index++) {
+        const std::string& referencedCol = first[index].getMetadata()
+                .getReferencedColumn();
+        if (referencedCol == "") {
+            continue;
+        }
+        auto referencedColParts = string_util::split(referencedCol, '.');
+        const std::string& table = referencedColParts[0];
+        ReferenceCheck check{index,
+                loadSchema(table).bindColumn(referencedColParts[1]), {}};
+        for (const auto& row : rows) {
+            if (!row[index].isNull()) {
+                check.missing.insert(static_cast<std::string> (row[index]));
+            }
+        }
+        auto tableChecks = std::find_if(checks.begin(), checks.end(),
+                [&](const auto& entry) { return entry.first == table; });
+        if (tableChecks == checks.end()) {
+            checks.emplace_back(table, std::vector<ReferenceCheck>());
+            tableChecks = checks.end() - 1;
+        }
+        tableChecks->second.push_back(std::move(check));
+    }
+    for (auto& tableChecks : checks) {
+        scanRows(tableChecks.first, [&](const Row& row) {
+            bool done = true;
+            for (auto& check : tableChecks.second) {
+                const Column& col = row[check.refIndex];
+                if (!col.isNull()) {
+                    check.missing.erase(static_cast<std::string> (col));
+                }
+                done = done && check.missing.empty();
+            }
+            return !done;
+        });
+    }
+    // Report the first value that was not found
+    for (const auto& row : rows) {
+        for (const auto& tableChecks : checks) {
+            for (const auto& check : tableChecks.second) {
+                const Column& col = row[check.index];
+                if (!col.isNull() && check.missing.count(
+                        static_cast<std::string> (col)) != 0) {
+                    throw InvalidQueryException("Value "
+                            + static_cast<std::string> (col)
+                            + " does not reference "
+                            + col.getMetadata().getReferencedColumn());
+                }
+            }
+        }
+    }
+}
+
+std::vector<table_io_util::ReferencedValues>
+        table_io_util::loadReferencedValues(const Schema& schema) {
+    std::vector<ReferencedValues> references;
+    const MetadataVec& columns = schema.getMetadataForColumns();
+    for (unsigned int index = 0; index < columns.size(); index++) {
+        const std::string& referencedCol = columns[index]
+                .getReferencedColumn();
+        if (referencedCol == "") {
+            continue;
+        }
+        auto referencedColParts = string_util::split(referencedCol, '.');
+        const std::string& table = referencedColParts[0];
+        references.push_back({index, table,
+                loadSchema(table).bindColumn(referencedColParts[1]),
+                FlatHashTable()});
+    }
+    // Each referenced table is scanned once for all of its columns
+    std::vector<bool> scanned(references.size(), false);
+    for (unsigned int i = 0; i < references.size(); i++) {
+        if (scanned[i]) {
+            continue;
+        }
+        std::vector<ReferencedValues*> tableReferences;
+        for (unsigned int j = i; j < references.size(); j++) {
+            if (references[j].table == references[i].table) {
+                tableReferences.push_back(&references[j]);
+                scanned[j] = true;
+            }
+        }
+        // Values are compared by their text, as they are in
+        // validateReferencedColumns(const RowVec&)
+        std::string key;
+        scanRows(references[i].table, [&](const Row& row) {
+            for (auto reference : tableReferences) {
+                const Column& col = row[reference->refIndex];
+                if (!col.isNull()) {
+                    key.clear();
+                    FlatHashTable::appendKey(key, col, false);
+                    reference->values.insert(key, FlatHashTable::hash(key));
+                }
+            }
+            return true;
+        });
+    }
+    return references;
+}
+
+void table_io_util::validateReferencedColumns(const RowVec& rows,
+        const std::vector<ReferencedValues>& references) {
+    std::string key;
+    for (const auto& row : rows) {
+        for (const auto& reference : references) {
+            const Column& col = row[reference.index];
+            if (col.isNull()) {
+                continue;
+            }
+            key.clear();
+            FlatHashTable::appendKey(key, col, false);
+            if (reference.values.find(key, FlatHashTable::hash(key))
+                    == FlatHashTable::NOT_FOUND) {
+                throw InvalidQueryException("Value "
+                        + static_cast<std::string> (col)
+                        + " does not reference "
+                        + col.getMetadata().getReferencedColumn());
+            }
+        }
+    }
+}
+
 void table_io_util::validateReferencedBy(const ColumnMetadata& metadata,
-        const std::string& oldValue, const fs::path& path) {
+        const std::string& oldValue, const std::string& otherTableName) {
     auto colName = metadata.getColumnName();
     auto tableName = metadata.getTableName();
-    std::string schemaStr;
-    std::ifstream tableFile(path);
-    std::getline(tableFile, schemaStr);
-    Schema schema(path.stem(), schemaStr);
-    for (const auto& otherMetadata : schema.getMetadataForColumns()) {
+    Schema schema = loadSchema(otherTableName);
+    const MetadataVec& metadataVec = schema.getMetadataForColumns();
+    for (unsigned int index = 0; index < metadataVec.size(); index++) {
+        const ColumnMetadata& otherMetadata = metadataVec[index];
         auto refColName = otherMetadata.getReferencedColumn();
         if (refColName == tableName + "." + colName) {
-            Row row(schema);
+            // Only scan tables that actually reference the column
             bool valid = true;
-            while (valid && tableFile >> row) {
-                Column col =
-                        row.getColumn(otherMetadata.getColumnName());
+            scanRows(otherTableName, [&](const Row& row) {
+                const Column& col = row[index];
                 if (!col.isNull()
                         && static_cast<std::string> (col) == oldValue) {
                     valid = false;
                 }
-            }
+                return valid;
+            });
             if (!valid) {
                 throw InvalidQueryException("Column " +
                     otherMetadata.getTableName() + "."
@@ -102,9 +391,7 @@ void table_io_util::validateReferencedBy(const ColumnMetadata& metadata,
 
 void table_io_util::validateReferencedBy(const ColumnMetadata& metadata,
         const std::string& oldValue) {
-    for (const auto& dirEntry : fs::directory_iterator(TABLE_DIRECTORY)) {
-        if (fs::is_regular_file(dirEntry.status())) {
-            validateReferencedBy(metadata, oldValue, dirEntry.path());
-        }
+    for (const auto& tableName : getTableNames()) {
+        validateReferencedBy(metadata, oldValue, tableName);
     }
 }
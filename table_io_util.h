@@ -9,13 +9,106 @@
 #define TABLE_IO_UTIL_H
 
 #include <experimental/filesystem>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 #include "ColumnMetadata.h"
+#include "FlatHashTable.h"
+#include "Row.h"
+#include "Schema.h"
 
 namespace fs = std::experimental::filesystem;
 
+class Table;  // Forward declaration required due to circular dependencies
+
+/** Called for each row of a scan; returns false to stop the scan. */
+using RowVisitor = std::function<bool(const Row&)>;
+
 namespace table_io_util {
 
+    /** The values of a column referenced by a column of another table. */
+    struct ReferencedValues {
+        unsigned int index;     // The index of the referencing column
+        std::string table;      // The name of the referenced table
+        unsigned int refIndex;  // The index of the referenced column
+        FlatHashTable values;   // Packed from the text of the values
+    };
+
+    /**
+     * Sets whether the whole database is kept in memory. In memory mode,
+     * every table is created in memory and the table directory is never
+     * read or written.
+     * 
+     * @param enabled True to keep the database in memory
+     */
+    void setInMemory(bool enabled);
+
+    /** Checks whether the whole database is kept in memory. */
+    bool isInMemory();
+
+    /**
+     * Checks whether a table with the given name exists, either in memory or
+     * in the table directory.
+     * 
+     * @param tableName The name of the table
+     */
+    bool tableExists(const std::string& tableName);
+
+    /**
+     * Loads the schema of the given table.
+     * 
+     * @param tableName The name of the table
+     * @throw InvalidQueryException if the table does not exist
+     */
+    Schema loadSchema(const std::string& tableName);
+
+    /**
+     * Opens the given table. Tables in memory take precedence over tables
+     * stored in files with the same name.
+     * 
+     * @param tableName The name of the table
+     * @throw InvalidQueryException if the table does not exist
+     */
+    std::shared_ptr<Table> openTable(const std::string& tableName);
+
+    /**
+     * Creates a new, empty table.
+     * 
+     * @param tableName The name of the table
+     * @param schema The schema of the table
+     * @param temporary Whether the table is only kept in memory
+     * @throw InvalidQueryException if the table already exists
+     */
+    void createTable(const std::string& tableName, const Schema& schema,
+            bool temporary);
+
+    /**
+     * Gets the version of the catalog, which changes whenever a table is
+     * created or dropped. Anything derived from the schemas of tables can
+     * compare versions to tell whether it is out of date.
+     */
+    unsigned long getCatalogVersion();
+
+    /**
+     * Removes the given table and all of its rows.
+     * 
+     * @param tableName The name of the table
+     */
+    void dropTable(const std::string& tableName);
+
+    /** Gets the names of every table in the database. */
+    std::vector<std::string> getTableNames();
+
+    /**
+     * Passes every row of the given table to the visitor until it returns
+     * false.
+     * 
+     * @param tableName The name of the table to scan
+     * @param visitor The function to call for each row
+     */
+    void scanRows(const std::string& tableName, const RowVisitor& visitor);
+
     /**
      * Formats the given column value to be consistent with the given type.
      * This includes removing quotes and escaping characters when appropriate.
@@ -35,13 +128,45 @@ namespace table_io_util {
     void validateReferencedColumn(const ColumnMetadata& metadata,
             const std::string& colValue);
 
+    /**
+     * Ensures that every value in the given rows that references another
+     * column references an existing value. Each referenced table is scanned
+     * once for all of the rows.
+     * 
+     * @param rows The rows being inserted, with formatted values
+     * @throw InvalidQueryException if a value does not reference an existing
+     * value
+     */
+    void validateReferencedColumns(const RowVec& rows);
+
+    /**
+     * Reads the values of every column referenced by a column of the given
+     * schema. Each referenced table is scanned once.
+     * 
+     * @param schema The schema of the referencing table
+     * @return The values referenced by each referencing column
+     */
+    std::vector<ReferencedValues> loadReferencedValues(const Schema& schema);
+
+    /**
+     * Ensures that every value in the given rows that references another
+     * column is one of the values read by loadReferencedValues().
+     * 
+     * @param rows The rows being inserted, with formatted values
+     * @param references The referenced values
+     * @throw InvalidQueryException if a value does not reference an existing
+     * value
+     */
+    void validateReferencedColumns(const RowVec& rows,
+            const std::vector<ReferencedValues>& references);
+
     /**
      * See validateReferencedBy(ColumnMetadata, std::string).
      * 
-     * @param path The path of the table being searched for references
+     * @param tableName The name of the table being searched for references
      */
     void validateReferencedBy(const ColumnMetadata& metadata,
-            const std::string& oldValue, const fs::path& path);
+            const std::string& oldValue, const std::string& tableName);
 
     /**
      * Ensures that the column value being modified is not referenced by any